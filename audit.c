@@ -356,6 +356,31 @@ gen_audit_inserts(const struct strct *p,
 		puts("null,");
 }
 
+static void
+gen_audit_upserts(const struct strct *p, 
+	int json, const struct role *role)
+{
+
+	if (json)
+		printf("\t\t\t\"upsert\": ");
+	else
+		printf("%supsert:\n", SPACE);
+	if (NULL != p->ups &&
+	    NULL != p->ups->rolemap && 
+	    check_rolemap(p->ups->rolemap, role)) {
+		if (json)
+			putchar('"');
+		else
+			printf("%s%s", SPACE, SPACE);
+		print_name_db_upsert(p);
+		if (json)
+			puts("\",");
+		else
+			puts("");
+	} else if (json)
+		puts("null,");
+}
+
 static void
 gen_audit_deletes(const struct strct *p, 
 	int json, const struct role *role)
@@ -441,6 +466,23 @@ gen_protos_insert(const struct strct *s,
 	*first = 0;
 }
 
+static void
+gen_protos_upsert(const struct strct *s,
+	int *first, const struct role *role)
+{
+
+	if (NULL == s->ups || NULL == s->ups->rolemap)
+		return;
+	if ( ! check_rolemap(s->ups->rolemap, role))
+		return;
+	printf("%s\n\t\t\"", *first ? "" : ",");
+	print_name_db_upsert(s);
+	fputs("\": {\n"
+ 	      "\t\t\t\"doc\": null", stdout);
+	fputs(",\n\t\t\t\"type\": \"upsert\" }", stdout);
+	*first = 0;
+}
+
 static void
 gen_protos_updates(const struct updateq *uq,
 	int *first, const struct role *role)
@@ -713,6 +755,7 @@ gen_audit_json(const struct config *cfg, const char *role)
 		}
 
 		gen_audit_inserts(s, 1, r);
+		gen_audit_upserts(s, 1, r);
 		gen_audit_updates(s, 1, r);
 		gen_audit_deletes(s, 1, r);
 		gen_audit_queries(s, 1, STYPE_ITERATE, "iterates", r);
@@ -732,6 +775,7 @@ gen_audit_json(const struct config *cfg, const char *role)
 		gen_protos_updates(&s->uq, &first, r);
 		gen_protos_updates(&s->dq, &first, r);
 		gen_protos_insert(s, &first, r);
+		gen_protos_upsert(s, &first, r);
 	}
 
 	puts("\n\t},\n"
@@ -775,6 +819,7 @@ gen_audit(const struct config *cfg, const char *role)
 		}
 
 		gen_audit_inserts(s, 0, r);
+		gen_audit_upserts(s, 0, r);
 		gen_audit_updates(s, 0, r);
 		gen_audit_deletes(s, 0, r);
 		gen_audit_queries(s, 0, STYPE_ITERATE, "iterates", r);
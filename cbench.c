@@ -0,0 +1,1263 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 Kristaps Dzonsons <kristaps@bsd.lv>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "config.h"
+
+#if HAVE_SYS_QUEUE
+# include <sys/queue.h>
+#endif
+
+#include <assert.h>
+#if HAVE_ERR
+# include <err.h>
+#endif
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "version.h"
+#include "ort.h"
+#include "extern.h"
+#include "cprotos.h"
+#include "comments.h"
+
+/*
+ * What to do with each benchmarked operation: count it, emit the
+ * function running it once, or emit running it from main().
+ */
+enum	opmode {
+	OP_COUNT,
+	OP_FUNC,
+	OP_CALL
+};
+
+/*
+ * Whether the operation with roles "rm" may be run by any role.
+ * Without roles, all operations may be run.
+ */
+static int
+role_allowed(const struct config *cfg, const struct rolemap *rm)
+{
+	const struct rref	*rr;
+
+	if (TAILQ_EMPTY(&cfg->rq))
+		return 1;
+	if (rm == NULL)
+		return 0;
+	TAILQ_FOREACH(rr, &rm->rq, entries)
+		if (strcmp(rr->role->name, "none"))
+			return 1;
+	return 0;
+}
+
+/*
+ * The role in which to run the operation with roles "rm", which must
+ * be allowed, or NULL to run it in the "default" role of a newly-opened
+ * database.
+ * Otherwise, this is the first role granted the operation, as roles
+ * may also use the operations of their ancestors.
+ */
+static const struct role *
+role_run(const struct config *cfg, const struct rolemap *rm)
+{
+	const struct rref	*rr;
+
+	if (TAILQ_EMPTY(&cfg->rq))
+		return NULL;
+	assert(rm != NULL);
+	TAILQ_FOREACH(rr, &rm->rq, entries)
+		if (strcmp(rr->role->name, "default") == 0 ||
+		    strcmp(rr->role->name, "all") == 0)
+			return NULL;
+	TAILQ_FOREACH(rr, &rm->rq, entries)
+		if (strcmp(rr->role->name, "none"))
+			return rr->role;
+	abort();
+}
+
+/*
+ * Whether any operation is run in role "r".
+ */
+static int
+role_used(const struct config *cfg, const struct role *r)
+{
+	const struct strct	*p;
+	const struct search	*s;
+	const struct update	*u;
+
+	TAILQ_FOREACH(p, &cfg->sq, entries) {
+		if (p->ins != NULL &&
+		    role_allowed(cfg, p->ins->rolemap) &&
+		    role_run(cfg, p->ins->rolemap) == r)
+			return 1;
+		TAILQ_FOREACH(s, &p->sq, entries)
+			if (role_allowed(cfg, s->rolemap) &&
+			    role_run(cfg, s->rolemap) == r)
+				return 1;
+		TAILQ_FOREACH(u, &p->uq, entries)
+			if (role_allowed(cfg, u->rolemap) &&
+			    role_run(cfg, u->rolemap) == r)
+				return 1;
+		TAILQ_FOREACH(u, &p->dq, entries)
+			if (role_allowed(cfg, u->rolemap) &&
+			    role_run(cfg, u->rolemap) == r)
+				return 1;
+	}
+	return 0;
+}
+
+/*
+ * Print "fmt", given the role name three times, for each role of "rq"
+ * and its sub-roles in which operations are run.
+ */
+static void
+gen_roles(const struct config *cfg, const struct roleq *rq,
+	const char *fmt)
+{
+	const struct role	*r;
+
+	TAILQ_FOREACH(r, rq, entries) {
+		if (role_used(cfg, r))
+			printf(fmt, r->name, r->name, r->name);
+		gen_roles(cfg, &r->subrq, fmt);
+	}
+}
+
+/*
+ * Whether we insert into "p" and record the rowid of each row.
+ */
+static int
+strct_ids(const struct config *cfg, const struct strct *p)
+{
+
+	return p->ins != NULL && p->rowid != NULL &&
+		role_allowed(cfg, p->ins->rolemap);
+}
+
+/*
+ * Whether "p" is returned by an iterate search we run, and thus needs
+ * a callback.
+ */
+static int
+strct_iterated(const struct config *cfg, const struct strct *p)
+{
+	const struct strct	*pp;
+	const struct search	*s;
+
+	TAILQ_FOREACH(pp, &cfg->sq, entries)
+		TAILQ_FOREACH(s, &pp->sq, entries)
+			if (s->type == STYPE_ITERATE &&
+			    (s->dst != NULL ? s->dst->strct : pp) == p &&
+			    role_allowed(cfg, s->rolemap))
+				return 1;
+	return 0;
+}
+
+/*
+ * Follow foreign key references from "f" to the field whose values
+ * it takes.
+ */
+static const struct field *
+field_source(const struct field *f)
+{
+
+	while (f->type != FTYPE_STRUCT && f->ref != NULL &&
+	    f->ref->target != f)
+		f = f->ref->target;
+	return f;
+}
+
+/*
+ * Get the length limits of a string field "f" from its "limit"
+ * clauses into "min" and "max", the latter being zero if unlimited.
+ * The maximum is biased by one, so an empty string is a maximum of one.
+ */
+static void
+field_len(const struct field *f, size_t *min, size_t *max)
+{
+	const struct fvalid	*v;
+
+	*min = *max = 0;
+	TAILQ_FOREACH(v, &f->fvq, entries)
+		switch (v->type) {
+		case VALIDATE_GE:
+			*min = v->d.value.len;
+			break;
+		case VALIDATE_GT:
+			*min = v->d.value.len + 1;
+			break;
+		case VALIDATE_LE:
+			*max = v->d.value.len + 1;
+			break;
+		case VALIDATE_LT:
+			*max = v->d.value.len > 0 ? v->d.value.len : 1;
+			break;
+		case VALIDATE_EQ:
+			*min = v->d.value.len;
+			*max = v->d.value.len + 1;
+			break;
+		default:
+			abort();
+		}
+}
+
+/*
+ * Get the integer limits of "f" from its "limit" clauses into "lo" and
+ * "hi".
+ * Returns a bit-mask of 1 if "lo" is set and 2 if "hi" is set.
+ */
+static int
+field_int(const struct field *f, int64_t *lo, int64_t *hi)
+{
+	const struct fvalid	*v;
+	int			 rc = 0;
+
+	TAILQ_FOREACH(v, &f->fvq, entries)
+		switch (v->type) {
+		case VALIDATE_GE:
+			*lo = v->d.value.integer;
+			rc |= 1;
+			break;
+		case VALIDATE_GT:
+			*lo = v->d.value.integer + 1;
+			rc |= 1;
+			break;
+		case VALIDATE_LE:
+			*hi = v->d.value.integer;
+			rc |= 2;
+			break;
+		case VALIDATE_LT:
+			*hi = v->d.value.integer - 1;
+			rc |= 2;
+			break;
+		case VALIDATE_EQ:
+			*lo = *hi = v->d.value.integer;
+			rc |= 3;
+			break;
+		default:
+			abort();
+		}
+	return rc;
+}
+
+/*
+ * Like field_int() but for real-valued limits, which are all taken as
+ * strict.
+ */
+static int
+field_real(const struct field *f, double *lo, double *hi)
+{
+	const struct fvalid	*v;
+	int			 rc = 0;
+
+	TAILQ_FOREACH(v, &f->fvq, entries)
+		switch (v->type) {
+		case VALIDATE_GE:
+		case VALIDATE_GT:
+			*lo = v->d.value.decimal;
+			rc |= 1;
+			break;
+		case VALIDATE_LE:
+		case VALIDATE_LT:
+			*hi = v->d.value.decimal;
+			rc |= 2;
+			break;
+		case VALIDATE_EQ:
+			*lo = *hi = v->d.value.decimal;
+			rc |= 3;
+			break;
+		default:
+			abort();
+		}
+	return rc;
+}
+
+/*
+ * Size of the buffer holding string values of "f".
+ */
+static size_t
+field_bufsz(const struct field *f)
+{
+	size_t	 min, max;
+
+	if (f->type == FTYPE_EMAIL)
+		return strlen(f->name) + 64;
+	field_len(f, &min, &max);
+	return max > 0 ? max : min + strlen(f->name) + 32;
+}
+
+/*
+ * Declare the local "vN" holding a value of "f" at position "pos".
+ * If "in", integral types are all declared as int64_t, as used by the
+ * "in" operator and by JSON.
+ * Enumerations and bitfields declare a table of values to draw from.
+ */
+static void
+gen_decl(const struct field *f, size_t pos, int in)
+{
+	const struct eitem	*ei;
+	const struct bitidx	*bi;
+
+	f = field_source(f);
+
+	switch (f->type) {
+	case FTYPE_TEXT:
+	case FTYPE_PASSWORD:
+	case FTYPE_EMAIL:
+		printf("\tchar buf%zu[%zu];\n"
+		       "\tconst char *v%zu = buf%zu;\n",
+		       pos, field_bufsz(f), pos, pos);
+		break;
+	case FTYPE_BLOB:
+		printf("\tconst void *v%zu = \"ort-c-bench blob\";\n"
+		       "\tsize_t v%zu_sz = 16;\n", pos, pos);
+		break;
+	case FTYPE_REAL:
+		printf("\tdouble v%zu;\n", pos);
+		break;
+	case FTYPE_ENUM:
+		printf("\tstatic const int64_t e%zu[] = {", pos);
+		TAILQ_FOREACH(ei, &f->enm->eq, entries)
+			printf(" %" PRId64 "%s", ei->value,
+				TAILQ_NEXT(ei, entries) != NULL ?
+				"," : "");
+		puts(" };");
+		if (in)
+			printf("\tint64_t v%zu;\n", pos);
+		else
+			printf("\tenum %s v%zu;\n", f->enm->name, pos);
+		break;
+	case FTYPE_BITFIELD:
+		printf("\tstatic const int64_t b%zu[] = { 0", pos);
+		TAILQ_FOREACH(bi, &f->bitf->bq, entries)
+			printf(", (int64_t)1 << %" PRId64, bi->value);
+		puts(" };");
+		printf("\tint64_t v%zu;\n", pos);
+		break;
+	case FTYPE_DATE:
+	case FTYPE_EPOCH:
+		if (!in) {
+			printf("\ttime_t v%zu;\n", pos);
+			break;
+		}
+		/* FALLTHROUGH */
+	default:
+		printf("\tint64_t v%zu;\n", pos);
+		break;
+	}
+}
+
+/*
+ * Emit setting "vN", declared by gen_decl(), to the value of "f" for
+ * the row "i".
+ * Row values are unique where limits allow.
+ * Rowids take those of the inserted rows.
+ * If "self" is set, this is the insertion of "self" and references to
+ * its own rowid take that of the prior row (or the first).
+ */
+static void
+gen_set(const struct config *cfg, const struct field *f,
+	size_t pos, const struct strct *self)
+{
+	size_t	 min, max;
+	int64_t	 ilo = 0, ihi = 0;
+	double	 dlo = 0.0, dhi = 0.0;
+	int	 rc;
+
+	f = field_source(f);
+
+	if (f->flags & FIELD_ROWID) {
+		if (f->parent == self)
+			printf("\tv%zu = i > 0 ? ids_%s[i - 1] : 1;\n",
+				pos, f->parent->name);
+		else if (strct_ids(cfg, f->parent))
+			printf("\tv%zu = ids_%s[i %% nrows];\n",
+				pos, f->parent->name);
+		else
+			printf("\tv%zu = (int64_t)i + 1;\n", pos);
+		return;
+	}
+
+	switch (f->type) {
+	case FTYPE_TEXT:
+	case FTYPE_PASSWORD:
+		field_len(f, &min, &max);
+		if (min > strlen(f->name))
+			printf("\tsnprintf(buf%zu, sizeof(buf%zu), "
+				"\"%s%%0%zuzu\", i);\n", pos, pos,
+				f->name, min - strlen(f->name));
+		else
+			printf("\tsnprintf(buf%zu, sizeof(buf%zu), "
+				"\"%s%%zu\", i);\n", pos, pos, f->name);
+		break;
+	case FTYPE_EMAIL:
+		printf("\tsnprintf(buf%zu, sizeof(buf%zu), "
+			"\"%s%%zu@example.com\", i);\n",
+			pos, pos, f->name);
+		break;
+	case FTYPE_BLOB:
+		break;
+	case FTYPE_REAL:
+		rc = field_real(f, &dlo, &dhi);
+		if (rc == 3)
+			printf("\tv%zu = %g + (%g - %g) * "
+				"(double)(i %% 998 + 1) / 1000.0;\n",
+				pos, dlo, dhi, dlo);
+		else if (rc == 1)
+			printf("\tv%zu = %g + 1.0 + (double)i;\n",
+				pos, dlo);
+		else if (rc == 2)
+			printf("\tv%zu = %g - 1.0 - (double)i;\n",
+				pos, dhi);
+		else
+			printf("\tv%zu = (double)i + 0.5;\n", pos);
+		break;
+	case FTYPE_ENUM:
+		printf("\tv%zu = e%zu[i %% (sizeof(e%zu) / "
+			"sizeof(e%zu[0]))];\n", pos, pos, pos, pos);
+		break;
+	case FTYPE_BITFIELD:
+		printf("\tv%zu = b%zu[i %% (sizeof(b%zu) / "
+			"sizeof(b%zu[0]))];\n", pos, pos, pos, pos);
+		break;
+	default:
+		rc = field_int(f, &ilo, &ihi);
+		if (rc == 3 && ihi >= ilo &&
+		    (uint64_t)ihi - (uint64_t)ilo < UINT64_MAX)
+			printf("\tv%zu = %" PRId64 " + (int64_t)"
+				"((uint64_t)i %% %" PRIu64 "u);\n", pos,
+				ilo, (uint64_t)ihi - (uint64_t)ilo + 1);
+		else if (rc & 1)
+			printf("\tv%zu = %" PRId64 " + "
+				"(int64_t)i;\n", pos, ilo);
+		else if (rc & 2)
+			printf("\tv%zu = %" PRId64 " - "
+				"(int64_t)i;\n", pos, ihi);
+		else if (f->type == FTYPE_BIT)
+			printf("\tv%zu = (int64_t)(i %% 64);\n", pos);
+		else if (f->type == FTYPE_DATE ||
+		    f->type == FTYPE_EPOCH)
+			printf("\tv%zu = 1500000000 + "
+				"(int64_t)i * 3600;\n", pos);
+		else
+			printf("\tv%zu = (int64_t)i;\n", pos);
+		break;
+	}
+}
+
+/*
+ * Print the argument "vN" of "f" at position "pos", passed by pointer
+ * if "ptr" and as a one-element array for operator "op" if "in".
+ */
+static void
+gen_arg(const struct field *f, size_t pos, int ptr, int in)
+{
+
+	if (in)
+		printf(", 1, &v%zu", pos);
+	else if (f->type == FTYPE_BLOB)
+		printf(", v%zu_sz, %sv%zu", pos, ptr ? "&" : "", pos);
+	else
+		printf(", %sv%zu", ptr ? "&" : "", pos);
+}
+
+/*
+ * Open the function running an operation once for row "i".
+ * Its name is "bench_" followed by "type", the structure name, and the
+ * position "num" of the operation if non-zero.
+ */
+static void
+gen_op_open(const char *type, const struct strct *p, size_t num)
+{
+
+	if (num > 0)
+		printf("static int\n"
+		       "bench_%s_%s_%zu(struct ort *ctx, size_t i, "
+		        "struct timespec *t)\n"
+		       "{\n", type, p->name, num);
+	else
+		printf("static int\n"
+		       "bench_%s_%s(struct ort *ctx, size_t i, "
+		        "struct timespec *t)\n"
+		       "{\n", type, p->name);
+}
+
+/*
+ * Emit running the function running an operation from main().
+ * It's run on the handle of role "r" (NULL for the default role) once
+ * for each row or, if "once" is set, only once.
+ * The caller prints its name, for reporting, then closes the call.
+ */
+static void
+gen_op_call(const char *type, const struct strct *p, size_t num,
+	const struct role *r, int once)
+{
+
+	if (r != NULL)
+		printf("\tbench_run(ctx_%s, ", r->name);
+	else
+		printf("\tbench_run(ctx, ");
+	printf("%s, ", once ? "1" : "nrows");
+	if (num > 0)
+		printf("bench_%s_%s_%zu, \"", type, p->name, num);
+	else
+		printf("bench_%s_%s, \"", type, p->name);
+}
+
+/*
+ * Insert row "i" of "p", recording its rowid.
+ */
+static void
+gen_op_insert(const struct config *cfg, const struct strct *p)
+{
+	const struct field	*f;
+	size_t			 pos;
+
+	gen_op_open("insert", p, 0);
+	pos = 1;
+	TAILQ_FOREACH(f, &p->fq, entries)
+		if (f->type != FTYPE_STRUCT && !(f->flags & FIELD_ROWID))
+			gen_decl(f, pos++, 0);
+	puts("\tint64_t id;\n");
+
+	pos = 1;
+	TAILQ_FOREACH(f, &p->fq, entries)
+		if (f->type != FTYPE_STRUCT && !(f->flags & FIELD_ROWID))
+			gen_set(cfg, f, pos++, p);
+
+	printf("\tclock_gettime(CLOCK_MONOTONIC, &t[0]);\n"
+	       "\tid = ");
+	print_name_db_insert(p);
+	printf("(ctx");
+	pos = 1;
+	TAILQ_FOREACH(f, &p->fq, entries)
+		if (f->type != FTYPE_STRUCT && !(f->flags & FIELD_ROWID))
+			gen_arg(f, pos++,
+				(f->flags & FIELD_NULL) != 0, 0);
+	puts(");\n"
+	     "\tclock_gettime(CLOCK_MONOTONIC, &t[1]);");
+	if (strct_ids(cfg, p))
+		printf("\tids_%s[i] = id;\n", p->name);
+	puts("\treturn id >= 0;\n"
+	     "}\n");
+}
+
+/*
+ * Run search "s" with values of row "i", releasing its results.
+ */
+static void
+gen_op_search(const struct config *cfg, const struct search *s,
+	size_t num)
+{
+	const struct sent	*sent;
+	const struct strct	*retstr;
+	size_t			 pos;
+
+	retstr = s->dst != NULL ? s->dst->strct : s->parent;
+
+	gen_op_open("search", s->parent, num);
+	pos = 1;
+	TAILQ_FOREACH(sent, &s->sntq, entries)
+		if (OPTYPE_ISBINARY(sent->op))
+			gen_decl(sent->field, pos++,
+				sent->op == OPTYPE_IN);
+	if (s->type == STYPE_SEARCH)
+		printf("\tstruct %s *p;\n", retstr->name);
+	else if (s->type == STYPE_LIST)
+		printf("\tstruct %s_q *q;\n", retstr->name);
+	puts("");
+
+	pos = 1;
+	TAILQ_FOREACH(sent, &s->sntq, entries)
+		if (OPTYPE_ISBINARY(sent->op))
+			gen_set(cfg, sent->field, pos++, NULL);
+
+	puts("\tclock_gettime(CLOCK_MONOTONIC, &t[0]);");
+	if (s->type == STYPE_SEARCH)
+		printf("\tp = ");
+	else if (s->type == STYPE_LIST)
+		printf("\tq = ");
+	else
+		putchar('\t');
+	print_name_db_search(s);
+	if (s->type == STYPE_ITERATE)
+		printf("(ctx, bench_%s_cb, NULL", retstr->name);
+	else
+		printf("(ctx");
+	pos = 1;
+	TAILQ_FOREACH(sent, &s->sntq, entries)
+		if (OPTYPE_ISBINARY(sent->op))
+			gen_arg(sent->field, pos++, 0,
+				sent->op == OPTYPE_IN);
+	if (s->flags & SEARCH_LIMIT_BOUND)
+		printf(", 10");
+	if (s->flags & SEARCH_OFFSET_BOUND)
+		printf(", 0");
+	puts(");\n"
+	     "\tclock_gettime(CLOCK_MONOTONIC, &t[1]);");
+	if (s->type == STYPE_SEARCH)
+		printf("\tdb_%s_free(p);\n", retstr->name);
+	else if (s->type == STYPE_LIST)
+		printf("\tdb_%s_freeq(q);\n", retstr->name);
+	puts("\treturn 1;\n"
+	     "}\n");
+}
+
+/*
+ * Run update or delete "u" with values of row "i".
+ * Modified values are those of row "i" as well, so a row constrained
+ * to its own values is left unchanged.
+ */
+static void
+gen_op_update(const struct config *cfg, const struct update *u,
+	size_t num)
+{
+	const struct uref	*ur;
+	size_t			 pos;
+
+	gen_op_open(u->type == UP_MODIFY ? "update" : "delete",
+		u->parent, num);
+	pos = 1;
+	TAILQ_FOREACH(ur, &u->mrq, entries)
+		gen_decl(ur->field, pos++, 0);
+	TAILQ_FOREACH(ur, &u->crq, entries)
+		if (OPTYPE_ISBINARY(ur->op))
+			gen_decl(ur->field, pos++,
+				ur->op == OPTYPE_IN);
+	puts("\tint rc;\n");
+
+	pos = 1;
+	TAILQ_FOREACH(ur, &u->mrq, entries)
+		gen_set(cfg, ur->field, pos++, NULL);
+	TAILQ_FOREACH(ur, &u->crq, entries)
+		if (OPTYPE_ISBINARY(ur->op))
+			gen_set(cfg, ur->field, pos++, NULL);
+
+	printf("\tclock_gettime(CLOCK_MONOTONIC, &t[0]);\n"
+	       "\trc = ");
+	print_name_db_update(u);
+	printf("(ctx");
+	pos = 1;
+	TAILQ_FOREACH(ur, &u->mrq, entries)
+		gen_arg(ur->field, pos++,
+			(ur->field->flags & FIELD_NULL) != 0, 0);
+	TAILQ_FOREACH(ur, &u->crq, entries)
+		if (OPTYPE_ISBINARY(ur->op))
+			gen_arg(ur->field, pos++, 0,
+				ur->op == OPTYPE_IN);
+	puts(");\n"
+	     "\tclock_gettime(CLOCK_MONOTONIC, &t[1]);\n"
+	     "\treturn rc;\n"
+	     "}\n");
+}
+
+/*
+ * Whether "f" is parsed from JSON by jsmn_xxx().
+ * Nested structures are optional, so they're left out.
+ */
+static int
+json_field(const struct field *f)
+{
+
+	return f->type != FTYPE_STRUCT && !(f->flags & FIELD_NOEXPORT);
+}
+
+/*
+ * Parse a JSON object of "p" holding the values of row "i".
+ * The object is written before timing starts.
+ */
+static void
+gen_op_json(const struct config *cfg, const struct strct *p)
+{
+	const struct field	*f;
+	size_t			 pos, toks = 1, bufsz = 32;
+
+	gen_op_open("json", p, 0);
+	pos = 1;
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (!json_field(f))
+			continue;
+		if (f->type != FTYPE_BLOB)
+			gen_decl(f, pos, 1);
+		toks += 2;
+		bufsz += strlen(f->name) + 8;
+		switch (field_source(f)->type) {
+		case FTYPE_TEXT:
+		case FTYPE_PASSWORD:
+		case FTYPE_EMAIL:
+			bufsz += field_bufsz(field_source(f));
+			break;
+		default:
+			bufsz += 32;
+			break;
+		}
+		pos++;
+	}
+	printf("\tstruct %s p;\n"
+	       "\tjsmn_parser jp;\n"
+	       "\tjsmntok_t toks[%zu];\n"
+	       "\tchar buf[%zu];\n"
+	       "\tint rc;\n"
+	       "\n", p->name, toks, bufsz);
+
+	pos = 1;
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (!json_field(f))
+			continue;
+		if (f->type != FTYPE_BLOB)
+			gen_set(cfg, f, pos, NULL);
+		pos++;
+	}
+
+	/*
+	 * Write the object with one member per line, the last closing
+	 * the object.
+	 */
+
+	if (toks == 1)
+		puts("\tsnprintf(buf, sizeof(buf), \"{}\");");
+	else
+		printf("\tsnprintf(buf, sizeof(buf), \"{\"");
+	pos = 1;
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (!json_field(f))
+			continue;
+		printf("\n\t    \"\\\"%s\\\": ", f->name);
+		switch (field_source(f)->type) {
+		case FTYPE_TEXT:
+		case FTYPE_PASSWORD:
+		case FTYPE_EMAIL:
+			printf("\\\"%%s\\\"");
+			break;
+		case FTYPE_BLOB:
+			printf("\\\"b3J0LWMtYmVuY2ggYmxvYg==\\\"");
+			break;
+		case FTYPE_REAL:
+			printf("%%g");
+			break;
+		default:
+			printf("%%\" PRId64 \"");
+			break;
+		}
+		printf("%s\"", pos * 2 + 1 < toks ? ", " : "}");
+		pos++;
+	}
+	if (toks > 1) {
+		printf(",\n\t   ");
+		pos = 1;
+		TAILQ_FOREACH(f, &p->fq, entries) {
+			if (!json_field(f))
+				continue;
+			if (f->type != FTYPE_BLOB)
+				printf("%s v%zu", pos > 1 ? "," : "", pos);
+			pos++;
+		}
+		puts(");");
+	}
+
+	printf("\tmemset(&p, 0, sizeof(struct %s));\n"
+	       "\tclock_gettime(CLOCK_MONOTONIC, &t[0]);\n"
+	       "\tjsmn_init(&jp);\n"
+	       "\trc = jsmn_parse(&jp, buf, strlen(buf), toks, %zu);\n"
+	       "\tif (rc > 0)\n"
+	       "\t\trc = jsmn_%s(&p, buf, toks, rc);\n"
+	       "\tclock_gettime(CLOCK_MONOTONIC, &t[1]);\n"
+	       "\tjsmn_%s_clear(&p);\n"
+	       "\treturn rc > 0;\n"
+	       "}\n"
+	       "\n", p->name, toks, p->name, p->name);
+}
+
+/*
+ * Order structures so that those referenced by foreign keys precede
+ * those referencing them, except for cycles, which are taken in order
+ * of declaration.
+ * Returns the array of "sz" structures or NULL on memory exhaustion.
+ */
+static const struct strct **
+strct_order(const struct config *cfg, size_t *sz)
+{
+	const struct strct	 *p, **pa;
+	const struct field	 *f;
+	size_t			  i, j, n = 0;
+
+	TAILQ_FOREACH(p, &cfg->sq, entries)
+		n++;
+	if ((pa = calloc(n, sizeof(struct strct *))) == NULL)
+		return NULL;
+
+	for (*sz = 0; *sz < n; ) {
+		j = *sz;
+		TAILQ_FOREACH(p, &cfg->sq, entries) {
+			for (i = 0; i < *sz; i++)
+				if (pa[i] == p)
+					break;
+			if (i < *sz)
+				continue;
+			TAILQ_FOREACH(f, &p->fq, entries) {
+				if (f->type == FTYPE_STRUCT ||
+				    f->ref == NULL ||
+				    f->ref->target->parent == p)
+					continue;
+				for (i = 0; i < *sz; i++)
+					if (pa[i] == f->ref->target->parent)
+						break;
+				if (i == *sz)
+					break;
+			}
+			if (f == NULL)
+				pa[(*sz)++] = p;
+		}
+
+		/* Break a cycle with the first remaining. */
+
+		if (j == *sz)
+			TAILQ_FOREACH(p, &cfg->sq, entries) {
+				for (i = 0; i < *sz; i++)
+					if (pa[i] == p)
+						break;
+				if (i == *sz) {
+					pa[(*sz)++] = p;
+					break;
+				}
+			}
+	}
+	return pa;
+}
+
+/*
+ * Visit each benchmarked operation in the order run: inserts (with
+ * referenced structures first), searches, JSON parsing if
+ * "jsonparse", updates, then deletes (in reverse order of insertion).
+ * Deletes without constraints remove all rows, so they're run once,
+ * after the other deletes of their structure.
+ * Operations not permitted to the default role are run on a handle in
+ * a role permitted them; those permitted to no role are skipped.
+ * Depending upon "mode", either count operations or emit their
+ * functions or calls.
+ * Returns the number of operations.
+ */
+static size_t
+gen_ops(const struct config *cfg, const struct strct **pa, size_t pasz,
+	int jsonparse, enum opmode mode)
+{
+	const struct strct	*p;
+	const struct search	*s;
+	const struct update	*u;
+	size_t			 i, num, n = 0;
+	int			 all;
+
+	for (i = 0; i < pasz; i++) {
+		p = pa[i];
+		if (p->ins == NULL || !role_allowed(cfg, p->ins->rolemap))
+			continue;
+		n++;
+		if (mode == OP_FUNC)
+			gen_op_insert(cfg, p);
+		else if (mode == OP_CALL) {
+			gen_op_call("insert", p, 0,
+				role_run(cfg, p->ins->rolemap), 0);
+			print_name_db_insert(p);
+			puts("\");");
+		}
+	}
+
+	for (i = 0; i < pasz; i++) {
+		num = 0;
+		TAILQ_FOREACH(s, &pa[i]->sq, entries) {
+			num++;
+			if (!role_allowed(cfg, s->rolemap))
+				continue;
+			n++;
+			if (mode == OP_FUNC)
+				gen_op_search(cfg, s, num);
+			else if (mode == OP_CALL) {
+				gen_op_call("search", pa[i], num,
+					role_run(cfg, s->rolemap), 0);
+				print_name_db_search(s);
+				puts("\");");
+			}
+		}
+	}
+
+	for (i = 0; jsonparse && i < pasz; i++) {
+		n++;
+		if (mode == OP_FUNC)
+			gen_op_json(cfg, pa[i]);
+		else if (mode == OP_CALL) {
+			gen_op_call("json", pa[i], 0, NULL, 0);
+			printf("jsmn_%s\");\n", pa[i]->name);
+		}
+	}
+
+	for (i = 0; i < pasz; i++) {
+		num = 0;
+		TAILQ_FOREACH(u, &pa[i]->uq, entries) {
+			num++;
+			if (!role_allowed(cfg, u->rolemap))
+				continue;
+			n++;
+			if (mode == OP_FUNC)
+				gen_op_update(cfg, u, num);
+			else if (mode == OP_CALL) {
+				gen_op_call("update", pa[i], num,
+					role_run(cfg, u->rolemap), 0);
+				print_name_db_update(u);
+				puts("\");");
+			}
+		}
+	}
+
+	for (i = pasz; i > 0; i--)
+		for (all = 0; all < 2; all++) {
+			num = 0;
+			TAILQ_FOREACH(u, &pa[i - 1]->dq, entries) {
+				num++;
+				if (TAILQ_EMPTY(&u->crq) != all ||
+				    !role_allowed(cfg, u->rolemap))
+					continue;
+				n++;
+				if (mode == OP_FUNC)
+					gen_op_update(cfg, u, num);
+				else if (mode == OP_CALL) {
+					gen_op_call("delete", pa[i - 1],
+						num, role_run(cfg,
+						u->rolemap), all);
+					print_name_db_update(u);
+					puts("\");");
+				}
+			}
+		}
+
+	return n;
+}
+
+/*
+ * Emit the timing and reporting of operations.
+ */
+static void
+gen_run(void)
+{
+
+	print_commentt(0, COMMENT_C,
+		"Latencies of the current operation in microseconds.");
+	puts("static\tdouble *lat;\n");
+
+	puts("static int\n"
+	     "bench_cmp(const void *a, const void *b)\n"
+	     "{\n"
+	     "\tdouble x = *(const double *)a, "
+	      "y = *(const double *)b;\n"
+	     "\n"
+	     "\treturn x < y ? -1 : x > y;\n"
+	     "}\n");
+
+	print_commentt(0, COMMENT_C,
+		"Run \"fn\" \"runs\" times, then report its "
+		"operations per second, median and 99th percentile "
+		"latency, and the number of failed runs (e.g., on "
+		"constraint violation) as \"name\".");
+	puts("static void\n"
+	     "bench_run(struct ort *ctx, size_t runs,\n"
+	     "\tint (*fn)(struct ort *, size_t, struct timespec *),\n"
+	     "\tconst char *name)\n"
+	     "{\n"
+	     "\tstruct timespec t[2];\n"
+	     "\tdouble sum = 0.0;\n"
+	     "\tsize_t i, fails = 0;\n"
+	     "\n"
+	     "\tfor (i = 0; i < runs; i++) {\n"
+	     "\t\tif (!fn(ctx, i, t))\n"
+	     "\t\t\tfails++;\n"
+	     "\t\tlat[i] = (t[1].tv_sec - t[0].tv_sec) * 1e6 +\n"
+	     "\t\t    (t[1].tv_nsec - t[0].tv_nsec) / 1e3;\n"
+	     "\t\tsum += lat[i];\n"
+	     "\t}\n"
+	     "\tqsort(lat, runs, sizeof(double), bench_cmp);\n"
+	     "\tprintf(\"%-40s %10.0f %10.1f %10.1f %8zu\\n\", name,\n"
+	     "\t    sum > 0.0 ? runs / (sum / 1e6) : 0.0,\n"
+	     "\t    lat[(runs - 1) / 2], lat[(runs - 1) * 99 / 100], "
+	      "fails);\n"
+	     "}\n");
+}
+
+/*
+ * Emit main(), which creates the database from the schema, runs all
+ * operations, then removes it.
+ */
+static void
+gen_main(const struct config *cfg, const struct strct **pa,
+	size_t pasz, int jsonparse, int ops)
+{
+	size_t	 i;
+
+	puts("int\n"
+	     "main(int argc, char *argv[])\n"
+	     "{\n"
+	     "\tstruct ort *ctx;");
+	gen_roles(cfg, &cfg->rq, "\tstruct ort *ctx_%s;\n");
+	puts("\tstruct timespec t[2];\n"
+	     "\tdouble us;\n"
+	     "\tsqlite3 *db;\n"
+	     "\tFILE *f;\n"
+	     "\tchar path[] = \"/tmp/ort-c-bench.XXXXXX\";\n"
+	     "\tchar *sql = NULL, *er = NULL;\n"
+	     "\tsize_t sqlsz = 0;\n"
+	     "\tlong long n;\n"
+	     "\tint fd;\n"
+	     "\n"
+	     "\tif (argc < 2 || argc > 3) {\n"
+	     "\t\tfprintf(stderr, \"usage: %s schema [rows]\\n\", "
+	      "argv[0]);\n"
+	     "\t\treturn EXIT_FAILURE;\n"
+	     "\t}\n"
+	     "\tif (argc > 2) {\n"
+	     "\t\tif ((n = strtoll(argv[2], NULL, 10)) <= 0) {\n"
+	     "\t\t\tfprintf(stderr, \"%s: bad rows\\n\", argv[2]);\n"
+	     "\t\t\treturn EXIT_FAILURE;\n"
+	     "\t\t}\n"
+	     "\t\tnrows = n;\n"
+	     "\t}\n"
+	     "\n"
+	     "\tif ((f = fopen(argv[1], \"r\")) == NULL ||\n"
+	     "\t    getdelim(&sql, &sqlsz, '\\0', f) == -1) {\n"
+	     "\t\tperror(argv[1]);\n"
+	     "\t\treturn EXIT_FAILURE;\n"
+	     "\t}\n"
+	     "\tfclose(f);\n"
+	     "\n"
+	     "\tif ((fd = mkstemp(path)) == -1) {\n"
+	     "\t\tperror(path);\n"
+	     "\t\treturn EXIT_FAILURE;\n"
+	     "\t}\n"
+	     "\tclose(fd);\n"
+	     "\tif (sqlite3_open(path, &db) != SQLITE_OK ||\n"
+	     "\t    sqlite3_exec(db, sql, NULL, NULL, &er) != "
+	      "SQLITE_OK) {\n"
+	     "\t\tfprintf(stderr, \"%s: %s\\n\", argv[1],\n"
+	     "\t\t    er != NULL ? er : sqlite3_errmsg(db));\n"
+	     "\t\tunlink(path);\n"
+	     "\t\treturn EXIT_FAILURE;\n"
+	     "\t}\n"
+	     "\tsqlite3_close(db);\n"
+	     "\tfree(sql);\n"
+	     "\n"
+	     "\tclock_gettime(CLOCK_MONOTONIC, &t[0]);\n"
+	     "\tctx = db_open(path);\n"
+	     "\tclock_gettime(CLOCK_MONOTONIC, &t[1]);\n"
+	     "\tif (ctx == NULL) {\n"
+	     "\t\tfprintf(stderr, \"%s: db_open\\n\", path);\n"
+	     "\t\tunlink(path);\n"
+	     "\t\treturn EXIT_FAILURE;\n"
+	     "\t}\n"
+	     "\tus = (t[1].tv_sec - t[0].tv_sec) * 1e6 +\n"
+	     "\t    (t[1].tv_nsec - t[0].tv_nsec) / 1e3;");
+	gen_roles(cfg, &cfg->rq,
+		"\tif ((ctx_%s = db_open(path)) == NULL) {\n"
+		"\t\tfprintf(stderr, \"%%s: db_open\\n\", path);\n"
+		"\t\tunlink(path);\n"
+		"\t\treturn EXIT_FAILURE;\n"
+		"\t}\n"
+		"\tdb_role(ctx_%s, ROLE_%s);\n");
+	if (ops)
+		puts("\tif ((lat = calloc(nrows, sizeof(double))) == NULL) {\n"
+		     "\t\tperror(NULL);\n"
+		     "\t\texit(EXIT_FAILURE);\n"
+		     "\t}");
+	for (i = 0; i < pasz; i++)
+		if (strct_ids(cfg, pa[i]))
+			printf("\tif ((ids_%s = calloc(nrows, "
+				"sizeof(int64_t))) == NULL) {\n"
+			       "\t\tperror(NULL);\n"
+			       "\t\texit(EXIT_FAILURE);\n"
+			       "\t}\n", pa[i]->name);
+	puts("\n"
+	     "\tprintf(\"%-40s %10s %10s %10s %8s\\n\", \"function\",\n"
+	     "\t    \"ops/s\", \"p50 (us)\", \"p99 (us)\", \"failed\");\n"
+	     "\tprintf(\"%-40s %10.0f %10.1f %10.1f %8d\\n\", \"db_open\",\n"
+	     "\t    us > 0.0 ? 1e6 / us : 0.0, us, us, 0);");
+	gen_ops(cfg, pa, pasz, jsonparse, OP_CALL);
+	puts("\n"
+	     "\tdb_close(ctx);");
+	gen_roles(cfg, &cfg->rq, "\tdb_close(ctx_%s);\n");
+	puts("\tunlink(path);");
+	if (ops)
+		puts("\tfree(lat);");
+	for (i = 0; i < pasz; i++)
+		if (strct_ids(cfg, pa[i]))
+			printf("\tfree(ids_%s);\n", pa[i]->name);
+	puts("\treturn EXIT_SUCCESS;\n"
+	     "}");
+}
+
+static int
+gen_c_bench(const struct config *cfg, const char *header,
+	size_t rows, int jsonparse)
+{
+	const struct strct	**pa, *p;
+	size_t			  pasz, n = 0;
+	int			  ops;
+
+	if ((pa = strct_order(cfg, &pasz)) == NULL) {
+		warn(NULL);
+		return 0;
+	}
+
+	print_commentv(0, COMMENT_C,
+	       "WARNING: automatically generated by "
+	       "%s " VERSION ".\n"
+	       "DO NOT EDIT!", getprogname());
+
+#if defined(__linux__)
+	puts("#define _GNU_SOURCE\n"
+	     "#define _DEFAULT_SOURCE");
+#endif
+	puts("#include <sys/queue.h>\n"
+	     "\n"
+	     "#include <inttypes.h>\n"
+	     "#include <stdio.h>\n"
+	     "#include <stdint.h> /* int64_t */\n"
+	     "#include <stdlib.h>\n"
+	     "#include <string.h>\n"
+	     "#include <time.h>\n"
+	     "#include <unistd.h>\n"
+	     "\n"
+	     "#include <sqlite3.h>\n");
+	printf("#include \"%s\"\n"
+	       "\n", header);
+
+	print_commentt(0, COMMENT_C,
+		"Number of rows inserted and of runs of each "
+		"operation.");
+	printf("static\tsize_t nrows = %zu;\n\n", rows);
+
+	TAILQ_FOREACH(p, &cfg->sq, entries)
+		if (strct_ids(cfg, p)) {
+			if (n++ == 0)
+				print_commentt(0, COMMENT_C,
+					"Rowids of inserted rows.");
+			printf("static\tint64_t *ids_%s;\n", p->name);
+		}
+	if (n > 0)
+		puts("");
+
+	TAILQ_FOREACH(p, &cfg->sq, entries)
+		if (strct_iterated(cfg, p))
+			printf("static void\n"
+			       "bench_%s_cb(const struct %s *p, "
+			        "void *arg)\n"
+			       "{\n"
+			       "\n"
+			       "\t/* Do nothing. */\n"
+			       "}\n"
+			       "\n", p->name, p->name);
+
+	ops = gen_ops(cfg, pa, pasz, jsonparse, OP_COUNT) > 0;
+	if (ops) {
+		gen_run();
+		gen_ops(cfg, pa, pasz, jsonparse, OP_FUNC);
+	}
+	gen_main(cfg, pa, pasz, jsonparse, ops);
+	free(pa);
+	return 1;
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char	 *header = "db.h", *er;
+	struct config	 *cfg = NULL;
+	int		  c, jsonparse = 0, rc = 0;
+	FILE		**confs = NULL;
+	size_t		  i, confsz, rows = 1000;
+	long long	  n;
+
+#if HAVE_PLEDGE
+	if (pledge("stdio rpath", NULL) == -1)
+		err(EXIT_FAILURE, "pledge");
+#endif
+
+	while ((c = getopt(argc, argv, "h:Jn:")) != -1)
+		switch (c) {
+		case 'h':
+			header = optarg;
+			break;
+		case 'J':
+			jsonparse = 1;
+			break;
+		case 'n':
+			n = strtonum(optarg, 1, LLONG_MAX, &er);
+			if (er != NULL)
+				errx(EXIT_FAILURE, "-n %s: %s", optarg, er);
+			rows = n;
+			break;
+		default:
+			goto usage;
+		}
+
+	argc -= optind;
+	argv += optind;
+	confsz = (size_t)argc;
+
+	/* Read in all of our files now so we can repledge. */
+
+	if (confsz > 0) {
+		if ((confs = calloc(confsz, sizeof(FILE *))) == NULL)
+			err(EXIT_FAILURE, NULL);
+		for (i = 0; i < confsz; i++)
+			if ((confs[i] = fopen(argv[i], "r")) == NULL)
+				err(EXIT_FAILURE, "%s", argv[i]);
+	}
+
+#if HAVE_PLEDGE
+	if (pledge("stdio", NULL) == -1)
+		err(EXIT_FAILURE, "pledge");
+#endif
+
+	if ((cfg = ort_config_alloc()) == NULL)
+		goto out;
+
+	for (i = 0; i < confsz; i++)
+		if (!ort_parse_file_r(cfg, confs[i], argv[i]))
+			goto out;
+
+	if (confsz == 0 &&
+	    !ort_parse_file_r(cfg, stdin, "<stdin>"))
+		goto out;
+
+	if ((rc = ort_parse_close(cfg)))
+		rc = gen_c_bench(cfg, header, rows, jsonparse);
+
+out:
+	for (i = 0; i < confsz; i++)
+		if (fclose(confs[i]) == EOF)
+			warn("%s: close", argv[i]);
+	free(confs);
+	ort_config_free(cfg);
+	return rc ? EXIT_SUCCESS : EXIT_FAILURE;
+usage:
+	fprintf(stderr,
+		"usage: %s "
+		"[-J] "
+		"[-h header] "
+		"[-n rows] "
+		"[config...]\n",
+		getprogname());
+	return EXIT_FAILURE;
+}
@@ -49,6 +49,7 @@ static	const char *const optypes[OPTYPE__MAX] = {
 	"logical or", /* OPTYPE_OR */
 	"string equals", /* OPTYPE_STREQ */
 	"string does not equal", /* OPTYPE_STRNEQ */
+	"in the given array", /* OPTYPE_IN */
 	/* Unary types... */
 	"is null", /* OPTYPE_ISNULL */
 	"is not null" /* OPTYPE_NOTNULL */
@@ -113,6 +114,84 @@ gen_strct_field(const struct field *p)
 	}
 }
 
+/*
+ * Whether db_xxx_insert_many() is generated for "p", which requires an
+ * insert statement with at least one column to insert.
+ */
+static int
+has_insert_many(const struct strct *p)
+{
+	const struct field *f;
+
+	if (p->ins == NULL)
+		return 0;
+	TAILQ_FOREACH(f, &p->fq, entries)
+		if (f->type != FTYPE_STRUCT &&
+		    !(f->flags & FIELD_ROWID))
+			return 1;
+	return 0;
+}
+
+/*
+ * Generate the per-row argument structure of db_xxx_insert_many(),
+ * which has the same members (and pointer-ness) as the arguments to
+ * db_xxx_insert().
+ */
+static void
+gen_struct_insert_args(const struct strct *p)
+{
+	const struct field *f;
+	const char	   *ptr;
+
+	print_commentv(0, COMMENT_C,
+		"A single row for db_%s_insert_many().\n"
+		"Members are as for the arguments of "
+		"db_%s_insert().", p->name, p->name);
+	printf("struct\t%s_insert_args {\n", p->name);
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (f->type == FTYPE_STRUCT ||
+		    (f->flags & FIELD_ROWID))
+			continue;
+		ptr = (f->flags & FIELD_NULL) ? "*" : " ";
+		switch (f->type) {
+		case FTYPE_REAL:
+			printf("\tdouble\t%s%s;\n", ptr, f->name);
+			break;
+		case FTYPE_BLOB:
+			printf("\tconst void\t*%s%s;\n"
+			       "\tsize_t\t %s_sz;\n",
+			       (f->flags & FIELD_NULL) ? "*" : "",
+			       f->name, f->name);
+			break;
+		case FTYPE_DATE:
+		case FTYPE_EPOCH:
+			printf("\ttime_t\t%s%s;\n", ptr, f->name);
+			break;
+		case FTYPE_BIT:
+		case FTYPE_BITFIELD:
+		case FTYPE_INT:
+			printf("\tint64_t\t%s%s;\n", ptr, f->name);
+			break;
+		case FTYPE_TEXT:
+		case FTYPE_EMAIL:
+		case FTYPE_PASSWORD:
+			printf("\tconst char\t*%s%s;\n",
+			       (f->flags & FIELD_NULL) ? "*" : "",
+			       f->name);
+			break;
+		case FTYPE_ENUM:
+			printf("\tenum %s %s%s;\n", f->enm->name,
+			       (f->flags & FIELD_NULL) ? "*" : "",
+			       f->name);
+			break;
+		default:
+			break;
+		}
+	}
+	puts("};\n"
+	     "");
+}
+
 static void
 gen_bitfield(const struct bitf *b)
 {
@@ -219,8 +298,19 @@ gen_struct(const struct config *cfg, const struct strct *p)
 		print_commentv(0, COMMENT_C, 
 			"Queue of %s for listings.", p->name);
 		printf("TAILQ_HEAD(%s_q, %s);\n\n", p->name, p->name);
+		print_commentv(0, COMMENT_C, 
+			"Contiguous array of %s for listings.", p->name);
+		printf("struct\t%s_array {\n", p->name);
+		print_commentt(1, COMMENT_C, "Rows in query order.");
+		printf("\tstruct %s *rows;\n", p->name);
+		print_commentt(1, COMMENT_C, "Number of rows.");
+		puts("\tsize_t len;\n"
+		     "};\n");
 	}
 
+	if (has_insert_many(p))
+		gen_struct_insert_args(p);
+
 	if (STRCT_HAS_ITERATOR & p->flags) {
 		print_commentv(0, COMMENT_C, 
 			"Callback of %s for iteration.\n"
@@ -233,6 +323,25 @@ gen_struct(const struct config *cfg, const struct strct *p)
 	}
 }
 
+/*
+ * Document that the row returned by an insert or update of "p" doesn't
+ * fill its nested structures, if it has any.
+ */
+static void
+gen_func_returning(const struct strct *p)
+{
+	const struct field *f;
+
+	TAILQ_FOREACH(f, &p->fq, entries)
+		if (FTYPE_STRUCT == f->type)
+			break;
+	if (NULL != f)
+		print_commentt(0, COMMENT_C_FRAG,
+			"Nested structures are zeroed, so the "
+			"result should not be passed to the JSON "
+			"output functions.");
+}
+
 /*
  * Generate update/delete functions for a structure.
  */
@@ -295,6 +404,21 @@ gen_func_update(const struct config *cfg, const struct update *up)
 		"non-zero on success.");
 	print_func_db_update(up, 1);
 	puts("");
+
+	if (!(up->flags & UPDATE_RETURNING))
+		return;
+
+	print_commentt(0, COMMENT_C_FRAG_OPEN,
+		"Like the above, but also returns the updated row "
+		"from the same statement.");
+	gen_func_returning(up->parent);
+	print_commentv(0, COMMENT_C_FRAG_CLOSE,
+		"Returns the first updated row or NULL on "
+		"constraint violation or if no rows were updated.\n"
+		"Free the pointer with db_%s_free().",
+		up->parent->name);
+	print_func_db_update_returning(up, 1);
+	puts("");
 }
 
 /*
@@ -304,6 +428,7 @@ static void
 gen_func_search(const struct config *cfg, const struct search *s)
 {
 	const struct sent  *sent;
+	const struct proj  *pr;
 	const struct strct *rc;
 	size_t	 	    pos = 1;
 
@@ -346,12 +471,6 @@ gen_func_search(const struct config *cfg, const struct search *s)
 			"invoke any database modifications or risk "
 			"deadlock.");
 
-	if ((rc->flags & STRCT_HAS_NULLREFS))
-		print_commentt(0, COMMENT_C_FRAG,
-			"This search involves nested null structure "
-			"linking, which involves multiple database "
-			"calls per invocation.\n"
-			"Use this sparingly!");
 	print_commentv(0, COMMENT_C_FRAG,
 		"Queries on the following fields in struct %s:",
 		s->parent->name);
@@ -373,6 +492,25 @@ gen_func_search(const struct config *cfg, const struct search *s)
 				"pre-hashed password, " : "",
 				optypes[sent->op]);
 
+	if (!TAILQ_EMPTY(&s->projq)) {
+		print_commentt(0, COMMENT_C_FRAG,
+			"Only the following fields are filled in, "
+			"with all others (including nested "
+			"structures) zeroed, so results should be "
+			"written as JSON with the \"_data\" function "
+			"of the same name with the \"json\" prefix:");
+		TAILQ_FOREACH(pr, &s->projq, entries)
+			print_commentv(0, COMMENT_C_FRAG,
+				"\t%s", pr->field->name);
+	}
+
+	if (s->flags & SEARCH_LIMIT_BOUND)
+		print_commentt(0, COMMENT_C_FRAG,
+			"\tlimit: maximum number of results");
+	if (s->flags & SEARCH_OFFSET_BOUND)
+		print_commentt(0, COMMENT_C_FRAG,
+			"\toffset: number of results to skip");
+
 	if (s->type == STYPE_SEARCH)
 		print_commentv(0, COMMENT_C_FRAG_CLOSE,
 			"Returns a pointer or NULL on fail.\n"
@@ -395,24 +533,125 @@ gen_func_search(const struct config *cfg, const struct search *s)
 	puts("");
 }
 
+/*
+ * Generate the contiguous array variant of a list function
+ * declaration.
+ * The parameters are documented with the queue variant.
+ */
+static void
+gen_func_search_array(const struct search *s, int arena)
+{
+	const struct strct *rc;
+
+	rc = s->dst != NULL ? s->dst->strct : s->parent;
+
+	print_commentt(0, COMMENT_C_FRAG_OPEN,
+		"As the function above, but returns rows in a "
+		"single contiguous array instead of a queue.");
+	if (arena)
+		print_commentt(0, COMMENT_C_FRAG_CLOSE,
+			"Always returns an array pointer.\n"
+			"It is owned by the result arena: see "
+			"db_arena_release().");
+	else
+		print_commentv(0, COMMENT_C_FRAG_CLOSE,
+			"Always returns an array pointer.\n"
+			"Free this with db_%s_freearray().", rc->name);
+	print_func_db_search_array(s, 1);
+	puts("");
+}
+
+/*
+ * Generate the keyset pagination variant of a list or iterate function
+ * declaration.
+ * The search parameters are documented with the plain variant.
+ */
+static void
+gen_func_search_after(const struct search *s)
+{
+	const struct sent  *sent;
+	const struct ord   *ord;
+	size_t	 	    pos = 1;
+
+	TAILQ_FOREACH(sent, &s->sntq, entries)
+		if (OPTYPE_ISBINARY(sent->op))
+			pos++;
+
+	print_commentv(0, COMMENT_C_FRAG_OPEN,
+		"Page through the results of the %s search on "
+		"struct %s with the same query arguments, "
+		"at most \"limit\" rows at a time.",
+		s->type == STYPE_LIST ? "list" : "iterate",
+		s->parent->name);
+	if ((ord = TAILQ_FIRST(&s->ordq)) != NULL)
+		print_commentv(0, COMMENT_C_FRAG,
+			"\tv%zu: %s of the last row of the "
+			"previous page", pos++, ord->fname);
+	print_commentv(0, COMMENT_C_FRAG,
+		"\tv%zu: %s of the last row of the "
+		"previous page, or <=0 for the first page",
+		pos, s->parent->rowid->name);
+	print_commentt(0, COMMENT_C_FRAG_CLOSE,
+		"Rows are ordered by any ordering term then by "
+		"row identifier, so pages are stable under "
+		"concurrent insertion.\n"
+		"Results are returned as for the plain variant.");
+	print_func_db_search_after(s, 1);
+	puts("");
+}
+
+/*
+ * Generate the borrowed-row variant of an iterate function declaration.
+ * The parameters are documented with the plain variant.
+ */
+static void
+gen_func_search_borrow(const struct search *s)
+{
+
+	print_commentt(0, COMMENT_C,
+		"Like the iterate function of the same name without "
+		"the \"_borrow\" suffix, but the row passed to the "
+		"callback points directly into the database result "
+		"and nothing is allocated per row.\n"
+		"Its strings and blobs are valid only during the "
+		"callback, and it must not be freed or kept.");
+	print_func_db_search_borrow(s, 1);
+	puts("");
+}
+
 /*
  * Generate the function declarations for a given structure.
+ * If "arena" is set, objects are owned by the result arena.
  */
 static void
-gen_funcs_dbin(const struct config *cfg, const struct strct *p)
+gen_funcs_dbin(const struct config *cfg, const struct strct *p,
+	int arena)
 {
 	const struct search *s;
 	const struct field *f;
 	const struct update *u;
 	size_t	 pos;
 
-	print_commentt(0, COMMENT_C,
-	       "Clear resources and free \"p\".\n"
-	       "Has no effect if \"p\" is NULL.");
+	if (arena)
+		print_commentt(0, COMMENT_C,
+		       "Has no effect: \"p\" is owned by the "
+		       "result arena.\n"
+		       "See db_arena_release().");
+	else
+		print_commentt(0, COMMENT_C,
+		       "Clear resources and free \"p\".\n"
+		       "Has no effect if \"p\" is NULL.");
 	print_func_db_free(p, 1);
 	puts("");
 
-	if (STRCT_HAS_QUEUE & p->flags) {
+	if ((STRCT_HAS_QUEUE & p->flags) && arena) {
+		print_commentt(0, COMMENT_C,
+		     "Has no effect: \"q\" is owned by the "
+		     "result arena.\n"
+		     "See db_arena_release().");
+		print_func_db_freeq(p, 1);
+		puts("");
+	} else if (STRCT_HAS_QUEUE & p->flags) {
 		print_commentv(0, COMMENT_C,
 		     "Unfill and free all queue members.\n"
 		     "Has no effect if \"q\" is NULL.");
@@ -420,6 +659,21 @@ gen_funcs_dbin(const struct config *cfg, const struct strct *p)
 		puts("");
 	}
 
+	if ((STRCT_HAS_QUEUE & p->flags) && arena) {
+		print_commentt(0, COMMENT_C,
+		     "Has no effect: \"a\" is owned by the "
+		     "result arena.\n"
+		     "See db_arena_release().");
+		print_func_db_freearray(p, 1);
+		puts("");
+	} else if (STRCT_HAS_QUEUE & p->flags) {
+		print_commentv(0, COMMENT_C,
+		     "Unfill and free all array members.\n"
+		     "Has no effect if \"a\" is NULL.");
+		print_func_db_freearray(p, 1);
+		puts("");
+	}
+
 	if (NULL != p->ins) {
 		print_commentt(0, COMMENT_C_FRAG_OPEN,
 			"Insert a new row into the database.\n"
@@ -446,8 +700,77 @@ gen_funcs_dbin(const struct config *cfg, const struct strct *p)
 		puts("");
 	}
 
-	TAILQ_FOREACH(s, &p->sq, entries)
+	if (NULL != p->ins && (INSERT_RETURNING & p->ins->flags)) {
+		print_commentt(0, COMMENT_C_FRAG_OPEN,
+			"Like the above, but returns the new row, "
+			"including default values, from the same "
+			"statement.");
+		gen_func_returning(p);
+		print_commentv(0, COMMENT_C_FRAG_CLOSE,
+			"Returns a pointer or NULL on constraint "
+			"violation.\n"
+			"Free the pointer with db_%s_free().",
+			p->name);
+		print_func_db_insert_returning(p, 1);
+		puts("");
+	}
+
+	if (has_insert_many(p)) {
+		print_commentv(0, COMMENT_C,
+			"Insert \"n\" rows from \"rows\" within a "
+			"single transaction, reusing one prepared "
+			"statement.\n"
+			"This must not be called within an open "
+			"transaction.\n"
+			"If \"ids\" is not NULL, it is filled with the "
+			"\"n\" new row identifiers.\n"
+			"Returns zero on constraint failure, in which "
+			"case no rows are inserted, or non-zero on "
+			"success.");
+		print_func_db_insert_many(p, 1);
+		puts("");
+	}
+
+	if (NULL != p->ups) {
+		print_commentt(0, COMMENT_C_FRAG_OPEN,
+			"Insert a new row into the database or, if "
+			"one exists with the same conflict fields, "
+			"update its other fields instead.\n"
+			"Only native fields may be set, including "
+			"the rowid only if it's the conflict "
+			"field.");
+		pos = 1;
+		TAILQ_FOREACH(f, &p->fq, entries) {
+			if (FTYPE_STRUCT == f->type ||
+			    ((FIELD_ROWID & f->flags) &&
+			     !(UPSERT_ROWID & p->ups->flags)))
+				continue;
+			if (FTYPE_PASSWORD == f->type) 
+				print_commentv(0, COMMENT_C_FRAG,
+					"\tv%zu: %s (pre-hashed password)", 
+					pos++, f->name);
+			else
+				print_commentv(0, COMMENT_C_FRAG,
+					"\tv%zu: %s", 
+					pos++, f->name);
+		}
+		print_commentt(0, COMMENT_C_FRAG_CLOSE,
+			"Returns the inserted or updated row's "
+			"identifier on success or <0 on constraint "
+			"violation.");
+		print_func_db_upsert(p, 1);
+		puts("");
+	}
+
+	TAILQ_FOREACH(s, &p->sq, entries) {
 		gen_func_search(cfg, s);
+		if (s->type == STYPE_LIST)
+			gen_func_search_array(s, arena);
+		if (s->flags & SEARCH_PAGINATE)
+			gen_func_search_after(s);
+		if (s->type == STYPE_ITERATE)
+			gen_func_search_borrow(s);
+	}
 	TAILQ_FOREACH(u, &p->uq, entries)
 		gen_func_update(cfg, u);
 	TAILQ_FOREACH(u, &p->dq, entries)
@@ -495,8 +818,9 @@ gen_funcs_json_parse(const struct config *cfg, const struct strct *p)
 }
 
 static void
-gen_funcs_json(const struct config *cfg, const struct strct *p)
+gen_funcs_json(const struct config *cfg, const struct strct *p, int dbin)
 {
+	const struct search	*s;
 
 	print_commentv(0, COMMENT_C,
 		"Print out the fields of a %s in JSON "
@@ -524,6 +848,14 @@ gen_funcs_json(const struct config *cfg, const struct strct *p)
 			p->name, p->name);
 		print_func_json_array(p, 1);
 		puts("");
+		print_commentv(0, COMMENT_C,
+			"Like json_%s_array(), but for the "
+			"contiguous array:\n"
+			"\t\"%s_q\" : [ [{data}]+ ]\n"
+			"See json_%s_data() for the data.",
+			p->name, p->name, p->name);
+		print_func_json_rows(p, 1);
+		puts("");
 	}
 	if (STRCT_HAS_ITERATOR & p->flags) {
 		print_commentv(0, COMMENT_C,
@@ -537,6 +869,35 @@ gen_funcs_json(const struct config *cfg, const struct strct *p)
 		print_func_json_iterate(p, 1);
 		puts("");
 	}
+	if (!dbin)
+		return;
+	TAILQ_FOREACH(s, &p->sq, entries) {
+		if (s->type != STYPE_ITERATE || s->dst != NULL ||
+		    !TAILQ_EMPTY(&s->projq))
+			continue;
+		print_commentv(0, COMMENT_C,
+			"Like the iterate function of the same name "
+			"without the \"_json\" suffix, but writes each "
+			"row directly into the current JSON array as "
+			"with json_%s_iterate().\n"
+			"Rows are borrowed as for the \"_borrow\" "
+			"variant, so nothing is allocated per row.", 
+			p->name);
+		print_func_db_search_json(s, 1);
+		puts("");
+	}
+	TAILQ_FOREACH(s, &p->sq, entries) {
+		if (TAILQ_EMPTY(&s->projq))
+			continue;
+		print_commentv(0, COMMENT_C,
+			"Like json_%s_data(), but only writes the "
+			"fields filled in by the search of the same "
+			"name (with the \"db\" prefix and without the "
+			"\"_data\" suffix), which has a projection.",
+			p->name);
+		print_func_json_search_data(s, 1);
+		puts("");
+	}
 }
 
 static void
@@ -605,6 +966,10 @@ gen_func_trans(const struct config *cfg)
 	     	"\tdb_trans_open((_ctx), (_id), 0)\n"
 	     "#define DB_TRANS_OPEN_EXCLUSIVE(_ctx, _id)\\\n"
 	        "\tdb_trans_open((_ctx), (_id), -1)\n");
+	print_commentt(0, COMMENT_C,
+		"Transaction identifier reserved for the "
+		"db_xxx_insert_many() functions.");
+	puts("#define DB_TRANS_INSERT_MANY ((size_t)-1)\n");
 	print_commentt(0, COMMENT_C,
 		"Roll-back an open transaction.");
 	print_func_db_trans_rollback(1);
@@ -648,6 +1013,7 @@ gen_func_open(const struct config *cfg)
 		"memory exhaustion.\n"
 		"The returned pointer must be closed with "
 		"db_close().\n"
+		"It may be used by only one thread at a time.\n"
 		"See db_open_logging() for the equivalent "
 		"function that accepts logging callbacks.\n"
 		"This function starts a child with fork(), "
@@ -674,6 +1040,161 @@ gen_func_open(const struct config *cfg)
 		"after initialisation.");
 	print_func_db_open_logging(1);
 	puts("");
+	print_commentt(0, COMMENT_C,
+		"Like db_open() but also opens \"rofile\" as a "
+		"read-only source, which may be NULL to behave as "
+		"db_open().\n"
+		"Searches then read from \"rofile\" while "
+		"inserts, updates, and deletes write to \"file\".\n"
+		"Searches within a transaction read from \"file\" "
+		"so that they see its writes.\n"
+		"The database must be in write-ahead logging mode "
+		"(see the \"journal\" database setting): it is not "
+		"set here, and with a rollback journal the separate "
+		"reader and writer block each other, so reads may "
+		"fail while a write is committing.");
+	print_func_db_open_split(1);
+	puts("");
+	print_commentt(0, COMMENT_C,
+		"Like db_open_split() but accepts logging functions "
+		"as does db_open_logging().");
+	print_func_db_open_split_logging(1);
+	puts("");
+}
+
+/*
+ * The connection pool declared when "pool" mode is enabled.
+ */
+static void
+gen_func_pool(const struct config *cfg, int arena)
+{
+
+	print_commentt(0, COMMENT_C,
+		"Open a pool of \"n\" handles to the database "
+		"in \"file\" for use by multiple threads.\n"
+		"All handles share one configuration and are opened "
+		"immediately, each forking its own sqlbox child.\n"
+		"Pooled handles have no read-only source (see "
+		"db_open_split()) and no logging functions (see "
+		"db_open_logging()).\n"
+		"Returns NULL if \"n\" is zero or on failure to "
+		"allocate or open any handle.\n"
+		"The pool must be closed with db_pool_close().");
+	print_func_db_pool_open(1);
+	puts("");
+	if (!TAILQ_EMPTY(&cfg->rq)) {
+		print_commentt(0, COMMENT_C,
+			"Take an idle handle in role \"r\" from "
+			"\"pool\", blocking until one is released if "
+			"none are idle.\n"
+			"The handle may only be used by the calling thread "
+			"until it's returned with db_pool_release().\n"
+			"It must not be closed with db_close().\n"
+			"Handles released in \"r\" are preferred, then "
+			"those in the default role, which are moved into "
+			"\"r\" with db_role().\n"
+			"Otherwise, a handle closed on release or released "
+			"in another role is re-opened, forking a new sqlbox "
+			"child from the calling thread.\n"
+			"Returns NULL on failure to re-open a handle.");
+		print_func_db_pool_acquire_role(1);
+		puts("");
+		print_commentt(0, COMMENT_C,
+			"Like db_pool_acquire_role() with the default "
+			"role.\n"
+			"Returns NULL on failure to re-open a handle.");
+	} else
+		print_commentt(0, COMMENT_C,
+			"Take an idle handle from \"pool\", blocking until "
+			"one is released if none are idle.\n"
+			"The handle may only be used by the calling thread "
+			"until it's returned with db_pool_release().\n"
+			"It must not be closed with db_close().\n"
+			"If it was closed on release, it's re-opened, "
+			"forking a new sqlbox child from the calling "
+			"thread.\n"
+			"Returns NULL on failure to re-open a handle.");
+	print_func_db_pool_acquire(1);
+	puts("");
+	if (!TAILQ_EMPTY(&cfg->rq) && arena)
+		print_commentt(0, COMMENT_C,
+			"Return \"ctx\", acquired from \"pool\", to "
+			"the pool.\n"
+			"Its result arena is reset, so objects allocated "
+			"from it must no longer be used.\n"
+			"Its cached statements not stepped until done "
+			"are finalised.\n"
+			"It's kept in its role for acquiring that role "
+			"again (see db_pool_acquire_role()).\n"
+			"If a transaction is open, it's closed instead and "
+			"re-opened when next acquired.");
+	else if (!TAILQ_EMPTY(&cfg->rq))
+		print_commentt(0, COMMENT_C,
+			"Return \"ctx\", acquired from \"pool\", to "
+			"the pool.\n"
+			"Its cached statements not stepped until done "
+			"are finalised.\n"
+			"It's kept in its role for acquiring that role "
+			"again (see db_pool_acquire_role()).\n"
+			"If a transaction is open, it's closed instead and "
+			"re-opened when next acquired.");
+	else if (arena)
+		print_commentt(0, COMMENT_C,
+			"Return \"ctx\", acquired from \"pool\", to "
+			"the pool.\n"
+			"Its result arena is reset, so objects allocated "
+			"from it must no longer be used.\n"
+			"Its cached statements not stepped until done "
+			"are finalised.\n"
+			"If a transaction is open, it's closed instead and "
+			"re-opened when next acquired.");
+	else
+		print_commentt(0, COMMENT_C,
+			"Return \"ctx\", acquired from \"pool\", to "
+			"the pool.\n"
+			"Its cached statements not stepped until done "
+			"are finalised.\n"
+			"If a transaction is open, it's closed instead and "
+			"re-opened when next acquired.");
+	print_func_db_pool_release(1);
+	puts("");
+	print_commentt(0, COMMENT_C,
+		"Close all handles of \"pool\" and free it.\n"
+		"All acquired handles must have been released, "
+		"which is asserted.\n"
+		"Has no effect if \"pool\" is NULL.");
+	print_func_db_pool_close(1);
+	puts("");
+}
+
+/*
+ * The per-statement statistics declared when "stats" mode is enabled.
+ */
+static void
+gen_func_stats(void)
+{
+
+	print_commentt(0, COMMENT_C,
+		"Get the statistics of the statement numbered \"i\", "
+		"starting from zero, into \"out\".\n"
+		"Returns zero if \"i\" is past the last statement, "
+		"so all statements may be listed by incrementing "
+		"\"i\" until then.");
+	print_func_db_stats_get(1);
+	puts("");
+
+	print_commentt(0, COMMENT_C,
+		"Zero the statistics of all statements.");
+	print_func_db_stats_reset(1);
+	puts("");
+
+	print_commentt(0, COMMENT_C,
+		"Invoke \"cb\" with the SQL, its latency in "
+		"microseconds, and \"arg\" after each statement "
+		"taking at least \"usec\" microseconds.\n"
+		"Pass a NULL \"cb\" to disable.");
+	print_func_db_stats_slow(1);
+	puts("");
 }
 
 static void
@@ -717,6 +1238,50 @@ gen_func_close(const struct config *cfg)
 		"Has no effect if \"p\" is NULL.");
 	print_func_db_close(1);
 	puts("");
+
+	print_commentt(0, COMMENT_C,
+		"Get the number of query statements re-used from "
+		"the statement cache (\"hits\") and prepared into it "
+		"(\"misses\") since db_open().\n"
+		"Either pointer may be NULL.");
+	print_func_db_stmt_cache_stats(1);
+	puts("");
+}
+
+/*
+ * The result arena replaces per-object allocation for query results
+ * (including nested strings and blobs), so release is by position
+ * instead of by object.
+ */
+static void
+gen_func_arena(const struct config *cfg)
+{
+
+	print_commentt(0, COMMENT_C,
+		"Get the current position in the result arena, "
+		"from which all objects returned by queries are "
+		"allocated.\n"
+		"Pass this to db_arena_release() to free all "
+		"objects allocated after this point.");
+	print_func_db_arena_mark(1);
+	puts("");
+	print_commentt(0, COMMENT_C,
+		"Release all objects allocated after \"mark\", "
+		"which must have been returned by db_arena_mark() "
+		"and not already been released.\n"
+		"Objects allocated before \"mark\" remain valid.\n"
+		"During an iterator callback, the current row is "
+		"released after the callback returns unless the "
+		"callback has itself allocated from the arena.");
+	print_func_db_arena_release(1);
+	puts("");
+	print_commentt(0, COMMENT_C,
+		"Release all objects in the result arena.\n"
+		"Memory is kept for re-use, making this suitable "
+		"for calling between requests.\n"
+		"The arena is freed with db_close().");
+	print_func_db_arena_reset(1);
+	puts("");
 }
 
 /*
@@ -760,7 +1325,8 @@ gen_role(const struct role *r, int *nf)
  */
 static void
 gen_c_header(const struct config *cfg, const char *guard, int json, 
-	int jsonparse, int valids, int dbin, int dstruct)
+	int jsonparse, int valids, int dbin, int dstruct, int arena,
+	int pool, int stats)
 {
 	const struct strct *p;
 	const struct enm *e;
@@ -800,6 +1366,28 @@ gen_c_header(const struct config *cfg, const char *guard, int json,
 		     "");
 	}
 
+	if (dbin && stats) {
+		puts("#define\tORT_STATS_BUCKETS 32\n");
+		print_commentt(0, COMMENT_C,
+			"Statistics of one statement since db_open() or "
+			"db_stats_reset().\n"
+			"Latencies are in microseconds and cover only "
+			"binding and stepping the statement, not "
+			"filling results or iterator callbacks.\n"
+			"The histogram bucket \"hist[n]\" counts runs "
+			"taking less than 2^n microseconds (and at least "
+			"2^(n-1)), the last collecting all longer runs.");
+		puts("struct\tort_stmt_stats {\n"
+		     "\tconst char *name;\n"
+		     "\tconst char *sql;\n"
+		     "\tuint64_t calls;\n"
+		     "\tuint64_t rows;\n"
+		     "\tuint64_t total;\n"
+		     "\tuint64_t max;\n"
+		     "\tuint64_t hist[ORT_STATS_BUCKETS];\n"
+		     "};\n");
+	}
+
 	if (dstruct) {
 		TAILQ_FOREACH(e, &cfg->eq, entries)
 			gen_enum(e);
@@ -883,15 +1471,21 @@ gen_c_header(const struct config *cfg, const char *guard, int json,
 		gen_func_open(cfg);
 		gen_func_trans(cfg);
 		gen_func_close(cfg);
+		if (arena)
+			gen_func_arena(cfg);
+		if (pool)
+			gen_func_pool(cfg, arena);
+		if (stats)
+			gen_func_stats();
 		if (!TAILQ_EMPTY(&cfg->rq))
 			gen_func_roles(cfg);
 		TAILQ_FOREACH(p, &cfg->sq, entries)
-			gen_funcs_dbin(cfg, p);
+			gen_funcs_dbin(cfg, p, arena);
 	}
 
 	if (json)
 		TAILQ_FOREACH(p, &cfg->sq, entries)
-			gen_funcs_json(cfg, p);
+			gen_funcs_json(cfg, p, dbin);
 	if (jsonparse) {
 		print_commentt(0, COMMENT_C,
 			"Check whether the current token in a "
@@ -940,7 +1534,8 @@ main(int argc, char *argv[])
 	struct config	 *cfg = NULL;
 	int		  c, json = 0, valids = 0, rc = 0,
 			  dbin = 1, dstruct = 1,
-			  jsonparse = 0;
+			  jsonparse = 0, arena = 0, pool = 0,
+			  stats = 0;
 	FILE		**confs = NULL;
 	size_t		  i, confsz;
 
@@ -949,8 +1544,11 @@ main(int argc, char *argv[])
 		err(EXIT_FAILURE, "pledge");
 #endif
 
-	while (-1 != (c = getopt(argc, argv, "g:jJN:sv")))
+	while (-1 != (c = getopt(argc, argv, "Ag:jJN:PsTv")))
 		switch (c) {
+		case ('A'):
+			arena = 1;
+			break;
 		case ('g'):
 			guard = optarg;
 			break;
@@ -966,9 +1564,15 @@ main(int argc, char *argv[])
 			if (NULL != strchr(optarg, 'd'))
 				dbin = 0;
 			break;
+		case ('P'):
+			pool = 1;
+			break;
 		case ('s'):
 			/* Ignore. */
 			break;
+		case ('T'):
+			stats = 1;
+			break;
 		case ('v'):
 			valids = 1;
 			break;
@@ -1012,7 +1616,7 @@ main(int argc, char *argv[])
 
 	if (0 != (rc = ort_parse_close(cfg)))
 		gen_c_header(cfg, guard, json, jsonparse,
-			valids, dbin, dstruct);
+			valids, dbin, dstruct, arena, pool, stats);
 
 out:
 	for (i = 0; i < confsz; i++)
@@ -1024,7 +1628,7 @@ out:
 usage:
 	fprintf(stderr, 
 		"usage: %s "
-		"[-jJsv] "
+		"[-AjJPsTv] "
 		"[-N bd] "
 		"[config]\n",
 		getprogname());
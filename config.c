@@ -83,6 +83,17 @@ parse_free_ordq(struct ordq *q)
 	}
 }
 
+static void
+parse_free_projq(struct projq *q)
+{
+	struct proj	*pr;
+
+	while ((pr = TAILQ_FIRST(q)) != NULL) {
+		TAILQ_REMOVE(q, pr, entries);
+		free(pr);
+	}
+}
+
 static void
 parse_free_distinct(struct dstnct *p)
 {
@@ -101,6 +112,7 @@ parse_free_search(struct search *p)
 	if (p->aggr != NULL)
 		parse_free_aggr(p->aggr);
 	parse_free_ordq(&p->ordq);
+	parse_free_projq(&p->projq);
 	if (p->group != NULL)
 		parse_free_group(p->group);
 
@@ -128,6 +140,32 @@ parse_free_unique(struct unique *p)
 	free(p);
 }
 
+static void
+parse_free_upsert(struct upsert *p)
+{
+	struct cref	*c;
+
+	if (p == NULL)
+		return;
+	while ((c = TAILQ_FIRST(&p->cq)) != NULL) {
+		TAILQ_REMOVE(&p->cq, c, entries);
+		free(c);
+	}
+	free(p);
+}
+
+static void
+parse_free_index(struct index *p)
+{
+	struct iref	*i;
+
+	while ((i = TAILQ_FIRST(&p->iq)) != NULL) {
+		TAILQ_REMOVE(&p->iq, i, entries);
+		free(i);
+	}
+	free(p);
+}
+
 static void
 parse_free_update(struct update *p)
 {
@@ -236,6 +274,7 @@ parse_free_strct(struct strct *p)
 	struct alias	*a;
 	struct update	*u;
 	struct unique	*n;
+	struct index	*i;
 	struct rolemap	*rm;
 
 	while ((f = TAILQ_FIRST(&p->fq)) != NULL) {
@@ -268,10 +307,15 @@ parse_free_strct(struct strct *p)
 		TAILQ_REMOVE(&p->nq, n, entries);
 		parse_free_unique(n);
 	}
+	while ((i = TAILQ_FIRST(&p->iq)) != NULL) {
+		TAILQ_REMOVE(&p->iq, i, entries);
+		parse_free_index(i);
+	}
 
 	free(p->doc);
 	free(p->name);
 	free(p->ins);
+	parse_free_upsert(p->ups);
 	free(p);
 }
 
@@ -323,6 +367,9 @@ parse_free_resolve(struct resolve *p)
 			free(p->struct_order.names[i]);
 		free(p->struct_order.names);
 		break;
+	case RESOLVE_PROJ:
+		free(p->struct_proj.name);
+		break;
 	case RESOLVE_SENT:
 		for (i = 0; i < p->struct_sent.namesz; i++)
 			free(p->struct_sent.names[i]);
@@ -331,6 +378,12 @@ parse_free_resolve(struct resolve *p)
 	case RESOLVE_UNIQUE:
 		free(p->struct_unique.name);
 		break;
+	case RESOLVE_INDEX:
+		free(p->struct_index.name);
+		break;
+	case RESOLVE_UPSERT:
+		free(p->struct_upsert.name);
+		break;
 	case RESOLVE_UP_CONSTRAINT:
 		free(p->struct_up_const.name);
 		break;
@@ -374,6 +427,8 @@ ort_config_free(struct config *cfg)
 		parse_free_bitfield(bf);
 	}
 
+	free(cfg->db);
+
 	while ((p = TAILQ_FIRST(&cfg->sq)) != NULL) {
 		TAILQ_REMOVE(&cfg->sq, p, entries);
 		parse_free_strct(p);
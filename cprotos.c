@@ -58,6 +58,25 @@ static	const char *const ftypes[FTYPE__MAX] = {
 	"int64_t ", /* FTYPE_BITFIELD */
 };
 
+/*
+ * Array element types of the "in" operator.
+ * Integral types are all passed as int64_t.
+ */
+static	const char *const intypes[FTYPE__MAX] = {
+	"const int64_t *", /* FTYPE_BIT */
+	"const int64_t *", /* FTYPE_DATE */
+	"const int64_t *", /* FTYPE_EPOCH */
+	"const int64_t *", /* FTYPE_INT */
+	"const double *", /* FTYPE_REAL */
+	NULL, /* FTYPE_BLOB */
+	"const char *const *", /* FTYPE_TEXT */
+	NULL, /* FTYPE_PASSWORD */
+	"const char *const *", /* FTYPE_EMAIL */
+	NULL, /* FTYPE_STRUCT */
+	"const int64_t *", /* FTYPE_ENUM */
+	"const int64_t *", /* FTYPE_BITFIELD */
+};
+
 static	const char *const modtypes[MODTYPE__MAX] = {
 	"cat", /* MODTYPE_CONCAT */
 	"dec", /* MODTYPE_DEC */
@@ -78,6 +97,7 @@ static	const char *const optypes[OPTYPE__MAX] = {
 	"or", /* OPTYPE_OR */
 	"streq", /* OPTYPE_STREQ */
 	"strneq", /* OPTYPE_STRNEQ */
+	"in", /* OPTYPE_IN */
 	/* Unary types... */
 	"isnull", /* OPTYPE_ISNULL */
 	"notnull", /* OPTYPE_NOTNULL */
@@ -113,6 +133,142 @@ print_func_db_open_logging(int decl)
 		decl ? "" : "\n", decl ? ";" : "");
 }
 
+/*
+ * Like print_func_db_open() but also with a read-only source.
+ */
+void
+print_func_db_open_split(int decl)
+{
+
+	printf("struct ort *%sdb_open_split(const char *file, "
+		"const char *rofile)%s\n",
+		decl ? "" : "\n", decl ? ";" : "");
+}
+
+/*
+ * Like print_func_db_open_logging() but also with a read-only source.
+ */
+void
+print_func_db_open_split_logging(int decl)
+{
+
+	printf("struct ort *%sdb_open_split_logging(const char *file,\n"
+	       "\tconst char *rofile, void (*log)(const char *, void *),\n"
+	       "\tvoid (*log_short)(const char *, ...), void *log_arg)%s\n",
+		decl ? "" : "\n", decl ? ";" : "");
+}
+
+/*
+ * Generate the db_pool_open() function declaration.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_pool_open(int decl)
+{
+
+	printf("struct ort_pool *%sdb_pool_open"
+		"(const char *file, size_t n)%s\n",
+		decl ? "" : "\n", decl ? ";" : "");
+}
+
+/*
+ * Generate the db_pool_acquire() function declaration.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_pool_acquire(int decl)
+{
+
+	printf("struct ort *%sdb_pool_acquire"
+		"(struct ort_pool *pool)%s\n",
+		decl ? "" : "\n", decl ? ";" : "");
+}
+
+/*
+ * Generate the db_pool_acquire_role() function declaration.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_pool_acquire_role(int decl)
+{
+
+	printf("struct ort *%sdb_pool_acquire_role"
+		"(struct ort_pool *pool, enum ort_role r)%s\n",
+		decl ? "" : "\n", decl ? ";" : "");
+}
+
+/*
+ * Generate the db_pool_release() function declaration.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_pool_release(int decl)
+{
+
+	printf("void%sdb_pool_release"
+		"(struct ort_pool *pool, struct ort *ctx)%s\n",
+		decl ? " " : "\n", decl ? ";" : "");
+}
+
+/*
+ * Generate the db_pool_close() function declaration.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_pool_close(int decl)
+{
+
+	printf("void%sdb_pool_close(struct ort_pool *pool)%s\n",
+		decl ? " " : "\n", decl ? ";" : "");
+}
+
+/*
+ * Generate the db_stats_get() function declaration.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_stats_get(int decl)
+{
+
+	printf("int%sdb_stats_get(struct ort *ctx, size_t i,\n"
+	       "\tstruct ort_stmt_stats *out)%s\n",
+		decl ? " " : "\n", decl ? ";" : "");
+}
+
+/*
+ * Generate the db_stats_reset() function declaration.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_stats_reset(int decl)
+{
+
+	printf("void%sdb_stats_reset(struct ort *ctx)%s\n",
+		decl ? " " : "\n", decl ? ";" : "");
+}
+
+/*
+ * Generate the db_stats_slow() function declaration.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_stats_slow(int decl)
+{
+
+	printf("void%sdb_stats_slow(struct ort *ctx, uint64_t usec,\n"
+	       "\tvoid (*cb)(const char *, uint64_t, void *), "
+	       "void *arg)%s\n",
+		decl ? " " : "\n", decl ? ";" : "");
+}
+
 /*
  * Generate the db_logging_data() function declaration, which is used to
  * set logging callback data.
@@ -200,6 +356,20 @@ print_func_db_close(int decl)
 		decl ? " " : "\n", decl ? ";" : "");
 }
 
+/*
+ * Generate the db_stmt_cache_stats() function declaration.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_stmt_cache_stats(int decl)
+{
+
+	printf("void%sdb_stmt_cache_stats(struct ort *ctx, "
+		"uint64_t *hits, uint64_t *misses)%s\n",
+		decl ? " " : "\n", decl ? ";" : "");
+}
+
 /*
  * Print the variables in a function declaration, breaking the line at
  * 72 characters to indent 5 spaces.
@@ -241,6 +411,33 @@ print_var(size_t pos, size_t col,
 	return col;
 }
 
+/*
+ * Like print_var(), but for the constraint operator "op" on "f".
+ * The "in" operator accepts an array of "vN_sz" values.
+ */
+static size_t
+print_var_op(size_t pos, size_t col, 
+	const struct field *f, enum optype op)
+{
+	int	rc;
+
+	if (op != OPTYPE_IN)
+		return print_var(pos, col, f, 0);
+
+	assert(intypes[f->type] != NULL);
+	putchar(',');
+	col++;
+
+	if (col >= 72)
+		col = (rc = printf("\n     ")) > 0 ? rc : 0;
+	else
+		col += (rc = printf(" ")) > 0 ? rc : 0;
+
+	rc = printf("size_t v%zu_sz, %sv%zu", pos, intypes[f->type], pos);
+	col += rc > 0 ? rc : 0;
+	return col;
+}
+
 /*
  * Print just the name of an update function "u".
  * The forms emitted are:
@@ -296,6 +493,32 @@ print_name_db_update(const struct update *u)
 	return col;
 }
 
+/*
+ * Print the arguments of an update function "u", starting at column
+ * "col", and the trailing semicolon if "decl".
+ */
+static void
+print_args_db_update(const struct update *u, size_t col, int decl)
+{
+	const struct uref *ur;
+	size_t	 	   pos = 1;
+	int	 	   rc;
+
+	/* Arguments starting with database pointer. */
+
+	col += (rc = printf("(struct ort *ctx")) > 0 ? rc : 0;
+
+	TAILQ_FOREACH(ur, &u->mrq, entries)
+		col = print_var(pos++, col, 
+			ur->field, ur->field->flags);
+
+	TAILQ_FOREACH(ur, &u->crq, entries)
+		if (!OPTYPE_ISUNARY(ur->op))
+			col = print_var_op(pos++, col, ur->field, ur->op);
+
+	printf(")%s", decl ? ";\n" : "");
+}
+
 /*
  * Generate the "update" function for a given structure.
  * If this is NOT a declaration ("decl"), then print a newline after the
@@ -304,9 +527,8 @@ print_name_db_update(const struct update *u)
 void
 print_func_db_update(const struct update *u, int decl)
 {
-	const struct uref *ur;
-	size_t	 	   pos = 1, col = 0;
-	int	 	   rc;
+	size_t	 col = 0;
+	int	 rc;
 
 	/* Start with return value. */
 
@@ -322,33 +544,47 @@ print_func_db_update(const struct update *u, int decl)
 		col = (rc = printf("    ") > 0) ? rc : 0;
 	}
 
-	/* Arguments starting with database pointer. */
+	print_args_db_update(u, col, decl);
+}
 
-	col += (rc = printf("(struct ort *ctx")) > 0 ? rc : 0;
+/*
+ * Like print_func_db_update(), but for the variant returning the
+ * updated row.
+ */
+void
+print_func_db_update_returning(const struct update *u, int decl)
+{
+	size_t	 col = 0;
+	int	 rc;
 
-	TAILQ_FOREACH(ur, &u->mrq, entries)
-		col = print_var(pos++, col, 
-			ur->field, ur->field->flags);
+	if (!decl) 
+		printf("struct %s *\n", u->parent->name);
+	else
+		col = (rc = printf("struct %s *", 
+			u->parent->name)) > 0 ? rc : 0;
 
-	TAILQ_FOREACH(ur, &u->crq, entries)
-		if (!OPTYPE_ISUNARY(ur->op))
-			col = print_var(pos++, col, ur->field, 0);
+	col += print_name_db_update(u);
+	if ((col += (rc = printf("_returning")) > 0 ? rc : 0) >= 72) {
+		puts("");
+		col = (rc = printf("    ") > 0) ? rc : 0;
+	}
 
-	printf(")%s", decl ? ";\n" : "");
+	print_args_db_update(u, col, decl);
 }
 
 /*
- * Print just the name of a search function for "s".
+ * Print just the name of a search function for "s" with prefix "pfx"
+ * (e.g., "db").
  * Returns the number of characters printed.
  */
-size_t
-print_name_db_search(const struct search *s)
+static size_t
+print_name_search(const char *pfx, const struct search *s)
 {
 	const struct sent *sent;
 	size_t		   sz = 0;
 	int	 	   rc;
 
-	rc = printf("db_%s_%s", s->parent->name, stypes[s->type]);
+	rc = printf("%s_%s_%s", pfx, s->parent->name, stypes[s->type]);
 	sz += rc > 0 ? rc : 0;
 
 	if (s->name == NULL && !TAILQ_EMPTY(&s->sntq)) {
@@ -364,15 +600,62 @@ print_name_db_search(const struct search *s)
 	return sz;
 }
 
+/*
+ * Print just the name of a search function for "s".
+ * Returns the number of characters printed.
+ */
+size_t
+print_name_db_search(const struct search *s)
+{
+
+	return print_name_search("db", s);
+}
+
+/*
+ * Print the run-time limit and offset arguments of "s", if any.
+ * Returns the current column.
+ */
+static size_t
+print_search_bounds(const struct search *s, size_t col)
+{
+	const char	*names[2] = { "limit", "offset" };
+	unsigned int	 flags[2] = 
+		{ SEARCH_LIMIT_BOUND, SEARCH_OFFSET_BOUND };
+	size_t		 i;
+	int		 rc;
+
+	for (i = 0; i < 2; i++) {
+		if (!(s->flags & flags[i]))
+			continue;
+		putchar(',');
+		col++;
+		if (col >= 72)
+			col = (rc = printf("\n     ")) > 0 ? rc : 0;
+		else
+			col += (rc = printf(" ")) > 0 ? rc : 0;
+		rc = printf("int64_t %s", names[i]);
+		col += rc > 0 ? rc : 0;
+	}
+	return col;
+}
+
 /*
  * Generate the declaration for a search function "s".
  * The format of the declaration depends upon the search type.
+ * If "after", this is the keyset pagination variant, which accepts the
+ * last row's ordering value (if ordered) and rowid, then a limit.
+ * If "borrow", this is the borrowed-row iterate variant, which accepts
+ * the same arguments.
+ * If "json", this is the JSON streaming iterate variant, which accepts
+ * a JSON request in place of the callback and its argument.
  * If this is NOT a declaration ("decl"), then print a newline after the
  * return type; otherwise, have it on one line.
  */
-void
-print_func_db_search(const struct search *s, int decl)
+static void
+print_func_db_search_r(const struct search *s, 
+	int decl, int after, int borrow, int json)
 {
+	const struct ord *ord;
 	const struct sent *sent;
 	const struct strct *retstr;
 	size_t	 	    pos = 1, col = 0;
@@ -405,7 +688,14 @@ print_func_db_search(const struct search *s, int decl)
 
 	/* Now function name. */
 
-	if ((col += print_name_db_search(s)) >= 72) {
+	col += print_name_db_search(s);
+	if (after)
+		col += (rc = printf("_after")) > 0 ? rc : 0;
+	else if (borrow)
+		col += (rc = printf("_borrow")) > 0 ? rc : 0;
+	else if (json)
+		col += (rc = printf("_json")) > 0 ? rc : 0;
+	if (col >= 72) {
 		puts("");
 		col = (rc = printf("    ") > 0) ? rc : 0;
 	}
@@ -414,14 +704,114 @@ print_func_db_search(const struct search *s, int decl)
 
 	col += (rc = printf("(struct ort *ctx")) > 0 ? rc : 0;
 
-	if (s->type == STYPE_ITERATE) {
+	if (json) {
+		rc = printf(", struct kjsonreq *r");
+		col += rc > 0 ? rc : 0;
+	} else if (s->type == STYPE_ITERATE) {
 		rc = printf(", %s_cb cb, void *arg", retstr->name);
 		col += rc > 0 ? rc : 0;
 	}
 
 	TAILQ_FOREACH(sent, &s->sntq, entries)
 		if (!OPTYPE_ISUNARY(sent->op))
-			col = print_var(pos++, col, sent->field, 0);
+			col = print_var_op(pos++, col, 
+				sent->field, sent->op);
+	col = print_search_bounds(s, col);
+
+	if (after) {
+		if ((ord = TAILQ_FIRST(&s->ordq)) != NULL)
+			col = print_var(pos++, col, ord->field, 0);
+		col = print_var(pos++, col, s->parent->rowid, 0);
+		printf(",%sint64_t limit", col + 16 >= 72 ? 
+			"\n     " : " ");
+	}
+
+	printf(")%s", decl ? ";\n" : "");
+}
+
+void
+print_func_db_search(const struct search *s, int decl)
+{
+
+	print_func_db_search_r(s, decl, 0, 0, 0);
+}
+
+/*
+ * Like print_func_db_search(), but for the keyset pagination variant
+ * of a list or iterate search with SEARCH_PAGINATE.
+ */
+void
+print_func_db_search_after(const struct search *s, int decl)
+{
+
+	assert(s->flags & SEARCH_PAGINATE);
+	print_func_db_search_r(s, decl, 1, 0, 0);
+}
+
+/*
+ * Like print_func_db_search(), but for the borrowed-row variant of an
+ * iterate search.
+ */
+void
+print_func_db_search_borrow(const struct search *s, int decl)
+{
+
+	assert(s->type == STYPE_ITERATE);
+	print_func_db_search_r(s, decl, 0, 1, 0);
+}
+
+/*
+ * Like print_func_db_search(), but for the JSON streaming variant of
+ * an iterate search, which writes each row as an object into the
+ * current JSON array.
+ */
+void
+print_func_db_search_json(const struct search *s, int decl)
+{
+
+	assert(s->type == STYPE_ITERATE);
+	print_func_db_search_r(s, decl, 0, 0, 1);
+}
+
+/*
+ * Generate the declaration for the contiguous array variant of the
+ * STYPE_LIST search function "s".
+ * This has the same name and arguments as print_func_db_search() but
+ * with an "_array" suffix.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_search_array(const struct search *s, int decl)
+{
+	const struct sent *sent;
+	const struct strct *retstr;
+	size_t	 	    pos = 1, col = 0;
+	int	 	    rc;
+
+	assert(s->type == STYPE_LIST);
+	retstr = s->dst != NULL ? s->dst->strct : s->parent;
+
+	rc = printf("struct %s_array *", retstr->name);
+	col += rc > 0 ? rc : 0;
+	if (!decl) {
+		printf("\n");
+		col = 0;
+	}
+
+	col += print_name_db_search(s);
+	if ((col += (rc = printf("_array")) > 0 ? rc : 0) >= 72) {
+		puts("");
+		col = (rc = printf("    ") > 0) ? rc : 0;
+	}
+
+	col += (rc = printf("(struct ort *ctx")) > 0 ? rc : 0;
+
+	TAILQ_FOREACH(sent, &s->sntq, entries)
+		if (!OPTYPE_ISUNARY(sent->op))
+			col = print_var_op(pos++, col, 
+				sent->field, sent->op);
+	print_search_bounds(s, col);
 
 	printf(")%s", decl ? ";\n" : "");
 }
@@ -438,6 +828,29 @@ print_name_db_insert(const struct strct *p)
 	return (rc = printf("db_%s_insert", p->name)) > 0 ? rc : 0;
 }
 
+/*
+ * Print the arguments of an insert function for "p", starting at column
+ * "col", and the trailing semicolon if "decl".
+ */
+static void
+print_args_db_insert(const struct strct *p, size_t col, int decl)
+{
+	const struct field *f;
+	size_t	 	    pos = 1;
+	int		    rc;
+
+	/* Arguments starting with database pointer. */
+
+	col += (rc = printf("(struct ort *ctx")) > 0 ? rc : 0;
+
+	TAILQ_FOREACH(f, &p->fq, entries)
+		if (!(f->type == FTYPE_STRUCT || 
+		      (f->flags & FIELD_ROWID)))
+			col = print_var(pos++, col, f, f->flags);
+
+	printf(")%s", decl ? ";\n" : "");
+}
+
 /*
  * Generate the "insert" function for a given structure.
  * If this is NOT a declaration ("decl"), then print a newline after the
@@ -446,8 +859,7 @@ print_name_db_insert(const struct strct *p)
 void
 print_func_db_insert(const struct strct *p, int decl)
 {
-	const struct field *f;
-	size_t	 	    pos = 1, col = 0;
+	size_t	 	    col = 0;
 	int		    rc;
 
 	/* Start with return value. */
@@ -464,18 +876,133 @@ print_func_db_insert(const struct strct *p, int decl)
 		col = (rc = printf("    ") > 0) ? rc : 0;
 	}
 
-	/* Arguments starting with database pointer. */
+	print_args_db_insert(p, col, decl);
+}
+
+/*
+ * Like print_func_db_insert(), but for the variant returning the
+ * inserted row.
+ */
+void
+print_func_db_insert_returning(const struct strct *p, int decl)
+{
+	size_t	 	    col = 0;
+	int		    rc;
+
+	if (!decl)
+		printf("struct %s *\n", p->name);
+	else
+		col += (rc = printf("struct %s *", p->name)) > 0 ? rc : 0;
+
+	col += print_name_db_insert(p);
+	if ((col += (rc = printf("_returning")) > 0 ? rc : 0) >= 72) {
+		puts("");
+		col = (rc = printf("    ") > 0) ? rc : 0;
+	}
+
+	print_args_db_insert(p, col, decl);
+}
+
+/*
+ * Like print_name_db_insert() but for the upsert function.
+ */
+size_t
+print_name_db_upsert(const struct strct *p)
+{
+	int	 rc;
+
+	return (rc = printf("db_%s_upsert", p->name)) > 0 ? rc : 0;
+}
+
+/*
+ * Generate the "upsert" function for a given structure.
+ * Its arguments are those of the "insert" function, preceded by the
+ * rowid if it's the conflict target.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_upsert(const struct strct *p, int decl)
+{
+	const struct field *f;
+	size_t	 	    pos = 1, col = 0;
+	int		    rc;
+
+	if (!decl)
+		printf("int64_t\n");
+	else
+		col += (rc = printf("int64_t ")) > 0 ? rc : 0;
+
+	if ((col += print_name_db_upsert(p)) >= 72) {
+		puts("");
+		col = (rc = printf("    ") > 0) ? rc : 0;
+	}
 
 	col += (rc = printf("(struct ort *ctx")) > 0 ? rc : 0;
 
 	TAILQ_FOREACH(f, &p->fq, entries)
-		if (!(f->type == FTYPE_STRUCT || 
-		      (f->flags & FIELD_ROWID)))
+		if (f->type != FTYPE_STRUCT && 
+		    (!(f->flags & FIELD_ROWID) ||
+		     (p->ups->flags & UPSERT_ROWID)))
 			col = print_var(pos++, col, f, f->flags);
 
 	printf(")%s", decl ? ";\n" : "");
 }
 
+/*
+ * Generate the bulk "insert" function for a given structure.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_insert_many(const struct strct *p, int decl)
+{
+
+	printf("int%sdb_%s_insert_many(struct ort *ctx,\n"
+	       "    const struct %s_insert_args *rows, "
+	       "size_t n, int64_t *ids)%s",
+	       decl ? " " : "\n", p->name, p->name,
+	       decl ? ";\n" : "");
+}
+
+/*
+ * Generate the db_arena_mark() function declaration, which returns the
+ * current position in the result arena.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_arena_mark(int decl)
+{
+
+	printf("size_t%sdb_arena_mark(struct ort *ctx)%s\n",
+		decl ? " " : "\n", decl ? ";" : "");
+}
+
+/*
+ * Like print_func_db_arena_mark() but for releasing the arena back to
+ * a previous mark.
+ */
+void
+print_func_db_arena_release(int decl)
+{
+
+	printf("void%sdb_arena_release"
+		"(struct ort *ctx, size_t mark)%s\n",
+		decl ? " " : "\n", decl ? ";" : "");
+}
+
+/*
+ * Like print_func_db_arena_mark() but for releasing all arena memory.
+ */
+void
+print_func_db_arena_reset(int decl)
+{
+
+	printf("void%sdb_arena_reset(struct ort *ctx)%s\n",
+		decl ? " " : "\n", decl ? ";" : "");
+}
+
 /*
  * Generate the "freeq" function for a given structure.
  * If this is NOT a declaration ("decl"), then print a newline after the
@@ -491,6 +1018,21 @@ print_func_db_freeq(const struct strct *p, int decl)
 	       decl ? ";\n" : "");
 }
 
+/*
+ * Generate the "freearray" function for a given structure.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line.
+ */
+void
+print_func_db_freearray(const struct strct *p, int decl)
+{
+
+	assert(STRCT_HAS_QUEUE & p->flags);
+	printf("void%sdb_%s_freearray(struct %s_array *a)%s",
+	       decl ? " " : "\n", p->name, p->name,
+	       decl ? ";\n" : "");
+}
+
 /*
  * Generate the "free" function for a given structure.
  * If this is NOT a declaration ("decl"), then print a newline after the
@@ -573,6 +1115,24 @@ print_func_json_parse(const struct strct *p, int decl)
 		decl ? ";\n" : "\n");
 }
 
+/*
+ * Generate the JSON data function for the fields projected by the
+ * search "s", named as the search but with a "json" prefix and "_data"
+ * suffix.
+ * If this is NOT a declaration ("decl"), then print a newline after the
+ * return type; otherwise, have it on one line followed by a newline.
+ */
+void
+print_func_json_search_data(const struct search *s, int decl)
+{
+
+	assert(!TAILQ_EMPTY(&s->projq));
+	printf("void%s", decl ? " " : "\n");
+	print_name_search("json", s);
+	printf("_data(struct kjsonreq *r, const struct %s *p)%s",
+		s->parent->name, decl ? ";\n" : "");
+}
+
 /*
  * Generate the JSON internal data function for a given structure.
  * If this is NOT a declaration ("decl"), then print a newline after the
@@ -603,6 +1163,19 @@ print_func_json_array(const struct strct *p, int decl)
 		p->name, decl ? ";" : "");
 }
 
+/*
+ * Like print_func_json_array() but for a contiguous array.
+ */
+void
+print_func_json_rows(const struct strct *p, int decl)
+{
+
+	printf("void%sjson_%s_rows(struct kjsonreq *r, "
+		"const struct %s_array *a)%s\n",
+		decl ? " " : "\n", p->name, 
+		p->name, decl ? ";" : "");
+}
+
 /*
  * Generate the JSON object function for a given structure.
  * If this is NOT a declaration ("decl"), then print a newline after the
@@ -17,34 +17,60 @@
 #ifndef CPROTOS_H
 #define CPROTOS_H
 
+void	print_func_db_arena_mark(int);
+void	print_func_db_arena_release(int);
+void	print_func_db_arena_reset(int);
 void	print_func_db_close(int);
+void	print_func_db_stmt_cache_stats(int);
 void	print_func_db_role(int);
 void	print_func_db_role_current(int);
 void	print_func_db_role_stored(int);
 void	print_func_db_open(int);
 void	print_func_db_open_logging(int);
+void	print_func_db_open_split(int);
+void	print_func_db_open_split_logging(int);
+void	print_func_db_pool_acquire(int);
+void	print_func_db_pool_acquire_role(int);
+void	print_func_db_pool_close(int);
+void	print_func_db_pool_open(int);
+void	print_func_db_pool_release(int);
+void	print_func_db_stats_get(int);
+void	print_func_db_stats_reset(int);
+void	print_func_db_stats_slow(int);
 void	print_func_db_insert(const struct strct *, int);
+void	print_func_db_insert_many(const struct strct *, int);
+void	print_func_db_insert_returning(const struct strct *, int);
+void	print_func_db_upsert(const struct strct *, int);
 void	print_func_db_free(const struct strct *, int);
+void	print_func_db_freearray(const struct strct *, int);
 void	print_func_db_freeq(const struct strct *, int);
 void	print_func_db_search(const struct search *, int);
+void	print_func_db_search_after(const struct search *, int);
+void	print_func_db_search_borrow(const struct search *, int);
+void	print_func_db_search_json(const struct search *, int);
+void	print_func_db_search_array(const struct search *, int);
 void	print_func_db_set_logging(int);
 void	print_func_db_trans_commit(int);
 void	print_func_db_trans_open(int);
 void	print_func_db_trans_rollback(int);
 void	print_func_db_update(const struct update *, int);
+void	print_func_db_update_returning(const struct update *, int);
 
 size_t	 print_name_db_insert(const struct strct *);
 size_t	 print_name_db_search(const struct search *);
 size_t	 print_name_db_update(const struct update *);
+size_t	 print_name_db_upsert(const struct strct *);
 
 void	 print_func_json_array(const struct strct *, int);
 void	 print_func_json_clear(const struct strct *, int);
 void	 print_func_json_data(const struct strct *, int);
+void	 print_func_json_search_data(const struct search *, int);
 void	 print_func_json_free_array(const struct strct *, int);
 void	 print_func_json_iterate(const struct strct *, int);
 void	 print_func_json_parse(const struct strct *, int);
 void	 print_func_json_parse_array(const struct strct *, int);
 void	 print_func_json_obj(const struct strct *, int);
+void	 print_func_json_rows(const struct strct *, int);
 
 void	 print_func_valid(const struct field *, int);
 
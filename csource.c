@@ -40,6 +40,8 @@
 #include "extern.h"
 #include "cprotos.h"
 #include "comments.h"
+#include "sqlidx.h"
+#include "sqlstmt.h"
 
 enum	external {
 	EX_GENSALT, /* gensalt.c */
@@ -54,27 +56,52 @@ static	const char *const externals[EX__MAX] = {
 	FILE_JSMN /* EX_JSMN */
 };
 
+static	const char *const journals[JOURNAL__MAX] = {
+	NULL, /* JOURNAL_UNSET */
+	"delete", /* JOURNAL_DELETE */
+	"memory", /* JOURNAL_MEMORY */
+	"off", /* JOURNAL_OFF */
+	"persist", /* JOURNAL_PERSIST */
+	"truncate", /* JOURNAL_TRUNCATE */
+	"wal", /* JOURNAL_WAL */
+};
+
+static	const char *const syncmodes[SYNCMODE__MAX] = {
+	NULL, /* SYNCMODE_UNSET */
+	"extra", /* SYNCMODE_EXTRA */
+	"full", /* SYNCMODE_FULL */
+	"normal", /* SYNCMODE_NORMAL */
+	"off", /* SYNCMODE_OFF */
+};
+
+static	const char *const tempstores[TEMPSTORE__MAX] = {
+	NULL, /* TEMPSTORE_UNSET */
+	"file", /* TEMPSTORE_FILE */
+	"memory", /* TEMPSTORE_MEMORY */
+};
+
+/* Forward declarations to get __attribute__ bits. */
+
+static void gen_enum_ent(int, const char *, ...)
+	__attribute__((format(printf, 2, 3)));
+
 /*
- * SQL operators.
- * Some of these binary, some of these are unary.
- * Use the OPTYPE_ISUNARY or OPTYPE_ISBINARY macro to determine where
- * within the expressions this should sit.
- */
-static	const char *const optypes[OPTYPE__MAX] = {
-	"=", /* OPTYPE_EQUAL */
-	">=", /* OPTYPE_GE */
-	">", /* OPTYPE_GT */
-	"<=", /* OPTYPE_LE */
-	"<", /* OPTYPE_LT */
-	"!=", /* OPTYPE_NEQUAL */
-	"LIKE", /* OPTYPE_LIKE */
-	"&", /* OPTYPE_AND */
-	"|", /* OPTYPE_OR */
-	"=", /* OPTYPE_STREQ */
-	"!=", /* OPTYPE_STRNEQ */
-	/* Unary types... */
-	"ISNULL", /* OPTYPE_ISNULL */
-	"NOTNULL", /* OPTYPE_NOTNULL */
+ * Functions converting the array of an OPTYPE_IN operand into the JSON
+ * array bound in its place.
+ */
+static	const char *const infuncs[FTYPE__MAX] = {
+	"db_in_int", /* FTYPE_BIT */
+	"db_in_int", /* FTYPE_DATE */
+	"db_in_int", /* FTYPE_EPOCH */
+	"db_in_int", /* FTYPE_INT */
+	"db_in_real", /* FTYPE_REAL */
+	NULL, /* FTYPE_BLOB */
+	"db_in_text", /* FTYPE_TEXT */
+	NULL, /* FTYPE_PASSWORD */
+	"db_in_text", /* FTYPE_EMAIL */
+	NULL, /* FTYPE_STRUCT */
+	"db_in_int", /* FTYPE_ENUM */
+	"db_in_int", /* FTYPE_BITFIELD */
 };
 
 /*
@@ -219,10 +246,12 @@ print_src(size_t indent, const char *fmt, ...)
  * This should be a conditional phrase that evalutes to FALSE if the
  * password does NOT match the given type, TRUE if the password does
  * match the given type.
+ * If "cache", check with db_checkpass_cached() and the per-call cache
+ * "pcN", so rows sharing a hash are only hashed once.
  */
 static void
 gen_print_checkpass(int ptr, size_t pos, const char *name,
-	enum optype type, const struct field *f)
+	enum optype type, const struct field *f, int cache)
 {
 	const char	*s = ptr ? "->" : ".";
 
@@ -235,27 +264,81 @@ gen_print_checkpass(int ptr, size_t pos, const char *name,
 			"(v%zu != NULL && !p%shas_%s) ||\n\t\t    "
 			"(v%zu != NULL && p%shas_%s && ",
 			pos, s, name, pos, s, name, pos, s, name);
+		if (cache)
+			printf("!db_checkpass_cached(&pc%zu, "
+				"v%zu, p%s%s))", pos, pos, s, name);
+		else
 #ifdef __OpenBSD__
-		printf("crypt_checkpass(v%zu, p%s%s) == -1)", 
-			pos, s, name);
+			printf("crypt_checkpass(v%zu, p%s%s) == -1)", 
+				pos, s, name);
 #else
-		printf("strcmp(crypt(v%zu, p%s%s), p%s%s) != 0)", 
-			pos, s, name, s, name);
+			printf("_crypt_checkpass(v%zu, p%s%s) == -1)", 
+				pos, s, name);
 #endif
 	} else {
 		printf("v%zu == NULL || ", pos);
+		if (cache)
+			printf("!db_checkpass_cached(&pc%zu, "
+				"v%zu, p%s%s)", pos, pos, s, name);
+		else
 #ifdef __OpenBSD__
-		printf("crypt_checkpass(v%zu, p%s%s) == -1", 
-			pos, s, name);
+			printf("crypt_checkpass(v%zu, p%s%s) == -1", 
+				pos, s, name);
 #else
-		printf("strcmp(crypt(v%zu, p%s%s), p%s%s) != 0", 
-			pos, s, name, s, name);
+			printf("_crypt_checkpass(v%zu, p%s%s) == -1", 
+				pos, s, name);
 #endif
 	}
 
 	printf("%s)", type == OPTYPE_NEQUAL ? ")" : "");
 }
 
+/*
+ * Whether the password check of search term "sent" should be cached.
+ * Stored hashes repeat only if the password is reached through a
+ * join, where many rows may reference the same row, and in list and
+ * iterate searches that may return more than one row: unique searches
+ * check at most one row.
+ * Hashes of the search's own rows are salted, so never repeat.
+ */
+static int
+sent_passcache(const struct sent *sent)
+{
+	const struct search	*s = sent->parent;
+
+	return s->type != STYPE_SEARCH && 
+		!(s->flags & SEARCH_IS_UNIQUE) &&
+		sent->name != NULL &&
+		sent->field->type == FTYPE_PASSWORD &&
+		OPTYPE_ISBINARY(sent->op) &&
+		sent->op != OPTYPE_STREQ &&
+		sent->op != OPTYPE_STRNEQ;
+}
+
+/*
+ * Emit the declarations ("decl") or release of the per-call password
+ * check caches used when sent_passcache() is true.
+ */
+static void
+gen_search_passcache(const struct search *s, int decl)
+{
+	const struct sent	*sent;
+	size_t			 pos = 1;
+
+	TAILQ_FOREACH(sent, &s->sntq, entries) {
+		if (OPTYPE_ISUNARY(sent->op))
+			continue;
+		if (sent_passcache(sent)) {
+			if (decl)
+				printf("\tstruct ort_passcache "
+					"pc%zu = { NULL, 0 };\n", pos);
+			else
+				printf("\tfree(pc%zu.hash);\n", pos);
+		}
+		pos++;
+	}
+}
+
 static void
 gen_print_newpass(int ptr, size_t pos, size_t npos)
 {
@@ -265,9 +348,8 @@ gen_print_newpass(int ptr, size_t pos, size_t npos)
 		"hash%zu, sizeof(hash%zu));\n",
 		ptr ? "*" : "", npos, pos, pos);
 #else
-	printf("\tstrncpy(hash%zu, crypt(%sv%zu, _gensalt()), "
-		"sizeof(hash%zu));\n",
-		pos, ptr ? "*" : "", npos, pos);
+	printf("\t_crypt_newhash(%sv%zu, hash%zu, sizeof(hash%zu));\n",
+		ptr ? "*" : "", npos, pos, pos);
 #endif
 }
 
@@ -288,16 +370,20 @@ gen_role(const struct role *r)
 
 /*
  * Fill an individual field from the database.
+ * If "arena" is set, strings and blobs are copied into the result arena
+ * instead of being individually allocated.
+ * If "borrow" is set, strings and blobs point directly into the result
+ * set and are only valid until the next step.
  */
 static void
-gen_strct_fill_field(const struct field *f)
+gen_strct_fill_field(const struct field *f, int arena, int borrow)
 {
 	size_t	 indent;
 
 	/*
 	 * By default, structs on possibly-null foreign keys are set as
 	 * not existing.
-	 * We'll change this in db_xxx_reffind.
+	 * We'll change this in db_xxx_fill_r.
 	 */
 
 	if (f->type == FTYPE_STRUCT &&
@@ -326,6 +412,20 @@ gen_strct_fill_field(const struct field *f)
 
 	switch (f->type) {
 	case FTYPE_BLOB:
+		if (borrow) {
+			print_src(indent,
+				"p->%s = db_borrow_blob"
+				"(ctx, &set->ps[(*pos)++],\n"
+				"    &p->%s_sz);", f->name, f->name);
+			break;
+		}
+		if (arena) {
+			print_src(indent,
+				"p->%s = db_arena_parm_blob"
+				"(ctx, &set->ps[(*pos)++],\n"
+				"    &p->%s_sz);", f->name, f->name);
+			break;
+		}
 		print_src(indent, 
 			"if (%s(&set->ps[(*pos)++],\n"
 			"    &p->%s, &p->%s_sz) == -1)\n"
@@ -351,6 +451,18 @@ gen_strct_fill_field(const struct field *f)
 			coltypes[f->type], f->name);
 		break;
 	default:
+		if (borrow) {
+			print_src(indent,
+				"p->%s = db_borrow_string"
+				"(ctx, &set->ps[(*pos)++]);", f->name);
+			break;
+		}
+		if (arena) {
+			print_src(indent,
+				"p->%s = db_arena_parm_string"
+				"(ctx, &set->ps[(*pos)++]);", f->name);
+			break;
+		}
 		print_src(indent,
 			"if (%s\n"
 			"    (&set->ps[(*pos)++], &p->%s, NULL) == -1)\n"
@@ -364,6 +476,54 @@ gen_strct_fill_field(const struct field *f)
 		     "\t\t(*pos)++;");
 }
 
+/*
+ * Declare (if "decl") or free the JSON arrays bound in place of the
+ * set membership operands of search "s".
+ */
+static void
+gen_search_in(const struct search *s, int decl)
+{
+	const struct sent	*sent;
+	size_t			 pos = 1;
+
+	TAILQ_FOREACH(sent, &s->sntq, entries) {
+		if (OPTYPE_ISUNARY(sent->op))
+			continue;
+		if (sent->op == OPTYPE_IN) {
+			if (decl)
+				printf("\tchar *in%zu;\n", pos);
+			else
+				printf("\tfree(in%zu);\n", pos);
+		}
+		pos++;
+	}
+}
+
+/*
+ * Like gen_search_in() but for the constraints of update "up", whose
+ * arguments follow those of its modifiers.
+ */
+static void
+gen_update_in(const struct update *up, int decl)
+{
+	const struct uref	*ref;
+	size_t			 pos = 1;
+
+	TAILQ_FOREACH(ref, &up->mrq, entries)
+		pos++;
+	TAILQ_FOREACH(ref, &up->crq, entries) {
+		if (OPTYPE_ISUNARY(ref->op))
+			continue;
+		if (ref->op == OPTYPE_IN) {
+			if (decl)
+				printf("\tchar *in%zu;\n", pos);
+			else
+				printf("\tfree(in%zu);\n", pos);
+		}
+		pos++;
+	}
+}
+
 /*
  * Counts how many entries are required if later passed to
  * query_gen_bindfunc().
@@ -394,6 +554,19 @@ update_gen_bindfunc(enum ftype t, size_t idx, size_t pos,
 
 	if (!query_count_bindfuncs(t, type))
 		return 0;
+	if (type == OPTYPE_IN) {
+		assert(infuncs[t] != NULL);
+		for (i = 0; i < tabs; i++)
+			putchar('\t');
+		printf("parms[%zu].sparm = in%zu =\n", idx - 1, pos);
+		for (i = 0; i < tabs; i++)
+			putchar('\t');
+		printf("    %s(v%zu, v%zu_sz);\n", infuncs[t], pos, pos);
+		for (i = 0; i < tabs; i++)
+			putchar('\t');
+		printf("parms[%zu].type = SQLBOX_PARM_STRING;\n", idx - 1);
+		return 1;
+	}
 	for (i = 0; i < tabs; i++)
 		putchar('\t');
 	printf("parms[%zu].%s = %sv%zu;\n", 
@@ -440,17 +613,203 @@ update_gen_bindhash(size_t pos, size_t hpos, size_t tabs)
 	printf("parms[%zu].type = SQLBOX_PARM_STRING;\n", pos - 1);
 }
 
+/*
+ * Whether any of the terms in "s" are checked against a hashed password
+ * after the query has run.
+ */
+static int
+search_has_hash(const struct search *s)
+{
+	const struct sent	*sent;
+
+	TAILQ_FOREACH(sent, &s->sntq, entries)
+		if (OPTYPE_ISBINARY(sent->op) &&
+		    sent->field->type == FTYPE_PASSWORD &&
+		    sent->op != OPTYPE_STREQ &&
+		    sent->op != OPTYPE_STRNEQ)
+			return 1;
+	return 0;
+}
+
+/*
+ * Emit filling the result "var" of the "num"th search "s" from the
+ * current row "res".
+ * Projected searches only fill their own fields.
+ * If "borrow" is set, use the allocation-free fill functions.
+ */
+static void
+gen_search_fill(const struct search *s, size_t num, 
+	const char *var, int borrow)
+{
+	const char	*sfx = borrow ? "_borrow" : "";
+
+	if (!TAILQ_EMPTY(&s->projq))
+		printf("\t\tdb_%s_fill_proj_%zu%s(ctx, %s, res);\n",
+		       s->parent->name, num, sfx, var);
+	else
+		printf("\t\tdb_%s_fill%s_r(ctx, %s, res, NULL);\n",
+		       (s->dst != NULL ? s->dst->strct : 
+			s->parent)->name, sfx, var);
+}
+
+/*
+ * Number of run-time limit and offset parameters of "s".
+ */
+static size_t
+search_bound_parms(const struct search *s)
+{
+
+	return ((s->flags & SEARCH_LIMIT_BOUND) ? 1 : 0) +
+		((s->flags & SEARCH_OFFSET_BOUND) ? 1 : 0);
+}
+
+/*
+ * Emit binding the run-time limit and offset of "s" (if any) starting
+ * at parameter "idx", which is one-based.
+ */
+static void
+gen_search_bind_bounds(const struct search *s, size_t idx)
+{
+
+	if (s->flags & SEARCH_LIMIT_BOUND) {
+		printf("\tparms[%zu].iparm = limit;\n"
+		       "\tparms[%zu].type = SQLBOX_PARM_INT;\n",
+		       idx - 1, idx - 1);
+		idx++;
+	}
+	if (s->flags & SEARCH_OFFSET_BOUND)
+		printf("\tparms[%zu].iparm = offset;\n"
+		       "\tparms[%zu].type = SQLBOX_PARM_INT;\n",
+		       idx - 1, idx - 1);
+}
+
+/*
+ * Number of additional parameters bound by the keyset pagination
+ * variant of "s": the ordering value (if ordered), rowid, and limit.
+ */
+static size_t
+search_page_parms(const struct search *s)
+{
+
+	return TAILQ_EMPTY(&s->ordq) ? 2 : 3;
+}
+
+/*
+ * Emit binding the statement of the "num"th search "s" into "id".
+ * The "parms" search parameters have already been bound from function
+ * arguments up to "pos" - 1.
+ * If "after", also bind the keyset pagination arguments that follow,
+ * choosing the first-page statement if the last rowid is not positive
+ * and the following-page statement otherwise.
+ * Binding copies the parameters, so set membership arrays are freed.
+ */
+static void
+gen_search_bind(const struct search *s, size_t num, size_t parms,
+	size_t pos, int after, const char *flags)
+{
+	const struct ord	*ord;
+	size_t			 idx = parms + 1, rpos;
+
+	if (!after) {
+		printf("\tid = db_stmt_bind(ctx, STMT_%s_BY_SEARCH_%zu,\n"
+		       "\t    %zu, %s, %s, 1);\n",
+		       s->parent->name, num, parms,
+		       parms > 0 ? "parms" : "NULL", flags);
+		gen_search_in(s, 0);
+		return;
+	}
+
+	ord = TAILQ_FIRST(&s->ordq);
+	rpos = ord != NULL ? pos + 1 : pos;
+	printf("\tif (v%zu > 0) {\n", rpos);
+	if (ord != NULL)
+		update_gen_bindfunc(ord->field->type,
+			idx++, pos, 0, 2, OPTYPE_EQUAL);
+	update_gen_bindfunc(s->parent->rowid->type,
+		idx++, rpos, 0, 2, OPTYPE_EQUAL);
+	printf("\t\tparms[%zu].iparm = limit;\n"
+	       "\t\tparms[%zu].type = SQLBOX_PARM_INT;\n"
+	       "\t\tstmt = STMT_%s_BY_SEARCH_%zu_AFTER;\n"
+	       "\t\tpsz = %zu;\n"
+	       "\t} else {\n"
+	       "\t\tparms[%zu].iparm = limit;\n"
+	       "\t\tparms[%zu].type = SQLBOX_PARM_INT;\n"
+	       "\t\tstmt = STMT_%s_BY_SEARCH_%zu_PAGE;\n"
+	       "\t\tpsz = %zu;\n"
+	       "\t}\n"
+	       "\tid = db_stmt_bind(ctx, stmt, psz, parms, %s, 1);\n",
+	       idx - 1, idx - 1, s->parent->name, num, idx,
+	       parms, parms, s->parent->name, num, parms + 1, flags);
+	gen_search_in(s, 0);
+}
+
+/*
+ * Emit finishing with the statement bound by gen_search_bind().
+ */
+static void
+gen_search_done(const struct search *s, size_t num, int after)
+{
+
+	if (after)
+		puts("\tdb_stmt_done(ctx, stmt, id);");
+	else
+		printf("\tdb_stmt_done(ctx, "
+			"STMT_%s_BY_SEARCH_%zu, id);\n",
+			s->parent->name, num);
+}
+
+/*
+ * Print out the JSON streaming variant of an STYPE_ITERATE search.
+ * This passes the borrowed rows of the "_borrow" variant directly to
+ * the JSON iterator, so it shares its exports and allocates nothing.
+ */
+static void
+gen_strct_func_iter_json(const struct search *s)
+{
+	const struct sent	*sent;
+	size_t			 pos = 1;
+
+	assert(s->dst == NULL);
+	print_func_db_search_json(s, 0);
+	printf("\n"
+	       "{\n"
+	       "\n"
+	       "\t");
+	print_name_db_search(s);
+	printf("_borrow(ctx, json_%s_iterate, r", s->parent->name);
+	TAILQ_FOREACH(sent, &s->sntq, entries) {
+		if (!OPTYPE_ISBINARY(sent->op))
+			continue;
+		if (sent->field->type == FTYPE_BLOB ||
+		    sent->op == OPTYPE_IN)
+			printf(", v%zu_sz", pos);
+		printf(", v%zu", pos++);
+	}
+	if (s->flags & SEARCH_LIMIT_BOUND)
+		printf(", limit");
+	if (s->flags & SEARCH_OFFSET_BOUND)
+		printf(", offset");
+	puts(");\n"
+	     "}\n"
+	     "");
+}
+
 /*
  * Print out a search function for an STYPE_ITERATE.
  * This calls a function pointer with the retrieved data.
+ * If "arena" is set, each row is released back to the arena after the
+ * callback unless the callback itself has allocated from the arena.
+ * If "after", this is the keyset pagination variant.
+ * If "borrow", this is the variant passing rows that point into the
+ * result set, so nothing is allocated or released per row.
  */
 static void
-gen_strct_func_iter(const struct config *cfg,
-	const struct search *s, size_t num)
+gen_strct_func_iter(const struct config *cfg, const struct search *s,
+	size_t num, int arena, int after, int borrow)
 {
 	const struct sent	*sent;
 	const struct strct 	*retstr;
-	size_t			 pos, idx, parms = 0;
+	size_t			 pos, idx, parms = 0, psz;
 
 	retstr = s->dst != NULL ? s->dst->strct : s->parent;
 
@@ -460,53 +819,69 @@ gen_strct_func_iter(const struct config *cfg,
 		if (OPTYPE_ISBINARY(sent->op))
 			parms += query_count_bindfuncs
 				(sent->field->type, sent->op);
+	parms += search_bound_parms(s);
+
+	psz = parms + (after ? search_page_parms(s) : 0);
 
 	/* Emit top of the function w/optional static parameters. */
 
-	print_func_db_search(s, 0);
+	if (after)
+		print_func_db_search_after(s, 0);
+	else if (borrow)
+		print_func_db_search_borrow(s, 0);
+	else
+		print_func_db_search(s, 0);
 	printf("\n"
 	       "{\n"
 	       "\tstruct %s p;\n"
 	       "\tconst struct sqlbox_parmset *res;\n"
-	       "\tstruct sqlbox *db = ctx->db;\n",
+	       "\tsize_t id;\n",
 	       retstr->name);
-	if (parms > 0)
-		printf("\tstruct sqlbox_parm parms[%zu];\n", parms);
+	if (psz > 0)
+		printf("\tstruct sqlbox_parm parms[%zu];\n", psz);
+	if (after)
+		puts("\tenum stmt stmt;\n"
+		     "\tsize_t psz;");
+	if (arena && !borrow)
+		puts("\tsize_t mark, top;");
+	else if (borrow)
+		puts("\tsize_t mark;");
+	gen_search_passcache(s, 1);
+	gen_search_in(s, 1);
 
 	/* Emit parameter binding. */
 
 	puts("");
-	if (parms > 0)
+	if (psz > 0)
 		puts("\tmemset(parms, 0, sizeof(parms));");
 
 	pos = idx = 1;
 	TAILQ_FOREACH(sent, &s->sntq, entries)
 		if (OPTYPE_ISBINARY(sent->op)) {
-			pos += query_gen_bindfunc
+			idx += query_gen_bindfunc
 				(sent->field->type, idx, pos, sent->op);
-			idx++;
+			pos++;
 		}
+	gen_search_bind_bounds(s, idx);
 
 	/* Stipulate multiple returned entries. */
 
 	puts("");
-	printf("\tif (!sqlbox_prepare_bind_async\n"
-	       "\t    (db, 0, STMT_%s_BY_SEARCH_%zu,\n"
-	       "\t     %zu, %s, SQLBOX_STMT_MULTI))\n"
-	       "\t	exit(EXIT_FAILURE);\n",
-	       s->parent->name, num, parms,
-	       parms > 0 ? "parms" : "NULL");
+	gen_search_bind(s, num, parms, pos, after, "SQLBOX_STMT_MULTI");
 
 	/* Step til none left. */
 
-	printf("\twhile ((res = sqlbox_step(db, 0)) "
-			"!= NULL && res->psz) {\n"
-	       "\t\tdb_%s_fill_r(ctx, &p, res, NULL);\n",
-	       retstr->name);
-	if ((retstr->flags & STRCT_HAS_NULLREFS))
-	       printf("\t\tdb_%s_reffind(%s&p, db);\n", 
-		     retstr->name,
-		     (!TAILQ_EMPTY(&cfg->rq)) ? "ctx, " : "");
+	if (borrow && !TAILQ_EMPTY(&cfg->rq))
+		puts("\tctx->store.role = ctx->role;");
+	if (borrow)
+		puts("\tmark = ctx->borrowsz;");
+	printf("\twhile ((res = db_stmt_step(ctx, id)) "
+			"!= NULL && res->psz) {\n");
+	if (arena && !borrow)
+		puts("\t\tmark = db_arena_mark(ctx);");
+	else if (borrow)
+		puts("\t\tdb_borrow_release(ctx, mark);");
+	gen_search_fill(s, num, "&p", borrow);
 
 	/* Conditional post-query password check. */
 
@@ -521,38 +896,65 @@ gen_strct_func_iter(const struct config *cfg,
 			continue;
 		}
 		printf("\t\tif ");
-		gen_print_checkpass(0, pos,
-			sent->fname, sent->op, sent->field);
-		printf(" {\n"
-		       "\t\t\tdb_%s_unfill_r(&p);\n"
-		       "\t\t\tcontinue;\n"
-		       "\t\t}\n",
-		       s->parent->name);
+		gen_print_checkpass(0, pos, sent->fname, 
+			sent->op, sent->field, sent_passcache(sent));
+		if (borrow)
+			puts("\n"
+			     "\t\t\tcontinue;");
+		else if (arena)
+			puts(" {\n"
+			     "\t\t\tdb_arena_release(ctx, mark);\n"
+			     "\t\t\tcontinue;\n"
+			     "\t\t}");
+		else
+			printf(" {\n"
+			       "\t\t\tdb_%s_unfill_r(&p);\n"
+			       "\t\t\tcontinue;\n"
+			       "\t\t}\n",
+			       s->parent->name);
 		pos++;
 	}
 
-	printf("\t\t(*cb)(&p, arg);\n"
-	       "\t\tdb_%s_unfill_r(&p);\n"
-	       "\t}\n"
-	       "\tif (res == NULL)\n"
-	       "\t\texit(EXIT_FAILURE);\n"
-	       "\tif (!sqlbox_finalise(db, 0))\n"
-	       "\t\texit(EXIT_FAILURE);\n"
-	       "}\n"
-	       "\n", retstr->name);
+	if (borrow) {
+		puts("\t\t(*cb)(&p, arg);\n"
+		     "\t}\n"
+		     "\tif (res == NULL)\n"
+		     "\t\texit(EXIT_FAILURE);\n"
+		     "\tdb_borrow_release(ctx, mark);");
+	} else if (arena) {
+		puts("\t\ttop = db_arena_mark(ctx);\n"
+		     "\t\t(*cb)(&p, arg);\n"
+		     "\t\tif (db_arena_mark(ctx) == top)\n"
+		     "\t\t\tdb_arena_release(ctx, mark);\n"
+		     "\t}\n"
+		     "\tif (res == NULL)\n"
+		     "\t\texit(EXIT_FAILURE);");
+	} else
+		printf("\t\t(*cb)(&p, arg);\n"
+		       "\t\tdb_%s_unfill_r(&p);\n"
+		       "\t}\n"
+		       "\tif (res == NULL)\n"
+		       "\t\texit(EXIT_FAILURE);\n",
+		       retstr->name);
+	gen_search_passcache(s, 0);
+	gen_search_done(s, num, after);
+	puts("}\n");
 }
 
 /*
  * Print out a search function for an STYPE_LIST.
  * This searches for a multiplicity of values.
+ * If "arena" is set, the queue and its members are allocated from the
+ * result arena.
+ * If "after", this is the keyset pagination variant.
  */
 static void
 gen_strct_func_list(const struct config *cfg, 
-	const struct search *s, size_t num)
+	const struct search *s, size_t num, int arena, int after)
 {
 	const struct sent	*sent;
 	const struct strct	*retstr;
-	size_t	 		 pos, parms = 0, idx;
+	size_t	 		 pos, parms = 0, idx, psz;
 
 	retstr = s->dst != NULL ? s->dst->strct : s->parent;
 
@@ -562,31 +964,49 @@ gen_strct_func_list(const struct config *cfg,
 		if (OPTYPE_ISBINARY(sent->op))
 			parms += query_count_bindfuncs
 				(sent->field->type, sent->op);
+	parms += search_bound_parms(s);
+
+	psz = parms + (after ? search_page_parms(s) : 0);
 
 	/* Emit top of the function w/optional static parameters. */
 
-	print_func_db_search(s, 0);
+	if (after)
+		print_func_db_search_after(s, 0);
+	else
+		print_func_db_search(s, 0);
 	printf("\n"
 	       "{\n"
 	       "\tstruct %s *p;\n"
 	       "\tstruct %s_q *q;\n"
 	       "\tconst struct sqlbox_parmset *res;\n"
-	       "\tstruct sqlbox *db = ctx->db;\n",
+	       "\tsize_t id;\n",
 	       retstr->name, retstr->name);
-	if (parms > 0)
-		printf("\tstruct sqlbox_parm parms[%zu];\n", parms);
+	if (psz > 0)
+		printf("\tstruct sqlbox_parm parms[%zu];\n", psz);
+	if (after)
+		puts("\tenum stmt stmt;\n"
+		     "\tsize_t psz;");
+	if (arena && search_has_hash(s))
+		puts("\tsize_t mark;");
+	gen_search_passcache(s, 1);
+	gen_search_in(s, 1);
 
 	puts("");
-	if (parms > 0)
+	if (psz > 0)
 		puts("\tmemset(parms, 0, sizeof(parms));");
 
-	printf("\tq = malloc(sizeof(struct %s_q));\n"
-	       "\tif (q == NULL) {\n"
-	       "\t\tperror(NULL);\n"
-	       "\t\texit(EXIT_FAILURE);\n"
-	       "\t}\n"
-	       "\tTAILQ_INIT(q);\n"
-	       "\n", retstr->name);
+	if (arena)
+		printf("\tq = db_arena_alloc(ctx, sizeof(struct %s_q));\n"
+		       "\tTAILQ_INIT(q);\n"
+		       "\n", retstr->name);
+	else
+		printf("\tq = malloc(sizeof(struct %s_q));\n"
+		       "\tif (q == NULL) {\n"
+		       "\t\tperror(NULL);\n"
+		       "\t\texit(EXIT_FAILURE);\n"
+		       "\t}\n"
+		       "\tTAILQ_INIT(q);\n"
+		       "\n", retstr->name);
 
 	/* Emit parameter binding. */
 
@@ -597,34 +1017,32 @@ gen_strct_func_list(const struct config *cfg,
 				(sent->field->type, idx, pos, sent->op);
 			pos++;
 		}
-	if (pos > 1)
+	gen_search_bind_bounds(s, idx);
+	if (idx > 1)
 		puts("");
 
 	/* Stipulate multiple returned entries. */
 
-	printf("\tif (!sqlbox_prepare_bind_async\n"
-	       "\t    (db, 0, STMT_%s_BY_SEARCH_%zu,\n"
-	       "\t     %zu, %s, SQLBOX_STMT_MULTI))\n"
-	       "\t	exit(EXIT_FAILURE);\n",
-	       s->parent->name, num, parms,
-	       parms > 0 ? "parms" : "NULL");
+	gen_search_bind(s, num, parms, pos, after, "SQLBOX_STMT_MULTI");
 
 	/* Step til none left. */
 
-	printf("\twhile ((res = sqlbox_step(db, 0)) != NULL "
-			"&& res->psz) {\n"
-	       "\t\tp = malloc(sizeof(struct %s));\n"
-	       "\t\tif (p == NULL) {\n"
-	       "\t\t\tperror(NULL);\n"
-	       "\t\t\texit(EXIT_FAILURE);\n"
-	       "\t\t}\n"
-	       "\t\tdb_%s_fill_r(ctx, p, res, NULL);\n",
-	       retstr->name, retstr->name);
-	if (STRCT_HAS_NULLREFS & retstr->flags)
-	       printf("\t\tdb_%s_reffind(%sp, db);\n",
-		      retstr->name,
-		      (!TAILQ_EMPTY(&cfg->rq)) ? 
-		      "ctx, " : "");
+	printf("\twhile ((res = db_stmt_step(ctx, id)) != NULL "
+			"&& res->psz) {\n");
+	if (arena && search_has_hash(s))
+		puts("\t\tmark = db_arena_mark(ctx);");
+	if (arena)
+		printf("\t\tp = db_arena_alloc"
+			"(ctx, sizeof(struct %s));\n",
+		       retstr->name);
+	else
+		printf("\t\tp = malloc(sizeof(struct %s));\n"
+		       "\t\tif (p == NULL) {\n"
+		       "\t\t\tperror(NULL);\n"
+		       "\t\t\texit(EXIT_FAILURE);\n"
+		       "\t\t}\n",
+		       retstr->name);
+	gen_search_fill(s, num, "p", 0);
 
 	/* Conditional post-query password check. */
 
@@ -639,108 +1057,300 @@ gen_strct_func_list(const struct config *cfg,
 			continue;
 		}
 		printf("\t\tif ");
-		gen_print_checkpass(1, pos,
-			sent->fname, sent->op, sent->field);
-		printf(" {\n"
-		       "\t\t\tdb_%s_free(p);\n"
-		       "\t\t\tp = NULL;\n"
-		       "\t\t\tcontinue;\n"
-		       "\t\t}\n",
-		       s->parent->name);
+		gen_print_checkpass(1, pos, sent->fname, 
+			sent->op, sent->field, sent_passcache(sent));
+		if (arena)
+			puts(" {\n"
+			     "\t\t\tdb_arena_release(ctx, mark);\n"
+			     "\t\t\tp = NULL;\n"
+			     "\t\t\tcontinue;\n"
+			     "\t\t}");
+		else
+			printf(" {\n"
+			       "\t\t\tdb_%s_free(p);\n"
+			       "\t\t\tp = NULL;\n"
+			       "\t\t\tcontinue;\n"
+			       "\t\t}\n",
+			       s->parent->name);
 		pos++;
 	}
 
 	puts("\t\tTAILQ_INSERT_TAIL(q, p, _entries);\n"
 	     "\t}\n"
 	     "\tif (res == NULL)\n"
-	     "\t\texit(EXIT_FAILURE);\n"
-	     "\tif (!sqlbox_finalise(db, 0))\n"
-	     "\t\texit(EXIT_FAILURE);\n"
-	     "\treturn q;\n"
-	     "}\n"
-	     "");
+	     "\t\texit(EXIT_FAILURE);");
+	gen_search_passcache(s, 0);
+	gen_search_done(s, num, after);
+	puts("\treturn q;\n"
+	     "}\n");
 }
 
 /*
- * Count all roles beneath a given role excluding "all".
- * Returns the number, which is never zero.
+ * Print out the contiguous array variant of a search function for an
+ * STYPE_LIST.
+ * Rows are filled in-place in an array grown geometrically.
+ * If "arena" is set, the array is allocated from the result arena.
  */
-static size_t
-gen_func_role_count(const struct role *role)
-{
-	size_t	 i = 0;
-	const struct role *r;
-
-	if (strcmp(role->name, "all"))
-		i++;
-	TAILQ_FOREACH(r, &role->subrq, entries)
-		i += gen_func_role_count(r);
-	return(i);
-}
-
 static void
-gen_func_roles(const struct role *r)
+gen_strct_func_array(const struct config *cfg, 
+	const struct search *s, size_t num, int arena)
 {
-	const struct role	*rr;
+	const struct sent	*sent;
+	const struct strct	*retstr;
+	size_t	 		 pos, parms = 0, idx;
 
-	if (r->parent != NULL &&
-	    strcmp(r->parent->name, "all") && 
-	    strcmp(r->parent->name, "none"))
-		printf("\tif (!sqlbox_role_hier_child"
-			 "(hier, ROLE_%s, ROLE_%s))\n"
-		       "\t\tgoto err;\n",
-		       r->parent->name, r->name);
+	retstr = s->dst != NULL ? s->dst->strct : s->parent;
 
-	TAILQ_FOREACH(rr, &r->subrq, entries)
-		gen_func_roles(rr);
-}
+	/* Count all possible parameters to bind. */
 
-/*
- * Actually print the sqlbox_role_hier_stmt() function for the statement
- * enumeration in "stmt".
- * This does nothing if we're doing the "all" or "none" role.
- */
-static void
-gen_func_role_stmt(const struct role *r, const char *stmt)
-{
+	TAILQ_FOREACH(sent, &s->sntq, entries)
+		if (OPTYPE_ISBINARY(sent->op))
+			parms += query_count_bindfuncs
+				(sent->field->type, sent->op);
+	parms += search_bound_parms(s);
 
-	if (strcmp(r->name, "all") == 0 ||
-	    strcmp(r->name, "none") == 0)
-		return;
-	printf("\tif (!sqlbox_role_hier_stmt(hier, ROLE_%s, %s))\n"
-	       "\t\tgoto err;\n", r->name, stmt);
-}
+	print_func_db_search_array(s, 0);
+	printf("\n"
+	       "{\n"
+	       "\tstruct %s *p, *rows;\n"
+	       "\tstruct %s_array *a;\n"
+	       "\tsize_t max = 0;\n"
+	       "\tconst struct sqlbox_parmset *res;\n"
+	       "\tsize_t id;\n",
+	       retstr->name, retstr->name);
+	if (parms > 0)
+		printf("\tstruct sqlbox_parm parms[%zu];\n", parms);
+	if (arena && search_has_hash(s))
+		puts("\tsize_t mark;");
+	gen_search_passcache(s, 1);
+	gen_search_in(s, 1);
 
-/*
- * Print the sqlbox_role_hier_stmt() for all roles.
- * This means that we print for the immediate children of the "all"
- * role and let the hierarchical algorithm handle the rest.
- */
-static void
-gen_func_role_stmts_all(const struct config *cfg, const char *stmt)
-{
-	const struct role	*r, *rr;
+	puts("");
+	if (parms > 0)
+		puts("\tmemset(parms, 0, sizeof(parms));");
+
+	if (arena)
+		printf("\ta = db_arena_alloc"
+			"(ctx, sizeof(struct %s_array));\n"
+		       "\ta->rows = NULL;\n"
+		       "\ta->len = 0;\n"
+		       "\n", retstr->name);
+	else
+		printf("\ta = calloc(1, sizeof(struct %s_array));\n"
+		       "\tif (a == NULL) {\n"
+		       "\t\tperror(NULL);\n"
+		       "\t\texit(EXIT_FAILURE);\n"
+		       "\t}\n"
+		       "\n", retstr->name);
+
+	/* Emit parameter binding. */
+
+	pos = idx = 1;
+	TAILQ_FOREACH(sent, &s->sntq, entries)
+		if (OPTYPE_ISBINARY(sent->op)) {
+			idx += query_gen_bindfunc
+				(sent->field->type, idx, pos, sent->op);
+			pos++;
+		}
+	gen_search_bind_bounds(s, idx);
+	if (idx > 1)
+		puts("");
+
+	printf("\tid = db_stmt_bind(ctx, STMT_%s_BY_SEARCH_%zu,\n"
+	       "\t    %zu, %s, SQLBOX_STMT_MULTI, 1);\n",
+	       s->parent->name, num, parms,
+	       parms > 0 ? "parms" : "NULL");
+	gen_search_in(s, 0);
+
+	/* 
+	 * Grow the array before filling in the next row.
+	 * In arena mode, this happens before the mark so that a failed
+	 * password check doesn't release the array itself.
+	 */
+
+	printf("\twhile ((res = db_stmt_step(ctx, id)) != NULL "
+			"&& res->psz) {\n"
+	       "\t\tif (a->len == max) {\n"
+	       "\t\t\tmax = max == 0 ? 16 : max * 2;\n"
+	       "\t\t\tif (max > SIZE_MAX / sizeof(struct %s))\n"
+	       "\t\t\t\texit(EXIT_FAILURE);\n",
+	       retstr->name);
+	if (arena)
+		printf("\t\t\trows = db_arena_alloc(ctx, "
+			"max * sizeof(struct %s));\n"
+		       "\t\t\tif (a->len > 0)\n"
+		       "\t\t\t\tmemcpy(rows, a->rows, "
+			"a->len * sizeof(struct %s));\n",
+		       retstr->name, retstr->name);
+	else
+		printf("\t\t\trows = realloc(a->rows, "
+			"max * sizeof(struct %s));\n"
+		       "\t\t\tif (rows == NULL) {\n"
+		       "\t\t\t\tperror(NULL);\n"
+		       "\t\t\t\texit(EXIT_FAILURE);\n"
+		       "\t\t\t}\n",
+		       retstr->name);
+	puts("\t\t\ta->rows = rows;\n"
+	     "\t\t}");
+	if (arena && search_has_hash(s))
+		puts("\t\tmark = db_arena_mark(ctx);");
+	puts("\t\tp = &a->rows[a->len];");
+	gen_search_fill(s, num, "p", 0);
+
+	/* Conditional post-query password check. */
+
+	pos = 1;
+	TAILQ_FOREACH(sent, &s->sntq, entries) {
+		if (OPTYPE_ISUNARY(sent->op))
+			continue;
+		if (sent->field->type != FTYPE_PASSWORD ||
+		    sent->op == OPTYPE_STREQ ||
+		    sent->op == OPTYPE_STRNEQ) {
+			pos++;
+			continue;
+		}
+		printf("\t\tif ");
+		gen_print_checkpass(1, pos, sent->fname, 
+			sent->op, sent->field, sent_passcache(sent));
+		if (arena)
+			puts(" {\n"
+			     "\t\t\tdb_arena_release(ctx, mark);\n"
+			     "\t\t\tcontinue;\n"
+			     "\t\t}");
+		else
+			printf(" {\n"
+			       "\t\t\tdb_%s_unfill_r(p);\n"
+			       "\t\t\tcontinue;\n"
+			       "\t\t}\n",
+			       retstr->name);
+		pos++;
+	}
+
+	puts("\t\ta->len++;\n"
+	     "\t}\n"
+	     "\tif (res == NULL)\n"
+	     "\t\texit(EXIT_FAILURE);");
+	gen_search_passcache(s, 0);
+	printf("\tdb_stmt_done(ctx, STMT_%s_BY_SEARCH_%zu, id);\n"
+	       "\treturn a;\n"
+	       "}\n"
+	       "\n", s->parent->name, num);
+}
+
+/*
+ * Count all roles beneath a given role excluding "all".
+ * Returns the number, which is never zero.
+ */
+static size_t
+gen_func_role_count(const struct role *role)
+{
+	size_t	 i = 0;
+	const struct role *r;
+
+	if (strcmp(role->name, "all"))
+		i++;
+	TAILQ_FOREACH(r, &role->subrq, entries)
+		i += gen_func_role_count(r);
+	return(i);
+}
+
+/*
+ * A statement "stmt" granted to role "role" in the role table.
+ */
+struct	rolestmt {
+	const struct role	*role;
+	char			*stmt;
+};
+
+/*
+ * All statements granted to roles, in the order granted.
+ */
+struct	rolestmts {
+	struct rolestmt		*rs;
+	size_t			 rsz;
+};
+
+/*
+ * Grant the statement enumeration "stmt" to role "r".
+ * This does nothing if we're doing the "all" or "none" role.
+ * Returns FALSE on memory allocation failure.
+ */
+static int
+role_stmt_add(struct rolestmts *rs, const struct role *r, 
+	const char *stmt)
+{
+	void	*pp;
+
+	if (strcmp(r->name, "all") == 0 ||
+	    strcmp(r->name, "none") == 0)
+		return 1;
+	pp = reallocarray(rs->rs, rs->rsz + 1, sizeof(struct rolestmt));
+	if (pp == NULL)
+		return 0;
+	rs->rs = pp;
+	if ((rs->rs[rs->rsz].stmt = strdup(stmt)) == NULL)
+		return 0;
+	rs->rs[rs->rsz++].role = r;
+	return 1;
+}
+
+/*
+ * Grant the statement "stmt" to all roles.
+ * This means granting to the immediate children of the "all" role and
+ * letting inheritance handle the rest.
+ * Returns FALSE on memory allocation failure.
+ */
+static int
+role_stmt_add_all(struct rolestmts *rs, 
+	const struct config *cfg, const char *stmt)
+{
+	const struct role	*r, *rr;
 
 	TAILQ_FOREACH(r, &cfg->rq, entries)
 		if (strcmp(r->name, "all") == 0)
 			TAILQ_FOREACH(rr, &r->subrq, entries)
-				gen_func_role_stmt(rr, stmt);
+				if (!role_stmt_add(rs, rr, stmt))
+					return 0;
+	return 1;
 }
 
 /*
- * For structure "p", print all roles capable of all operations.
- * Return >1 if we've printed statements, <0 on memory allocation
- * failure, and 0 otherwise (success, no statements).
+ * Grant the statement "stmt" to all roles in "rolemap", which may be
+ * NULL if the operation has no roles.
+ * Returns FALSE on memory allocation failure.
  */
 static int
-gen_func_role_stmts(const struct config *cfg, const struct strct *p)
+role_stmt_add_map(struct rolestmts *rs, const struct config *cfg,
+	const struct rolemap *rolemap, const char *stmt)
+{
+	const struct rref	*rr;
+
+	if (rolemap == NULL)
+		return 1;
+	TAILQ_FOREACH(rr, &rolemap->rq, entries)
+		if (strcmp(rr->role->name, "all") == 0) {
+			if (!role_stmt_add_all(rs, cfg, stmt))
+				return 0;
+		} else if (!role_stmt_add(rs, rr->role, stmt))
+			return 0;
+	return 1;
+}
+
+/*
+ * For structure "p", grant statements to all roles capable of all
+ * operations.
+ * Returns FALSE on memory allocation failure.
+ */
+static int
+role_stmts_strct(struct rolestmts *rs, 
+	const struct config *cfg, const struct strct *p)
 {
-	const struct rref	*rs;
 	const struct search 	*s;
 	const struct update 	*u;
 	const struct field 	*f;
-	size_t	 		 pos, shown = 0;
+	size_t	 		 i, pos;
 	char			*buf;
+	int			 c;
 
 	/* 
 	 * FIXME: only do this if the role needs access to this, which
@@ -751,10 +1361,11 @@ gen_func_role_stmts(const struct config *cfg, const struct strct *p)
 		if ((f->flags & (FIELD_ROWID|FIELD_UNIQUE))) {
 			if (asprintf(&buf, "STMT_%s_BY_UNIQUE_%s",
 			    p->name, f->name) < 0)
-				return -1;
-			gen_func_role_stmts_all(cfg, buf);
-			shown++;
+				return 0;
+			c = role_stmt_add_all(rs, cfg, buf);
 			free(buf);
+			if (!c)
+				return 0;
 		}
 
 	/* Start with all query types. */
@@ -762,32 +1373,56 @@ gen_func_role_stmts(const struct config *cfg, const struct strct *p)
 	pos = 0;
 	TAILQ_FOREACH(s, &p->sq, entries) {
 		pos++;
-		if (s->rolemap == NULL)
-			continue;
 		if (asprintf(&buf, "STMT_%s_BY_SEARCH_%zu", 
 		    p->name, pos - 1) < 0)
-			return -1;
-		TAILQ_FOREACH(rs, &s->rolemap->rq, entries)
-			if (strcmp(rs->role->name, "all") == 0)
-				gen_func_role_stmts_all(cfg, buf);
-			else
-				gen_func_role_stmt(rs->role, buf);
-		shown++;
+			return 0;
+		c = role_stmt_add_map(rs, cfg, s->rolemap, buf);
 		free(buf);
+		if (!c)
+			return 0;
+		if (!(s->flags & SEARCH_PAGINATE))
+			continue;
+		for (i = 0; i < 2; i++) {
+			if (asprintf(&buf, "STMT_%s_BY_SEARCH_%zu_%s", 
+			    p->name, pos - 1, 
+			    i == 0 ? "PAGE" : "AFTER") < 0)
+				return 0;
+			c = role_stmt_add_map(rs, cfg, s->rolemap, buf);
+			free(buf);
+			if (!c)
+				return 0;
+		}
 	}
 
 	/* Next: insertions. */
 
-	if (p->ins != NULL && p->ins->rolemap != NULL) {
+	if (p->ins != NULL) {
 		if (asprintf(&buf, "STMT_%s_INSERT", p->name) < 0)
-			return -1;
-		TAILQ_FOREACH(rs, &p->ins->rolemap->rq, entries)
-			if (strcmp(rs->role->name, "all") == 0)
-				gen_func_role_stmts_all(cfg, buf);
-			else
-				gen_func_role_stmt(rs->role, buf);
-		shown++;
+			return 0;
+		c = role_stmt_add_map(rs, cfg, p->ins->rolemap, buf);
+		free(buf);
+		if (!c)
+			return 0;
+	}
+	if (p->ins != NULL && (p->ins->flags & INSERT_RETURNING)) {
+		if (asprintf(&buf, "STMT_%s_INSERT_RETURNING", 
+		    p->name) < 0)
+			return 0;
+		c = role_stmt_add_map(rs, cfg, p->ins->rolemap, buf);
+		free(buf);
+		if (!c)
+			return 0;
+	}
+
+	/* Next: upserts. */
+
+	if (p->ups != NULL) {
+		if (asprintf(&buf, "STMT_%s_UPSERT", p->name) < 0)
+			return 0;
+		c = role_stmt_add_map(rs, cfg, p->ups->rolemap, buf);
 		free(buf);
+		if (!c)
+			return 0;
 	}
 
 	/* Next: updates. */
@@ -795,18 +1430,22 @@ gen_func_role_stmts(const struct config *cfg, const struct strct *p)
 	pos = 0;
 	TAILQ_FOREACH(u, &p->uq, entries) {
 		pos++;
-		if (u->rolemap == NULL)
-			continue;
 		if (asprintf(&buf, "STMT_%s_UPDATE_%zu", 
 		    p->name, pos - 1) < 0)
-			return -1;
-		TAILQ_FOREACH(rs, &u->rolemap->rq, entries)
-			if (strcmp(rs->role->name, "all") == 0)
-				gen_func_role_stmts_all(cfg, buf);
-			else
-				gen_func_role_stmt(rs->role, buf);
-		shown++;
+			return 0;
+		c = role_stmt_add_map(rs, cfg, u->rolemap, buf);
 		free(buf);
+		if (!c)
+			return 0;
+		if (!(u->flags & UPDATE_RETURNING))
+			continue;
+		if (asprintf(&buf, "STMT_%s_UPDATE_%zu_RETURNING", 
+		    p->name, pos - 1) < 0)
+			return 0;
+		c = role_stmt_add_map(rs, cfg, u->rolemap, buf);
+		free(buf);
+		if (!c)
+			return 0;
 	}
 
 	/* Finally: deletions. */
@@ -814,172 +1453,436 @@ gen_func_role_stmts(const struct config *cfg, const struct strct *p)
 	pos = 0;
 	TAILQ_FOREACH(u, &p->dq, entries) {
 		pos++;
-		if (u->rolemap == NULL)
-			continue;
 		if (asprintf(&buf, "STMT_%s_DELETE_%zu", 
 		    p->name, pos - 1) < 0)
-			return -1;
-		TAILQ_FOREACH(rs, &u->rolemap->rq, entries)
-			if (strcmp(rs->role->name, "all") == 0)
-				gen_func_role_stmts_all(cfg, buf);
-			else
-				gen_func_role_stmt(rs->role, buf);
-		shown++;
+			return 0;
+		c = role_stmt_add_map(rs, cfg, u->rolemap, buf);
 		free(buf);
+		if (!c)
+			return 0;
 	}
 
-	return shown > 0;
+	return 1;
 }
 
 /*
- * Generate database opening.
- * We don't use the generic invocation, as we want foreign keys.
- * Returns TRUE on success, FALSE on memory allocation failure.
+ * Grant the database pragmas, run only when opening the database, to
+ * the "default" role.
+ * Returns FALSE on memory allocation failure.
  */
 static int
-gen_func_open(const struct config *cfg)
+role_stmts_database(struct rolestmts *rs, const struct config *cfg)
 {
-	const struct role 	*r;
-	const struct strct 	*p;
-	size_t			 i;
-	int			 c;
-
-	print_func_db_set_logging(0);
-	puts("{\n"
-	     "\n"
-	     "\tif (!sqlbox_msg_set_dat(ort->db, arg, sz))\n"
-	     "\t\texit(EXIT_FAILURE);\n"
-	     "}\n");
-	print_func_db_open(0);
-	puts("{\n"
-	     "\n"
-	     "\treturn db_open_logging(file, NULL, NULL, NULL);\n"
-	     "}\n");
-	print_func_db_open_logging(0);
-	puts("{\n"
-	     "\tsize_t i;\n"
-	     "\tstruct ort *ctx = NULL;\n"
-	     "\tstruct sqlbox_cfg cfg;\n"
-	     "\tstruct sqlbox *db = NULL;\n"
-	     "\tstruct sqlbox_pstmt pstmts[STMT__MAX];\n"
-	     "\tstruct sqlbox_src srcs[1] = {\n"
-	     "\t\t{ .fname = (char *)file,\n"
-	     "\t\t  .mode = SQLBOX_SRC_RW }\n"
-	     "\t};");
-	if (!TAILQ_EMPTY(&cfg->rq))
-		puts("\tstruct sqlbox_role_hier *hier = NULL;");
-	puts("\n"
-	     "\tmemset(&cfg, 0, sizeof(struct sqlbox_cfg));\n"
-	     "\tcfg.msg.func = log;\n"
-	     "\tcfg.msg.func_short = log_short;\n"
-	     "\tcfg.msg.dat = log_arg;\n"
-	     "\tcfg.srcs.srcs = srcs;\n"
-	     "\tcfg.srcs.srcsz = 1;\n"
-	     "\tcfg.stmts.stmts = pstmts;\n"
-	     "\tcfg.stmts.stmtsz = STMT__MAX;\n"
-	     "\n"
-	     "\tfor (i = 0; i < STMT__MAX; i++)\n"
-	     "\t\tpstmts[i].stmt = (char *)stmts[i];\n"
-	     "\n"
-	     "\tctx = malloc(sizeof(struct ort));\n"
-	     "\tif (ctx == NULL)\n"
-	     "\t\tgoto err;\n");
+	const struct database	*db = cfg->db;
+	const struct role	*r;
 
-	if (!TAILQ_EMPTY(&cfg->rq)) {
-		/*
-		 * We need an complete count of all roles except the
-		 * "all" role, which cannot be entered or processed.
-		 * So do this recursively.
-		 */
-
-		i = 0;
-		TAILQ_FOREACH(r, &cfg->rq, entries)
-			i += gen_func_role_count(r);
-		assert(i > 0);
-		printf("\thier = sqlbox_role_hier_alloc(%zu);\n"
-		       "\tif (hier == NULL)\n"
-		       "\t\tgoto err;\n"
-		       "\n", i);
+	TAILQ_FOREACH(r, &cfg->rq, entries)
+		if (strcmp(r->name, "default") == 0)
+			break;
+	assert(r != NULL);
 
-		print_commentt(1, COMMENT_C, "Assign roles.");
+	if (db->journal != JOURNAL_UNSET &&
+	    !role_stmt_add(rs, r, "STMT__PRAGMA_JOURNAL"))
+		return 0;
+	if (db->sync != SYNCMODE_UNSET &&
+	    !role_stmt_add(rs, r, "STMT__PRAGMA_SYNC"))
+		return 0;
+	if (db->temp != TEMPSTORE_UNSET &&
+	    !role_stmt_add(rs, r, "STMT__PRAGMA_TEMP"))
+		return 0;
+	if ((db->flags & DATABASE_MMAP) &&
+	    !role_stmt_add(rs, r, "STMT__PRAGMA_MMAP"))
+		return 0;
+	if ((db->flags & DATABASE_CACHE) &&
+	    !role_stmt_add(rs, r, "STMT__PRAGMA_CACHE"))
+		return 0;
+	return 1;
+}
 
-		/* 
-		 * FIXME: the default role should only be able to open
-		 * the database once.
-		 * With this, it's able to do so multiple times and
-		 * that's not a permission it needs.
-		 */
+/*
+ * Whether role "r" is "anc" or one of its descendents.
+ */
+static int
+role_is_under(const struct role *r, const struct role *anc)
+{
 
-		puts("\n"
-		     "\tif (!sqlbox_role_hier_sink(hier, ROLE_none))\n"
-		     "\t\tgoto err;\n"
-		     "\tif (!sqlbox_role_hier_start(hier, ROLE_default))\n"
-		     "\t\tgoto err;\n"
-		     "\tif (!sqlbox_role_hier_src(hier, ROLE_default, 0))\n"
-		     "\t\tgoto err;");
+	for ( ; r != NULL; r = r->parent)
+		if (r == anc)
+			return 1;
+	return 0;
+}
 
-		TAILQ_FOREACH(r, &cfg->rq, entries)
-			gen_func_roles(r);
+/*
+ * Print the statements permitted to role "r": those granted to it or
+ * to any of its ancestors, each only once.
+ * If "print" is not set, only count them.
+ * Returns the number of statements.
+ */
+static size_t
+gen_role_table_stmts(const struct rolestmts *rs, 
+	const struct role *r, int print)
+{
+	size_t	 i, j, n = 0;
 
-		puts("");
-		TAILQ_FOREACH(p, &cfg->sq, entries) {
-			print_commentv(1, COMMENT_C, 
-				"White-listing fields and "
-				"operations for structure \"%s\".",
-				p->name);
-			puts("");
-			if ((c = gen_func_role_stmts(cfg, p)) < 0)
-				return 0;
-			else if (c > 0)
-				puts("");
-		}
-		printf("\tif (!sqlbox_role_hier_gen"
-			"(hier, &cfg.roles, ROLE_default))\n"
-		       "\t\tgoto err;\n\n");
+	for (i = 0; i < rs->rsz; i++) {
+		if (!role_is_under(r, rs->rs[i].role))
+			continue;
+		for (j = 0; j < i; j++)
+			if (role_is_under(r, rs->rs[j].role) &&
+			    strcmp(rs->rs[i].stmt, rs->rs[j].stmt) == 0)
+				break;
+		if (j < i)
+			continue;
+		if (print && n == 0)
+			printf("static\tsize_t "
+				"ort_role_stmts_%s[] = {", r->name);
+		if (print)
+			printf("\n\t%s,", rs->rs[i].stmt);
+		n++;
 	}
+	if (print && n > 0)
+		puts("\n};");
+	return n;
+}
 
-	puts("\tif ((db = sqlbox_alloc(&cfg)) == NULL)\n"
-	     "\t\tgoto err;\n"
-	     "\tctx->db = db;");
-
-	if (!TAILQ_EMPTY(&cfg->rq))
-	        puts("\tctx->role = ROLE_default;\n"
-		     "\n"
-		     "\tsqlbox_role_hier_gen_free(&cfg.roles);\n"
-		     "\tsqlbox_role_hier_free(hier);\n"
-		     "\thier = NULL;\n");
-	else
-		puts("");
+/*
+ * Print all roles beneath and including "r" but for "all" and
+ * "default".
+ */
+static void
+gen_role_table_trans_all(const struct role *r)
+{
+	const struct role	*rr;
 
-	print_commentv(1, COMMENT_C, 
-		"Now actually open the database.\n"
-		"If this succeeds, then we're good to go.");
+	if (strcmp(r->name, "all") && strcmp(r->name, "default"))
+		printf("\n\tROLE_%s,", r->name);
+	TAILQ_FOREACH(rr, &r->subrq, entries)
+		gen_role_table_trans_all(rr);
+}
 
-	puts("\n"
-	     "\tif (sqlbox_open_async(db, 0))\n"
-	     "\t\treturn ctx;\n"
-	     "err:");
+/*
+ * Print the roles that role "r" may transition into: itself, "none",
+ * and its ancestors (excluding "all").
+ * The "default" role may transition into any role and "none" into no
+ * role but itself.
+ */
+static void
+gen_role_table_trans(const struct config *cfg, const struct role *r)
+{
+	const struct role	*rp;
+
+	printf("static\tsize_t ort_role_trans_%s[] = {\n"
+	       "\tROLE_%s,", r->name, r->name);
+	if (strcmp(r->name, "default") == 0) {
+		TAILQ_FOREACH(rp, &cfg->rq, entries)
+			if (strcmp(rp->name, "default"))
+				gen_role_table_trans_all(rp);
+	} else if (strcmp(r->name, "none")) {
+		printf("\n\tROLE_none,");
+		for (rp = r->parent; rp != NULL && 
+		     strcmp(rp->name, "all"); rp = rp->parent)
+			printf("\n\tROLE_%s,", rp->name);
+	}
+	puts("\n};");
+}
 
-	if (!TAILQ_EMPTY(&cfg->rq))
-		puts("\tsqlbox_role_hier_gen_free(&cfg.roles);\n"
-	     	     "\tsqlbox_role_hier_free(hier);");
+/*
+ * Print the per-role tables for "r" and its sub-roles, skipping "all".
+ */
+static void
+gen_role_table_r(const struct config *cfg, 
+	const struct rolestmts *rs, const struct role *r)
+{
+	const struct role	*rr;
 
-	puts("\tsqlbox_free(db);\n"
-	     "\tfree(ctx);\n"
-	     "\treturn NULL;\n"
-	     "}\n"
-	     "");
-	return 1;
+	if (strcmp(r->name, "all")) {
+		gen_role_table_trans(cfg, r);
+		gen_role_table_stmts(rs, r, 1);
+	}
+	TAILQ_FOREACH(rr, &r->subrq, entries)
+		gen_role_table_r(cfg, rs, rr);
 }
 
+/*
+ * Print the table entry of "r" and its sub-roles, skipping "all".
+ * Only "default" may open the database.
+ */
 static void
-gen_func_rolecases(const struct role *r)
+gen_role_table_ent(const struct rolestmts *rs, const struct role *r)
 {
-	const struct role *rp, *rr;
-
-	assert(NULL != r->parent);
+	const struct role	*rr;
 
-	printf("\tcase ROLE_%s:\n", r->name);
+	if (strcmp(r->name, "all")) {
+		printf("\t[ROLE_%s] = {\n"
+		       "\t\t.roles = ort_role_trans_%s,\n"
+		       "\t\t.rolesz = ORT_NITEMS(ort_role_trans_%s),\n",
+		       r->name, r->name, r->name);
+		if (gen_role_table_stmts(rs, r, 0) > 0)
+			printf("\t\t.stmts = ort_role_stmts_%s,\n"
+			       "\t\t.stmtsz = "
+				"ORT_NITEMS(ort_role_stmts_%s),\n",
+			       r->name, r->name);
+		if (strcmp(r->name, "default") == 0)
+			puts("\t\t.srcs = ort_role_srcs_default,\n"
+			     "\t\t.srcsz = 1,");
+		puts("\t},");
+	}
+	TAILQ_FOREACH(rr, &r->subrq, entries)
+		gen_role_table_ent(rs, rr);
+}
+
+/*
+ * Generate the static role table passed to sqlbox_alloc(3).
+ * The role tree and statements are known now, so we compute the full
+ * set of permitted statements and transitions for each role here
+ * instead of having sqlbox_role_hier_gen(3) do so on each open.
+ * Returns TRUE on success, FALSE on memory allocation failure.
+ */
+static int
+gen_role_table(const struct config *cfg)
+{
+	const struct role	*r;
+	const struct strct	*p;
+	struct rolestmts	 rs;
+	size_t			 i;
+	int			 rc = 0;
+
+	memset(&rs, 0, sizeof(struct rolestmts));
+	TAILQ_FOREACH(p, &cfg->sq, entries)
+		if (!role_stmts_strct(&rs, cfg, p))
+			goto out;
+	if (cfg->db != NULL && !role_stmts_database(&rs, cfg))
+		goto out;
+
+	i = 0;
+	TAILQ_FOREACH(r, &cfg->rq, entries)
+		i += gen_func_role_count(r);
+	assert(i > 0);
+
+	print_commentt(0, COMMENT_C,
+		"Role permissions computed from the role tree.\n"
+		"Each role may use the statements granted to it "
+		"and to its ancestors, and may transition into "
+		"its ancestors or the \"none\" role.");
+	puts("#define ORT_NITEMS(_a) (sizeof(_a) / sizeof((_a)[0]))\n"
+	     "\n"
+	     "static\tsize_t ort_role_srcs_default[] = { 0, 1 };");
+	TAILQ_FOREACH(r, &cfg->rq, entries)
+		gen_role_table_r(cfg, &rs, r);
+	printf("\n"
+	       "static\tstruct sqlbox_role ort_roles[%zu] = {\n", i);
+	TAILQ_FOREACH(r, &cfg->rq, entries)
+		gen_role_table_ent(&rs, r);
+	puts("};\n");
+	rc = 1;
+out:
+	for (i = 0; i < rs.rsz; i++)
+		free(rs.rs[i].stmt);
+	free(rs.rs);
+	return rc;
+}
+
+/*
+ * Generate the function running the per-connection pragmas of "db" on
+ * a newly-opened source.
+ * The journal mode and synchronisation are only set for the read-write
+ * source, as they're meaningless when reading.
+ */
+static void
+gen_func_pragmas(const struct database *db)
+{
+
+	print_commentt(0, COMMENT_C,
+		"Run the pragmas of the \"database\" block on "
+		"source \"src\", skipping those only affecting "
+		"writes if \"ro\" is set.\n"
+		"Returns zero on failure, non-zero on success.");
+	puts("static int\n"
+	     "db_pragmas(struct sqlbox *db, size_t src, int ro)\n"
+	     "{\n"
+	     "\tsize_t i, id;\n"
+	     "\tconst struct {\n"
+	     "\t\tenum stmt stmt;\n"
+	     "\t\tint ro;\n"
+	     "\t} pragmas[] = {");
+	if (db->journal != JOURNAL_UNSET)
+		puts("\t\t{ STMT__PRAGMA_JOURNAL, 0 },");
+	if (db->sync != SYNCMODE_UNSET)
+		puts("\t\t{ STMT__PRAGMA_SYNC, 0 },");
+	if (db->temp != TEMPSTORE_UNSET)
+		puts("\t\t{ STMT__PRAGMA_TEMP, 1 },");
+	if (db->flags & DATABASE_MMAP)
+		puts("\t\t{ STMT__PRAGMA_MMAP, 1 },");
+	if (db->flags & DATABASE_CACHE)
+		puts("\t\t{ STMT__PRAGMA_CACHE, 1 },");
+	puts("\t};\n"
+	     "\n"
+	     "\tfor (i = 0; i < sizeof(pragmas) / sizeof(pragmas[0]); i++) {\n"
+	     "\t\tif (ro && !pragmas[i].ro)\n"
+	     "\t\t\tcontinue;\n"
+	     "\t\tid = sqlbox_prepare_bind_async\n"
+	     "\t\t\t(db, src, pragmas[i].stmt, 0, NULL, 0);\n"
+	     "\t\tif (id == 0 ||\n"
+	     "\t\t    sqlbox_step(db, id) == NULL ||\n"
+	     "\t\t    !sqlbox_finalise(db, id))\n"
+	     "\t\t\treturn 0;\n"
+	     "\t}\n"
+	     "\treturn 1;\n"
+	     "}\n");
+}
+
+/*
+ * Generate database opening.
+ * We don't use the generic invocation, as we want foreign keys.
+ * The sqlbox(3) configuration is filled in by db_cfg_init() and used by
+ * db_open_cfg() to open a handle, which lets a pool share one
+ * configuration among all of its handles.
+ * With roles, this uses the static table from gen_role_table(), letting
+ * the default role also open the read-only source if given.
+ * The read-only source is opened first so that the read-write source,
+ * being opened last, is the default (zero) source of all operations
+ * not explicitly reading from the read-only source.
+ */
+static void
+gen_func_open(const struct config *cfg)
+{
+
+	print_commentt(0, COMMENT_C,
+		"Configuration used to open database handles.\n"
+		"The sqlbox(3) configuration points into the "
+		"other members, so this must not be moved once "
+		"initialised with db_cfg_init().");
+	puts("struct\tort_cfg {\n"
+	     "\tstruct sqlbox_cfg cfg;\n"
+	     "\tstruct sqlbox_pstmt pstmts[STMT__MAX];");
+	if (!TAILQ_EMPTY(&cfg->rq))
+		puts("\tstruct sqlbox_role roles[ORT_NITEMS(ort_roles)];");
+	puts("\tstruct sqlbox_src srcs[2];\n"
+	     "};\n");
+
+	print_commentt(0, COMMENT_C,
+		"Fill in \"oc\" for opening \"file\" and, if not "
+		"NULL, \"rofile\" with the given logging "
+		"functions.");
+	puts("static void\n"
+	     "db_cfg_init(struct ort_cfg *oc, const char *file,\n"
+	     "\tconst char *rofile, void (*log)(const char *, void *),\n"
+	     "\tvoid (*log_short)(const char *, ...), void *log_arg)\n"
+	     "{\n"
+	     "\tsize_t i;\n"
+	     "\tstruct sqlbox_cfg *cfg = &oc->cfg;\n"
+	     "\n"
+	     "\tmemset(oc, 0, sizeof(struct ort_cfg));\n"
+	     "\toc->srcs[0].fname = (char *)file;\n"
+	     "\toc->srcs[0].mode = SQLBOX_SRC_RW;\n"
+	     "\toc->srcs[1].fname = (char *)rofile;\n"
+	     "\toc->srcs[1].mode = SQLBOX_SRC_RO;\n"
+	     "\tcfg->msg.func = log;\n"
+	     "\tcfg->msg.func_short = log_short;\n"
+	     "\tcfg->msg.dat = log_arg;\n"
+	     "\tcfg->srcs.srcs = oc->srcs;\n"
+	     "\tcfg->srcs.srcsz = rofile == NULL ? 1 : 2;\n"
+	     "\tcfg->stmts.stmts = oc->pstmts;\n"
+	     "\tcfg->stmts.stmtsz = STMT__MAX;");
+	if (!TAILQ_EMPTY(&cfg->rq))
+		puts("\tmemcpy(oc->roles, ort_roles, sizeof(oc->roles));\n"
+		     "\toc->roles[ROLE_default].srcsz = cfg->srcs.srcsz;\n"
+		     "\tcfg->roles.roles = oc->roles;\n"
+		     "\tcfg->roles.rolesz = ORT_NITEMS(oc->roles);\n"
+		     "\tcfg->roles.defrole = ROLE_default;");
+	puts("\n"
+	     "\tfor (i = 0; i < STMT__MAX; i++)\n"
+	     "\t\toc->pstmts[i].stmt = (char *)stmts[i];\n"
+	     "}\n");
+
+	if (cfg->db != NULL)
+		gen_func_pragmas(cfg->db);
+
+	print_commentt(0, COMMENT_C,
+		"Open a database handle configured by \"oc\".\n"
+		"Returns NULL on failure.");
+	puts("static struct ort *\n"
+	     "db_open_cfg(struct ort_cfg *oc)\n"
+	     "{\n"
+	     "\tstruct ort *ctx = NULL;\n"
+	     "\tstruct sqlbox *db = NULL;\n"
+	     "\tint ro = oc->cfg.srcs.srcsz > 1;\n"
+	     "\n"
+	     "\tctx = calloc(1, sizeof(struct ort));\n"
+	     "\tif (ctx == NULL)\n"
+	     "\t\tgoto err;\n"
+	     "\n"
+	     "\tif ((db = sqlbox_alloc(&oc->cfg)) == NULL)\n"
+	     "\t\tgoto err;\n"
+	     "\tctx->db = db;");
+	if (!TAILQ_EMPTY(&cfg->rq))
+	        puts("\tctx->role = ROLE_default;");
+	puts("");
+
+	print_commentv(1, COMMENT_C, 
+		"Now actually open the database.\n"
+		"If this succeeds, then we're good to go.");
+
+	puts("\n"
+	     "\tif (ro && (ctx->rosrc = sqlbox_open(db, 1)) == 0)\n"
+	     "\t\tgoto err;");
+	if (cfg->db != NULL)
+		puts("\tif (!sqlbox_open_async(db, 0) ||\n"
+		     "\t    !db_pragmas(db, 0, 0))\n"
+		     "\t\tgoto err;\n"
+		     "\tif (ro && !db_pragmas(db, ctx->rosrc, 1))\n"
+		     "\t\tgoto err;\n"
+		     "\treturn ctx;");
+	else
+		puts("\tif (sqlbox_open_async(db, 0))\n"
+		     "\t\treturn ctx;");
+	puts("err:\n"
+	     "\tsqlbox_free(db);\n"
+	     "\tfree(ctx);\n"
+	     "\treturn NULL;\n"
+	     "}\n");
+
+	print_func_db_set_logging(0);
+	puts("{\n"
+	     "\n"
+	     "\tif (!sqlbox_msg_set_dat(ort->db, arg, sz))\n"
+	     "\t\texit(EXIT_FAILURE);\n"
+	     "}\n");
+	print_func_db_open(0);
+	puts("{\n"
+	     "\n"
+	     "\treturn db_open_split_logging"
+	      "(file, NULL, NULL, NULL, NULL);\n"
+	     "}\n");
+	print_func_db_open_logging(0);
+	puts("{\n"
+	     "\n"
+	     "\treturn db_open_split_logging"
+	      "(file, NULL, log, log_short, log_arg);\n"
+	     "}\n");
+	print_func_db_open_split(0);
+	puts("{\n"
+	     "\n"
+	     "\treturn db_open_split_logging"
+	      "(file, rofile, NULL, NULL, NULL);\n"
+	     "}\n");
+	print_func_db_open_split_logging(0);
+	puts("{\n"
+	     "\tstruct ort_cfg oc;\n"
+	     "\n"
+	     "\tdb_cfg_init(&oc, file, rofile, log, log_short, log_arg);\n"
+	     "\treturn db_open_cfg(&oc);\n"
+	     "}\n");
+}
+
+static void
+gen_func_rolecases(const struct role *r)
+{
+	const struct role *rp, *rr;
+
+	assert(NULL != r->parent);
+
+	printf("\tcase ROLE_%s:\n", r->name);
 
 	/*
 	 * If our parent is "all", then there's nowhere we can
@@ -1002,109 +1905,1094 @@ gen_func_rolecases(const struct role *r)
 	for (rp = r->parent; strcmp(rp->name, "all"); rp = rp->parent)
 		printf("\t\tcase ROLE_%s:\n", rp->name);
 
-	puts("\t\t\tctx->role = r;\n"
-	     "\t\t\treturn;\n"
-	     "\t\tdefault:\n"
-	     "\t\t\tabort();\n"
-	     "\t\t}\n"
-	     "\t\tbreak;");
+	puts("\t\t\tctx->role = r;\n"
+	     "\t\t\treturn;\n"
+	     "\t\tdefault:\n"
+	     "\t\t\tabort();\n"
+	     "\t\t}\n"
+	     "\t\tbreak;");
+
+	TAILQ_FOREACH(rr, &r->subrq, entries)
+		gen_func_rolecases(rr);
+}
+
+static void
+gen_func_role_transitions(const struct config *cfg)
+{
+	const struct role *r, *rr;
+
+	TAILQ_FOREACH(r, &cfg->rq, entries)
+		if (0 == strcmp(r->name, "all"))
+			break;
+	assert(NULL != r);
+
+	print_func_db_role(0);
+	puts("{\n"
+	     "\tif (!sqlbox_role(ctx->db, r))\n"
+	     "\t\texit(EXIT_FAILURE);\n"
+	     "\tif (r == ctx->role)\n"
+	     "\t\treturn;\n"
+	     "\tif (ctx->role == ROLE_none)\n"
+	     "\t\tabort();\n"
+	     "\tdb_stmt_flush(ctx);\n"
+	     "\n"
+	     "\tswitch (ctx->role) {\n"
+	     "\tcase ROLE_default:\n"
+	     "\t\tctx->role = r;\n"
+	     "\t\treturn;");
+	TAILQ_FOREACH(rr, &r->subrq, entries)
+		gen_func_rolecases(rr);
+	puts("\tdefault:\n"
+	     "\t\tabort();\n"
+	     "\t}\n"
+	     "}\n");
+	print_func_db_role_current(0);
+	puts("{\n"
+	     "\treturn ctx->role;\n"
+	     "}\n");
+	print_func_db_role_stored(0);
+	puts("{\n"
+	     "\treturn s->role;\n"
+	     "}\n");
+}
+
+static void
+gen_func_trans(const struct config *cfg)
+{
+
+	print_func_db_trans_open(0);
+	puts("{\n"
+	     "\tstruct sqlbox *db = ctx->db;\n"
+	     "\tint c;\n"
+	     "\n"
+	     "\tif (mode < 0)\n"
+	     "\t\tc = sqlbox_trans_exclusive(db, 0, id);\n"
+	     "\telse if (mode > 0)\n"
+	     "\t\tc = sqlbox_trans_immediate(db, 0, id);\n"
+	     "\telse\n"
+	     "\t\tc = sqlbox_trans_deferred(db, 0, id);\n"
+	     "\tif (!c)\n"
+	     "\t\texit(EXIT_FAILURE);\n"
+	     "\tctx->trans++;\n"
+	     "}\n"
+	     "");
+	print_func_db_trans_rollback(0);
+	puts("{\n"
+	     "\tstruct sqlbox *db = ctx->db;\n"
+	     "\n"
+	     "\tif (!sqlbox_trans_rollback(db, 0, id))\n"
+	     "\t\texit(EXIT_FAILURE);\n"
+	     "\tctx->trans--;\n"
+	     "}\n"
+	     "");
+	print_func_db_trans_commit(0);
+	puts("{\n"
+	     "\tstruct sqlbox *db = ctx->db;\n"
+	     "\n"
+	     "\tif (!sqlbox_trans_commit(db, 0, id))\n"
+	     "\t\texit(EXIT_FAILURE);\n"
+	     "\tctx->trans--;\n"
+	     "}\n"
+	     "");
+}
+
+/*
+ * Whether "p" has an insert or update returning its row.
+ */
+static int
+strct_returning(const struct strct *p)
+{
+	const struct update	*u;
+
+	if (p->ins != NULL && (p->ins->flags & INSERT_RETURNING))
+		return 1;
+	TAILQ_FOREACH(u, &p->uq, entries)
+		if (u->flags & UPDATE_RETURNING)
+			return 1;
+	return 0;
+}
+
+/*
+ * Generate the per-statement statistics used when "stats" mode is
+ * enabled: recording a run and the public accessors.
+ * Statements run without binding (inserts, updates, and deletes) are
+ * timed around their execution; the others only within db_stmt_bind()
+ * and db_stmt_step(), so not while filling or in iterator callbacks.
+ */
+static void
+gen_func_stats(void)
+{
+
+	print_commentt(0, COMMENT_C,
+		"Return the nanoseconds elapsed since \"start\".");
+	puts("static uint64_t\n"
+	     "db_stats_since(const struct timespec *start)\n"
+	     "{\n"
+	     "\tstruct timespec end;\n"
+	     "\tint64_t nsec;\n"
+	     "\n"
+	     "\tclock_gettime(CLOCK_MONOTONIC, &end);\n"
+	     "\tnsec = (int64_t)(end.tv_sec - start->tv_sec) * "
+	      "1000000000 +\n"
+	     "\t    (end.tv_nsec - start->tv_nsec);\n"
+	     "\treturn nsec > 0 ? (uint64_t)nsec : 0;\n"
+	     "}\n");
+
+	print_commentt(0, COMMENT_C,
+		"Record a run of \"stmt\" taking \"nsec\" "
+		"nanoseconds and returning \"rows\" rows, then "
+		"invoke the slow-query callback if it took at least "
+		"its threshold.");
+	puts("static void\n"
+	     "db_stats_record(struct ort *ctx, enum stmt stmt,\n"
+	     "\tuint64_t nsec, uint64_t rows)\n"
+	     "{\n"
+	     "\tstruct ort_stmt_stats *st = &ctx->stats[stmt];\n"
+	     "\tuint64_t usec = nsec / 1000;\n"
+	     "\tsize_t b;\n"
+	     "\n"
+	     "\tst->calls++;\n"
+	     "\tst->rows += rows;\n"
+	     "\tst->total += usec;\n"
+	     "\tif (usec > st->max)\n"
+	     "\t\tst->max = usec;\n"
+	     "\tfor (b = 0; b < ORT_STATS_BUCKETS - 1 && "
+	      "(usec >> b) != 0; b++)\n"
+	     "\t\tcontinue;\n"
+	     "\tst->hist[b]++;\n"
+	     "\n"
+	     "\tif (ctx->slow != NULL && usec >= ctx->slow_usec)\n"
+	     "\t\tctx->slow(stmts[stmt], usec, ctx->slow_arg);\n"
+	     "}\n");
+
+	print_commentt(0, COMMENT_C,
+		"Record a run of \"stmt\" started at \"start\" and "
+		"returning \"rows\" rows.");
+	puts("static void\n"
+	     "db_stats_add(struct ort *ctx, enum stmt stmt,\n"
+	     "\tconst struct timespec *start, uint64_t rows)\n"
+	     "{\n"
+	     "\n"
+	     "\tdb_stats_record(ctx, stmt, db_stats_since(start), rows);\n"
+	     "}\n");
+
+	print_func_db_stats_get(0);
+	puts("{\n"
+	     "\n"
+	     "\tif (i >= STMT__MAX)\n"
+	     "\t\treturn 0;\n"
+	     "\t*out = ctx->stats[i];\n"
+	     "\tout->name = stmt_names[i];\n"
+	     "\tout->sql = stmts[i];\n"
+	     "\treturn 1;\n"
+	     "}\n");
+
+	print_func_db_stats_reset(0);
+	puts("{\n"
+	     "\n"
+	     "\tmemset(ctx->stats, 0, sizeof(ctx->stats));\n"
+	     "}\n");
+
+	print_func_db_stats_slow(0);
+	puts("{\n"
+	     "\n"
+	     "\tctx->slow = cb;\n"
+	     "\tctx->slow_usec = usec;\n"
+	     "\tctx->slow_arg = arg;\n"
+	     "}\n");
+}
+
+/*
+ * Generate the stack of statement runs used by db_stmt_bind() and
+ * db_stmt_done() when "stats" mode is enabled.
+ */
+static void
+gen_func_stats_runs(void)
+{
+
+	print_commentt(0, COMMENT_C,
+		"Start a run of \"stmt\", bound as \"id\", with the "
+		"time since \"start\" spent binding it.");
+	puts("static void\n"
+	     "db_stats_begin(struct ort *ctx, enum stmt stmt, size_t id,\n"
+	     "\tconst struct timespec *start)\n"
+	     "{\n"
+	     "\tvoid *pp;\n"
+	     "\n"
+	     "\tif (ctx->runsz == ctx->runmax) {\n"
+	     "\t\tpp = reallocarray(ctx->runs, ctx->runmax + 8,\n"
+	     "\t\t\tsizeof(struct ort_run));\n"
+	     "\t\tif (pp == NULL) {\n"
+	     "\t\t\tperror(NULL);\n"
+	     "\t\t\texit(EXIT_FAILURE);\n"
+	     "\t\t}\n"
+	     "\t\tctx->runs = pp;\n"
+	     "\t\tctx->runmax += 8;\n"
+	     "\t}\n"
+	     "\tctx->runs[ctx->runsz].id = id;\n"
+	     "\tctx->runs[ctx->runsz].stmt = stmt;\n"
+	     "\tctx->runs[ctx->runsz].nsec = db_stats_since(start);\n"
+	     "\tctx->runs[ctx->runsz].rows = 0;\n"
+	     "\tctx->runsz++;\n"
+	     "}\n");
+
+	print_commentt(0, COMMENT_C,
+		"Add the time since \"start\" spent stepping the "
+		"statement bound as \"id\" to its run, counting a row "
+		"if \"row\" is set.");
+	puts("static void\n"
+	     "db_stats_step(struct ort *ctx, size_t id,\n"
+	     "\tconst struct timespec *start, int row)\n"
+	     "{\n"
+	     "\tsize_t i;\n"
+	     "\n"
+	     "\tfor (i = ctx->runsz; i > 0; i--)\n"
+	     "\t\tif (ctx->runs[i - 1].id == id) {\n"
+	     "\t\t\tctx->runs[i - 1].nsec += "
+	      "db_stats_since(start);\n"
+	     "\t\t\tif (row)\n"
+	     "\t\t\t\tctx->runs[i - 1].rows++;\n"
+	     "\t\t\tbreak;\n"
+	     "\t\t}\n"
+	     "}\n");
+
+	print_commentt(0, COMMENT_C,
+		"Finish the run of the statement bound as \"id\" "
+		"and record it.");
+	puts("static void\n"
+	     "db_stats_end(struct ort *ctx, size_t id)\n"
+	     "{\n"
+	     "\tstruct ort_run run;\n"
+	     "\tsize_t i;\n"
+	     "\n"
+	     "\tfor (i = ctx->runsz; i > 0; i--)\n"
+	     "\t\tif (ctx->runs[i - 1].id == id)\n"
+	     "\t\t\tbreak;\n"
+	     "\tif (i-- == 0)\n"
+	     "\t\treturn;\n"
+	     "\trun = ctx->runs[i];\n"
+	     "\tmemmove(&ctx->runs[i], &ctx->runs[i + 1],\n"
+	     "\t\t(ctx->runsz - i - 1) * sizeof(struct ort_run));\n"
+	     "\tctx->runsz--;\n"
+	     "\tdb_stats_record(ctx, run.stmt, run.nsec, run.rows);\n"
+	     "}\n");
+}
+
+/*
+ * Generate the cache of prepared statements.
+ * Statements are prepared on first use and kept in "struct ort",
+ * subsequently only being rebound.
+ * A statement already in use (e.g., by a query within an iterator
+ * callback) falls back to a transient statement.
+ * Cached statements must not be left active when done, as SQLite then
+ * holds their read or write transaction open: one not stepped until
+ * done is stepped once more, which finishes single-row lookups, and
+ * otherwise finalised.
+ * This is used by searches, upserts, and the variants of inserts and
+ * updates returning their rows.
+ * If "stats" is set, the time spent binding and stepping statements is
+ * recorded along with their stepped rows, excluding whatever the caller
+ * does in between (filling, iterator callbacks).
+ */
+static void
+gen_func_stmt(const struct config *cfg, int stats)
+{
+	const struct strct	*p;
+
+	TAILQ_FOREACH(p, &cfg->sq, entries)
+		if (!TAILQ_EMPTY(&p->sq) || p->ups != NULL ||
+		    strct_returning(p))
+			break;
+	if (p == NULL)
+		goto flush;
+	if (stats)
+		gen_func_stats_runs();
+
+	print_commentt(0, COMMENT_C,
+		"Bind \"parms\" to the cached statement \"stmt\", "
+		"preparing it on first use.\n"
+		"If the cached statement is in use, prepare a "
+		"transient statement instead.\n"
+		"If \"ro\" is set, the statement only reads, so it's "
+		"prepared on the read-only source, if any, unless "
+		"within a transaction.\n"
+		"Returns the statement identifier, which must be "
+		"passed to db_stmt_done() when finished.");
+	puts("static size_t\n"
+	     "db_stmt_bind(struct ort *ctx, enum stmt stmt, size_t psz,\n"
+	     "\tconst struct sqlbox_parm *parms, unsigned long flags, "
+	      "int ro)\n"
+	     "{\n"
+	     "\tstruct ort_stmt *st = &ctx->stmts[stmt];\n"
+	     "\tsize_t id, src;");
+	if (stats)
+		puts("\tstruct timespec start;\n"
+		     "\n"
+		     "\tclock_gettime(CLOCK_MONOTONIC, &start);");
+	puts("\n"
+	     "\tsrc = ro && ctx->trans == 0 ? ctx->rosrc : 0;\n"
+	     "\tif (st->id != 0 && !st->busy && st->src == src) {\n"
+	     "\t\tif (!sqlbox_rebind(ctx->db, st->id, psz, parms))\n"
+	     "\t\t\texit(EXIT_FAILURE);\n"
+	     "\t\tst->busy = 1;\n"
+	     "\t\tst->done = 0;\n"
+	     "\t\tctx->stmt_hits++;");
+	if (stats)
+		puts("\t\tdb_stats_begin(ctx, stmt, st->id, &start);");
+	puts("\t\treturn st->id;\n"
+	     "\t}\n"
+	     "\tid = sqlbox_prepare_bind_async\n"
+	     "\t\t(ctx->db, src, stmt, psz, parms, flags);\n"
+	     "\tif (id == 0)\n"
+	     "\t\texit(EXIT_FAILURE);\n"
+	     "\tctx->stmt_misses++;\n"
+	     "\tif (st->id == 0) {\n"
+	     "\t\tst->id = id;\n"
+	     "\t\tst->src = src;\n"
+	     "\t\tst->busy = 1;\n"
+	     "\t\tst->done = 0;\n"
+	     "\t}");
+	if (stats)
+		puts("\tdb_stats_begin(ctx, stmt, id, &start);");
+	puts("\treturn id;\n"
+	     "}\n");
+	print_commentt(0, COMMENT_C,
+		"Step a statement from db_stmt_bind().\n"
+		"If it's cached and done, note this for "
+		"db_stmt_done().\n"
+		"Returns the result or NULL on failure.");
+	puts("static const struct sqlbox_parmset *\n"
+	     "db_stmt_step(struct ort *ctx, size_t id)\n"
+	     "{\n"
+	     "\tconst struct sqlbox_parmset *res;\n"
+	     "\tsize_t i;");
+	if (stats)
+		puts("\tstruct timespec start;\n"
+		     "\n"
+		     "\tclock_gettime(CLOCK_MONOTONIC, &start);");
+	puts("\n"
+	     "\tif ((res = sqlbox_step(ctx->db, id)) == NULL)\n"
+	     "\t\treturn NULL;");
+	if (stats)
+		puts("\tdb_stats_step(ctx, id, &start, res->psz != 0);");
+	puts("\tif (res->psz == 0)\n"
+	     "\t\tfor (i = 0; i < STMT__MAX; i++)\n"
+	     "\t\t\tif (ctx->stmts[i].id == id) {\n"
+	     "\t\t\t\tctx->stmts[i].done = 1;\n"
+	     "\t\t\t\tbreak;\n"
+	     "\t\t\t}\n"
+	     "\treturn res;\n"
+	     "}\n");
+	print_commentt(0, COMMENT_C,
+		"Finish with a statement from db_stmt_bind().\n"
+		"Cached statements are kept for re-use once stepped "
+		"until done, so that they no longer hold a "
+		"transaction open: if not yet done, they're stepped "
+		"once more (finishing single-row lookups), then "
+		"finalised if still not done.\n"
+		"Transient statements are finalised.");
+	puts("static void\n"
+	     "db_stmt_done(struct ort *ctx, enum stmt stmt, size_t id)\n"
+	     "{\n"
+	     "\tstruct ort_stmt *st = &ctx->stmts[stmt];\n"
+	     "\n"
+	     "\tif (st->id == id && !st->done &&\n"
+	     "\t    db_stmt_step(ctx, id) == NULL)\n"
+	     "\t\texit(EXIT_FAILURE);");
+	if (stats)
+		puts("\tdb_stats_end(ctx, id);");
+	puts("\tif (st->id == id) {\n"
+	     "\t\tst->busy = 0;\n"
+	     "\t\tif (st->done)\n"
+	     "\t\t\treturn;\n"
+	     "\t\tst->id = 0;\n"
+	     "\t}\n"
+	     "\tif (!sqlbox_finalise(ctx->db, id))\n"
+	     "\t\texit(EXIT_FAILURE);\n"
+	     "}\n");
+flush:
+	if (!TAILQ_EMPTY(&cfg->rq)) {
+		print_commentt(0, COMMENT_C,
+			"Finalise all cached statements.\n"
+			"This is called when changing roles, as "
+			"statements are checked against the role "
+			"only when prepared.\n"
+			"Statements in use (e.g., when changing roles "
+			"within an iterator callback) are only dropped "
+			"from the cache, so db_stmt_done() finalises "
+			"them as transient.");
+		puts("static void\n"
+		     "db_stmt_flush(struct ort *ctx)\n"
+		     "{\n"
+		     "\tsize_t i;\n"
+		     "\n"
+		     "\tfor (i = 0; i < STMT__MAX; i++) {\n"
+		     "\t\tif (ctx->stmts[i].id == 0)\n"
+		     "\t\t\tcontinue;\n"
+		     "\t\tif (!ctx->stmts[i].busy &&\n"
+		     "\t\t    !sqlbox_finalise"
+			"(ctx->db, ctx->stmts[i].id))\n"
+		     "\t\t\texit(EXIT_FAILURE);\n"
+		     "\t\tctx->stmts[i].id = 0;\n"
+		     "\t}\n"
+		     "}\n");
+	}
+	print_func_db_stmt_cache_stats(0);
+	puts("{\n"
+	     "\n"
+	     "\tif (hits != NULL)\n"
+	     "\t\t*hits = ctx->stmt_hits;\n"
+	     "\tif (misses != NULL)\n"
+	     "\t\t*misses = ctx->stmt_misses;\n"
+	     "}\n");
+}
+
+/*
+ * Whether any search in "cfg" uses the password check cache.
+ */
+static int
+config_passcache(const struct config *cfg)
+{
+	const struct strct	*p;
+	const struct search	*s;
+	const struct sent	*sent;
+
+	TAILQ_FOREACH(p, &cfg->sq, entries)
+		TAILQ_FOREACH(s, &p->sq, entries)
+			TAILQ_FOREACH(sent, &s->sntq, entries)
+				if (sent_passcache(sent))
+					return 1;
+	return 0;
+}
+
+/*
+ * Generate the password check used by list and iterate searches that
+ * may return many rows for passwords reached through a join,
+ * remembering the last stored hash and whether it matched.
+ * Rows sharing a hash, as those referencing the same joined row do,
+ * are thus hashed only once per call.
+ */
+static void
+gen_func_checkpass(const struct config *cfg)
+{
+
+	if (!config_passcache(cfg))
+		return;
+
+	print_commentt(0, COMMENT_C,
+		"Check \"pass\" against the stored \"hash\", "
+		"re-using the last result in \"c\" if the hash "
+		"is unchanged.\n"
+		"Returns non-zero if the password matches.");
+	puts("static int\n"
+	     "db_checkpass_cached(struct ort_passcache *c,\n"
+	     "\tconst char *pass, const char *hash)\n"
+	     "{\n"
+	     "\n"
+	     "\tif (c->hash != NULL && strcmp(c->hash, hash) == 0)\n"
+	     "\t\treturn c->match;\n"
+	     "\tfree(c->hash);\n"
+	     "\tif ((c->hash = strdup(hash)) == NULL) {\n"
+	     "\t\tperror(NULL);\n"
+	     "\t\texit(EXIT_FAILURE);\n"
+	     "\t}");
+#ifdef __OpenBSD__
+	puts("\tc->match = crypt_checkpass(pass, hash) == 0;");
+#else
+	puts("\tc->match = _crypt_checkpass(pass, hash) == 0;");
+#endif
+	puts("\treturn c->match;\n"
+	     "}\n");
+}
+
+/*
+ * Whether any set membership operand in "cfg" is converted by the
+ * function "fn" of infuncs.
+ */
+static int
+config_in(const struct config *cfg, const char *fn)
+{
+	const struct strct	*p;
+	const struct search	*s;
+	const struct sent	*sent;
+	const struct update	*up;
+	const struct uref	*ref;
+
+	TAILQ_FOREACH(p, &cfg->sq, entries) {
+		TAILQ_FOREACH(s, &p->sq, entries)
+			TAILQ_FOREACH(sent, &s->sntq, entries)
+				if (sent->op == OPTYPE_IN &&
+				    strcmp(infuncs[sent->field->type],
+				    fn) == 0)
+					return 1;
+		TAILQ_FOREACH(up, &p->uq, entries)
+			TAILQ_FOREACH(ref, &up->crq, entries)
+				if (ref->op == OPTYPE_IN &&
+				    strcmp(infuncs[ref->field->type],
+				    fn) == 0)
+					return 1;
+		TAILQ_FOREACH(up, &p->dq, entries)
+			TAILQ_FOREACH(ref, &up->crq, entries)
+				if (ref->op == OPTYPE_IN &&
+				    strcmp(infuncs[ref->field->type],
+				    fn) == 0)
+					return 1;
+	}
+	return 0;
+}
+
+/*
+ * Generate the functions converting set membership arrays into the JSON
+ * arrays bound in their place, but only those used by "cfg".
+ * Each returns a NUL-terminated buffer that must be freed.
+ * Non-finite reals become null, which matches nothing.
+ */
+static void
+gen_func_in(const struct config *cfg)
+{
+
+	if (config_in(cfg, "db_in_int")) {
+		print_commentt(0, COMMENT_C,
+			"Format the \"sz\" integers of \"v\" as "
+			"a JSON array.");
+		puts("static char *\n"
+		     "db_in_int(const int64_t *v, size_t sz)\n"
+		     "{\n"
+		     "\tchar\t*buf;\n"
+		     "\tsize_t\t i, len = 0, max;\n"
+		     "\n"
+		     "\tif (sz > (SIZE_MAX - 3) / 21)\n"
+		     "\t\texit(EXIT_FAILURE);\n"
+		     "\tmax = sz * 21 + 3;\n"
+		     "\tif ((buf = malloc(max)) == NULL) {\n"
+		     "\t\tperror(NULL);\n"
+		     "\t\texit(EXIT_FAILURE);\n"
+		     "\t}\n"
+		     "\tbuf[len++] = '[';\n"
+		     "\tfor (i = 0; i < sz; i++)\n"
+		     "\t\tlen += snprintf(buf + len, max - len,\n"
+		     "\t\t    i > 0 ? \",%lld\" : \"%lld\", "
+			"(long long)v[i]);\n"
+		     "\tbuf[len++] = ']';\n"
+		     "\tbuf[len] = '\\0';\n"
+		     "\treturn buf;\n"
+		     "}\n");
+	}
+
+	if (config_in(cfg, "db_in_real")) {
+		print_commentt(0, COMMENT_C,
+			"Format the \"sz\" reals of \"v\" as "
+			"a JSON array.");
+		puts("static char *\n"
+		     "db_in_real(const double *v, size_t sz)\n"
+		     "{\n"
+		     "\tchar\t*buf;\n"
+		     "\tsize_t\t i, len = 0, max;\n"
+		     "\n"
+		     "\tif (sz > (SIZE_MAX - 3) / 32)\n"
+		     "\t\texit(EXIT_FAILURE);\n"
+		     "\tmax = sz * 32 + 3;\n"
+		     "\tif ((buf = malloc(max)) == NULL) {\n"
+		     "\t\tperror(NULL);\n"
+		     "\t\texit(EXIT_FAILURE);\n"
+		     "\t}\n"
+		     "\tbuf[len++] = '[';\n"
+		     "\tfor (i = 0; i < sz; i++) {\n"
+		     "\t\tif (i > 0)\n"
+		     "\t\t\tbuf[len++] = ',';\n"
+		     "\t\tif (v[i] - v[i] != 0.0)\n"
+		     "\t\t\tlen += snprintf(buf + len, "
+			"max - len, \"null\");\n"
+		     "\t\telse\n"
+		     "\t\t\tlen += snprintf(buf + len, "
+			"max - len, \"%.17g\", v[i]);\n"
+		     "\t}\n"
+		     "\tbuf[len++] = ']';\n"
+		     "\tbuf[len] = '\\0';\n"
+		     "\treturn buf;\n"
+		     "}\n");
+	}
+
+	if (config_in(cfg, "db_in_text")) {
+		print_commentt(0, COMMENT_C,
+			"Format the \"sz\" strings of \"v\" as "
+			"a JSON array.");
+		puts("static char *\n"
+		     "db_in_text(const char *const *v, size_t sz)\n"
+		     "{\n"
+		     "\tchar\t\t*buf;\n"
+		     "\tsize_t\t\t i, len = 0, max = 3;\n"
+		     "\tconst char\t*cp;\n"
+		     "\n"
+		     "\tfor (i = 0; i < sz; i++)\n"
+		     "\t\tfor (max += 3, cp = v[i]; *cp != '\\0'; cp++)\n"
+		     "\t\t\tif ((unsigned char)*cp < 0x20)\n"
+		     "\t\t\t\tmax += 6;\n"
+		     "\t\t\telse if (*cp == '\"' || *cp == '\\\\')\n"
+		     "\t\t\t\tmax += 2;\n"
+		     "\t\t\telse\n"
+		     "\t\t\t\tmax++;\n"
+		     "\tif ((buf = malloc(max)) == NULL) {\n"
+		     "\t\tperror(NULL);\n"
+		     "\t\texit(EXIT_FAILURE);\n"
+		     "\t}\n"
+		     "\tbuf[len++] = '[';\n"
+		     "\tfor (i = 0; i < sz; i++) {\n"
+		     "\t\tif (i > 0)\n"
+		     "\t\t\tbuf[len++] = ',';\n"
+		     "\t\tbuf[len++] = '\"';\n"
+		     "\t\tfor (cp = v[i]; *cp != '\\0'; cp++)\n"
+		     "\t\t\tif ((unsigned char)*cp < 0x20)\n"
+		     "\t\t\t\tlen += snprintf(buf + len, max - len,\n"
+		     "\t\t\t\t    \"\\\\u%.4x\", (unsigned char)*cp);\n"
+		     "\t\t\telse {\n"
+		     "\t\t\t\tif (*cp == '\"' || *cp == '\\\\')\n"
+		     "\t\t\t\t\tbuf[len++] = '\\\\';\n"
+		     "\t\t\t\tbuf[len++] = *cp;\n"
+		     "\t\t\t}\n"
+		     "\t\tbuf[len++] = '\"';\n"
+		     "\t}\n"
+		     "\tbuf[len++] = ']';\n"
+		     "\tbuf[len] = '\\0';\n"
+		     "\treturn buf;\n"
+		     "}\n");
+	}
+}
+
+/*
+ * Whether any structure has an iterate search, and thus borrowed
+ * iterate variants.
+ */
+static int
+cfg_has_iterate(const struct config *cfg)
+{
+	const struct strct	*p;
+
+	TAILQ_FOREACH(p, &cfg->sq, entries)
+		if (p->flags & STRCT_HAS_ITERATOR)
+			return 1;
+	return 0;
+}
 
-	TAILQ_FOREACH(rr, &r->subrq, entries)
-		gen_func_rolecases(rr);
+/*
+ * Close and free the database context.
+ * This is sensitive to whether we have roles.
+ * If "arena" is set, also free all result arena blocks.
+ */
+static void
+gen_func_close(const struct config *cfg, int arena, int stats)
+{
+
+	print_func_db_close(0);
+	puts("{");
+	if (arena)
+		puts("\tstruct ort_arena *a;\n");
+	puts("\tif (p == NULL)\n"
+	     "\t\treturn;\n"
+             "\tsqlbox_free(p->db);");
+	if (stats)
+		puts("\tfree(p->runs);");
+	if (cfg_has_iterate(cfg))
+		puts("\tdb_borrow_release(p, 0);\n"
+		     "\tfree(p->borrow);");
+	if (arena)
+		puts("\twhile ((a = p->arena) != NULL) {\n"
+		     "\t\tp->arena = a->prev;\n"
+		     "\t\tfree(a);\n"
+		     "\t}");
+	puts("\tfree(p);\n"
+	     "}\n"
+	     "");
 }
 
+/*
+ * Generate the conversions used by the borrowed iterate variants.
+ * Strings and blobs usually point into the result set, but values of
+ * other types (SQLite columns aren't strictly typed) are converted and
+ * kept in "struct ort" until the row is released.
+ * This does nothing if there are no iterate searches.
+ */
 static void
-gen_func_role_transitions(const struct config *cfg)
+gen_func_borrow(const struct config *cfg)
 {
-	const struct role *r, *rr;
 
-	TAILQ_FOREACH(r, &cfg->rq, entries)
-		if (0 == strcmp(r->name, "all"))
-			break;
-	assert(NULL != r);
+	if (!cfg_has_iterate(cfg))
+		return;
 
-	print_func_db_role(0);
-	puts("{\n"
-	     "\tif (!sqlbox_role(ctx->db, r))\n"
+	print_commentt(0, COMMENT_C,
+		"Release the values converted for borrowed rows down "
+		"to the count \"mark\".");
+	puts("static void\n"
+	     "db_borrow_release(struct ort *ctx, size_t mark)\n"
+	     "{\n"
+	     "\n"
+	     "\twhile (ctx->borrowsz > mark)\n"
+	     "\t\tfree(ctx->borrow[--ctx->borrowsz]);\n"
+	     "}\n"
+	     "");
+	print_commentt(0, COMMENT_C,
+		"Keep the converted value \"v\" until released by "
+		"db_borrow_release().");
+	puts("static void\n"
+	     "db_borrow_keep(struct ort *ctx, void *v)\n"
+	     "{\n"
+	     "\tvoid *pp;\n"
+	     "\n"
+	     "\tif (ctx->borrowsz == ctx->borrowmax) {\n"
+	     "\t\tpp = reallocarray(ctx->borrow, "
+	      "ctx->borrowmax + 8,\n"
+	     "\t\t\tsizeof(void *));\n"
+	     "\t\tif (pp == NULL) {\n"
+	     "\t\t\tperror(NULL);\n"
+	     "\t\t\texit(EXIT_FAILURE);\n"
+	     "\t\t}\n"
+	     "\t\tctx->borrow = pp;\n"
+	     "\t\tctx->borrowmax += 8;\n"
+	     "\t}\n"
+	     "\tctx->borrow[ctx->borrowsz++] = v;\n"
+	     "}\n"
+	     "");
+	print_commentt(0, COMMENT_C,
+		"Borrow a string result.\n"
+		"Values not already strings are converted by sqlbox "
+		"and kept with db_borrow_keep().");
+	puts("static char *\n"
+	     "db_borrow_string(struct ort *ctx, "
+	      "const struct sqlbox_parm *parm)\n"
+	     "{\n"
+	     "\tchar *cp;\n"
+	     "\n"
+	     "\tif (parm->type == SQLBOX_PARM_STRING)\n"
+	     "\t\treturn (char *)parm->sparm;\n"
+	     "\tif (sqlbox_parm_string_alloc(parm, &cp, NULL) == -1)\n"
 	     "\t\texit(EXIT_FAILURE);\n"
-	     "\tif (r == ctx->role)\n"
-	     "\t\treturn;\n"
-	     "\tif (ctx->role == ROLE_none)\n"
-	     "\t\tabort();\n"
+	     "\tdb_borrow_keep(ctx, cp);\n"
+	     "\treturn cp;\n"
+	     "}\n"
+	     "");
+	print_commentt(0, COMMENT_C,
+		"Like db_borrow_string() but for blobs, setting "
+		"the blob size in \"sz\".");
+	puts("static void *\n"
+	     "db_borrow_blob(struct ort *ctx, "
+	      "const struct sqlbox_parm *parm, size_t *sz)\n"
+	     "{\n"
+	     "\tvoid *cp;\n"
 	     "\n"
-	     "\tswitch (ctx->role) {\n"
-	     "\tcase ROLE_default:\n"
-	     "\t\tctx->role = r;\n"
-	     "\t\treturn;");
-	TAILQ_FOREACH(rr, &r->subrq, entries)
-		gen_func_rolecases(rr);
-	puts("\tdefault:\n"
-	     "\t\tabort();\n"
+	     "\tif (parm->type == SQLBOX_PARM_BLOB) {\n"
+	     "\t\t*sz = parm->sz;\n"
+	     "\t\treturn (void *)parm->bparm;\n"
 	     "\t}\n"
-	     "}\n");
-	print_func_db_role_current(0);
-	puts("{\n"
-	     "\treturn ctx->role;\n"
-	     "}\n");
-	print_func_db_role_stored(0);
-	puts("{\n"
-	     "\treturn s->role;\n"
-	     "}\n");
+	     "\tif (sqlbox_parm_blob_alloc(parm, &cp, sz) == -1)\n"
+	     "\t\texit(EXIT_FAILURE);\n"
+	     "\tdb_borrow_keep(ctx, cp);\n"
+	     "\treturn cp;\n"
+	     "}\n"
+	     "");
 }
 
+/*
+ * Generate the result arena used when "arena" mode is enabled.
+ * The arena is a chain of blocks, newest first, from which all query
+ * results are allocated.
+ * Positions are measured as the total number of bytes used, so a mark
+ * is simply the current position.
+ */
 static void
-gen_func_trans(const struct config *cfg)
+gen_func_arena(const struct config *cfg)
 {
 
-	print_func_db_trans_open(0);
-	puts("{\n"
-	     "\tstruct sqlbox *db = ctx->db;\n"
-	     "\tint c;\n"
+	print_commentt(0, COMMENT_C,
+		"Allocate \"sz\" bytes from the result arena of "
+		"\"ctx\", adding a block if the current one is full.\n"
+		"Never returns NULL: exits on memory exhaustion.");
+	puts("static void *\n"
+	     "db_arena_alloc(struct ort *ctx, size_t sz)\n"
+	     "{\n"
+	     "\tstruct ort_arena *a = ctx->arena;\n"
+	     "\tsize_t cap;\n"
+	     "\tvoid *p;\n"
 	     "\n"
-	     "\tif (mode < 0)\n"
-	     "\t\tc = sqlbox_trans_exclusive(db, 0, id);\n"
-	     "\telse if (mode > 0)\n"
-	     "\t\tc = sqlbox_trans_immediate(db, 0, id);\n"
-	     "\telse\n"
-	     "\t\tc = sqlbox_trans_deferred(db, 0, id);\n"
-	     "\tif (!c)\n"
+	     "\tsz = ORT_ARENA_ALIGN(sz);\n"
+	     "\tif (a == NULL || a->cap - a->len < sz) {\n"
+	     "\t\tcap = sz > ORT_ARENA_BLKSZ ? sz : ORT_ARENA_BLKSZ;\n"
+	     "\t\ta = malloc(ORT_ARENA_ALIGN"
+	      "(sizeof(struct ort_arena)) + cap);\n"
+	     "\t\tif (a == NULL) {\n"
+	     "\t\t\tperror(NULL);\n"
+	     "\t\t\texit(EXIT_FAILURE);\n"
+	     "\t\t}\n"
+	     "\t\ta->prev = ctx->arena;\n"
+	     "\t\ta->base = db_arena_mark(ctx);\n"
+	     "\t\ta->len = 0;\n"
+	     "\t\ta->cap = cap;\n"
+	     "\t\tctx->arena = a;\n"
+	     "\t}\n"
+	     "\tp = (char *)a + ORT_ARENA_ALIGN"
+	      "(sizeof(struct ort_arena)) + a->len;\n"
+	     "\ta->len += sz;\n"
+	     "\treturn p;\n"
+	     "}\n"
+	     "");
+	print_commentt(0, COMMENT_C,
+		"Copy a string result into the result arena.\n"
+		"Values not already strings are converted by sqlbox "
+		"first.");
+	puts("static char *\n"
+	     "db_arena_parm_string(struct ort *ctx, "
+	      "const struct sqlbox_parm *parm)\n"
+	     "{\n"
+	     "\tchar *cp, *v;\n"
+	     "\tsize_t sz;\n"
+	     "\n"
+	     "\tif (parm->type == SQLBOX_PARM_STRING) {\n"
+	     "\t\tsz = strlen(parm->sparm) + 1;\n"
+	     "\t\tv = db_arena_alloc(ctx, sz);\n"
+	     "\t\tmemcpy(v, parm->sparm, sz);\n"
+	     "\t\treturn v;\n"
+	     "\t}\n"
+	     "\tif (sqlbox_parm_string_alloc(parm, &cp, NULL) == -1)\n"
 	     "\t\texit(EXIT_FAILURE);\n"
+	     "\tsz = strlen(cp) + 1;\n"
+	     "\tv = db_arena_alloc(ctx, sz);\n"
+	     "\tmemcpy(v, cp, sz);\n"
+	     "\tfree(cp);\n"
+	     "\treturn v;\n"
 	     "}\n"
 	     "");
-	print_func_db_trans_rollback(0);
-	puts("{\n"
-	     "\tstruct sqlbox *db = ctx->db;\n"
+	print_commentt(0, COMMENT_C,
+		"Like db_arena_parm_string() but for blobs, setting "
+		"the blob size in \"sz\".");
+	puts("static void *\n"
+	     "db_arena_parm_blob(struct ort *ctx, "
+	      "const struct sqlbox_parm *parm, size_t *sz)\n"
+	     "{\n"
+	     "\tvoid *cp, *v;\n"
 	     "\n"
-	     "\tif (!sqlbox_trans_rollback(db, 0, id))\n"
+	     "\tif (parm->type == SQLBOX_PARM_BLOB) {\n"
+	     "\t\t*sz = parm->sz;\n"
+	     "\t\tv = db_arena_alloc(ctx, *sz);\n"
+	     "\t\tmemcpy(v, parm->bparm, *sz);\n"
+	     "\t\treturn v;\n"
+	     "\t}\n"
+	     "\tif (sqlbox_parm_blob_alloc(parm, &cp, sz) == -1)\n"
 	     "\t\texit(EXIT_FAILURE);\n"
+	     "\tv = db_arena_alloc(ctx, *sz);\n"
+	     "\tmemcpy(v, cp, *sz);\n"
+	     "\tfree(cp);\n"
+	     "\treturn v;\n"
 	     "}\n"
 	     "");
-	print_func_db_trans_commit(0);
+	print_func_db_arena_mark(0);
 	puts("{\n"
-	     "\tstruct sqlbox *db = ctx->db;\n"
+	     "\tif (ctx->arena == NULL)\n"
+	     "\t\treturn 0;\n"
+	     "\treturn ctx->arena->base + ctx->arena->len;\n"
+	     "}\n"
+	     "");
+	print_func_db_arena_release(0);
+	puts("{\n"
+	     "\tstruct ort_arena *a;\n"
 	     "\n"
-	     "\tif (!sqlbox_trans_commit(db, 0, id))\n"
-	     "\t\texit(EXIT_FAILURE);\n"
+	     "\twhile ((a = ctx->arena) != NULL && a->base > mark) {\n"
+	     "\t\tctx->arena = a->prev;\n"
+	     "\t\tfree(a);\n"
+	     "\t}\n"
+	     "\tif (a != NULL && a->base + a->len > mark)\n"
+	     "\t\ta->len = mark - a->base;\n"
+	     "}\n"
+	     "");
+	print_func_db_arena_reset(0);
+	puts("{\n"
+	     "\n"
+	     "\tdb_arena_release(ctx, 0);\n"
 	     "}\n"
 	     "");
 }
 
 /*
- * Close and free the database context.
- * This is sensitive to whether we have roles.
+ * Generate the connection pool used when "pool" mode is enabled.
+ * The pool opens all of its handles with one configuration and hands
+ * them out to threads, blocking when none are idle.
+ * Roles can't be left, so handles are released in their role and kept
+ * for acquiring that role again, or are moved into it from the default
+ * role; only if neither is idle is another re-opened.
+ * Handles released within a transaction are closed and re-opened when
+ * next acquired.
+ * Cached statements not stepped until done are finalised on release so
+ * that none holds a transaction open while idle.
  */
 static void
-gen_func_close(const struct config *cfg)
+gen_func_pool(const struct config *cfg, int arena)
 {
 
-	print_func_db_close(0);
+	print_commentt(0, COMMENT_C,
+		"A pool of database handles sharing one "
+		"configuration.\n"
+		"Idle handles are stacked in \"idle\", where NULL "
+		"marks a handle closed on release and to be "
+		"re-opened when acquired.\n"
+		"All \"n\" handles are idle when none are acquired.");
+	puts("struct\tort_pool {\n"
+	     "\tstruct ort_cfg cfg;\n"
+	     "\tchar *file;\n"
+	     "\tstruct ort **idle;\n"
+	     "\tsize_t idlesz;\n"
+	     "\tsize_t n;\n"
+	     "\tpthread_mutex_t mutex;\n"
+	     "\tpthread_cond_t cond;\n"
+	     "};\n");
+
+	print_func_db_pool_open(0);
 	puts("{\n"
-	     "\tif (p == NULL)\n"
+	     "\tstruct ort_pool *pool;\n"
+	     "\tsize_t i;\n"
+	     "\n"
+	     "\tif (n == 0)\n"
+	     "\t\treturn NULL;\n"
+	     "\tif ((pool = calloc(1, sizeof(struct ort_pool))) == NULL)\n"
+	     "\t\treturn NULL;\n"
+	     "\tif ((pool->file = strdup(file)) == NULL)\n"
+	     "\t\tgoto err;\n"
+	     "\tif ((pool->idle = calloc(n, sizeof(struct ort *))) == NULL)\n"
+	     "\t\tgoto err;\n"
+	     "\tif (pthread_mutex_init(&pool->mutex, NULL) != 0)\n"
+	     "\t\tgoto err;\n"
+	     "\tif (pthread_cond_init(&pool->cond, NULL) != 0) {\n"
+	     "\t\tpthread_mutex_destroy(&pool->mutex);\n"
+	     "\t\tgoto err;\n"
+	     "\t}\n"
+	     "\tdb_cfg_init(&pool->cfg, pool->file, NULL, NULL, NULL, NULL);\n"
+	     "\n"
+	     "\tfor (i = 0; i < n; i++) {\n"
+	     "\t\tpool->idle[i] = db_open_cfg(&pool->cfg);\n"
+	     "\t\tif (pool->idle[i] == NULL) {\n"
+	     "\t\t\tdb_pool_close(pool);\n"
+	     "\t\t\treturn NULL;\n"
+	     "\t\t}\n"
+	     "\t\tpool->idlesz++;\n"
+	     "\t\tpool->n++;\n"
+	     "\t}\n"
+	     "\treturn pool;\n"
+	     "err:\n"
+	     "\tfree(pool->idle);\n"
+	     "\tfree(pool->file);\n"
+	     "\tfree(pool);\n"
+	     "\treturn NULL;\n"
+	     "}\n");
+
+	if (!TAILQ_EMPTY(&cfg->rq)) {
+		print_func_db_pool_acquire_role(0);
+		puts("{\n"
+		     "\tstruct ort *ctx;\n"
+		     "\tsize_t i, j = 0;\n"
+		     "\tint rank, best = 4;\n"
+		     "\n"
+		     "\tif (pthread_mutex_lock(&pool->mutex) != 0)\n"
+		     "\t\texit(EXIT_FAILURE);\n"
+		     "\twhile (pool->idlesz == 0)\n"
+		     "\t\tif (pthread_cond_wait(&pool->cond, &pool->mutex) != 0)\n"
+		     "\t\t\texit(EXIT_FAILURE);\n"
+		     "\n"
+		     "\t/*\n"
+		     "\t * Prefer a handle already in the role, then one in the\n"
+		     "\t * default role that may move into it, then a closed one.\n"
+		     "\t * Otherwise, one in another role is closed and re-opened.\n"
+		     "\t */\n"
+		     "\n"
+		     "\tfor (i = 0; i < pool->idlesz && best > 0; i++) {\n"
+		     "\t\tctx = pool->idle[i];\n"
+		     "\t\trank = ctx == NULL ? 2 : ctx->role == r ? 0 :\n"
+		     "\t\t\tctx->role == ROLE_default ? 1 : 3;\n"
+		     "\t\tif (rank < best) {\n"
+		     "\t\t\tbest = rank;\n"
+		     "\t\t\tj = i;\n"
+		     "\t\t}\n"
+		     "\t}\n"
+		     "\tctx = pool->idle[j];\n"
+		     "\tpool->idle[j] = pool->idle[--pool->idlesz];\n"
+		     "\tif (pthread_mutex_unlock(&pool->mutex) != 0)\n"
+		     "\t\texit(EXIT_FAILURE);\n"
+		     "\n"
+		     "\tif (best == 3) {\n"
+		     "\t\tdb_close(ctx);\n"
+		     "\t\tctx = NULL;\n"
+		     "\t}\n"
+		     "\tif (ctx == NULL && (ctx = db_open_cfg(&pool->cfg)) == NULL) {\n"
+		     "\t\tdb_pool_release(pool, NULL);\n"
+		     "\t\treturn NULL;\n"
+		     "\t}\n"
+		     "\tif (ctx->role != r)\n"
+		     "\t\tdb_role(ctx, r);\n"
+		     "\treturn ctx;\n"
+		     "}\n");
+		print_func_db_pool_acquire(0);
+		puts("{\n"
+		     "\treturn db_pool_acquire_role(pool, ROLE_default);\n"
+		     "}\n");
+	} else {
+		print_func_db_pool_acquire(0);
+		puts("{\n"
+		     "\tstruct ort *ctx;\n"
+		     "\n"
+		     "\tif (pthread_mutex_lock(&pool->mutex) != 0)\n"
+		     "\t\texit(EXIT_FAILURE);\n"
+		     "\twhile (pool->idlesz == 0)\n"
+		     "\t\tif (pthread_cond_wait(&pool->cond, &pool->mutex) != 0)\n"
+		     "\t\t\texit(EXIT_FAILURE);\n"
+		     "\tctx = pool->idle[--pool->idlesz];\n"
+		     "\tif (pthread_mutex_unlock(&pool->mutex) != 0)\n"
+		     "\t\texit(EXIT_FAILURE);\n"
+		     "\n"
+		     "\tif (ctx == NULL && (ctx = db_open_cfg(&pool->cfg)) == NULL)\n"
+		     "\t\tdb_pool_release(pool, NULL);\n"
+		     "\treturn ctx;\n"
+		     "}\n");
+	}
+
+	print_func_db_pool_release(0);
+	puts("{\n"
+	     "\tsize_t i;\n"
+	     "\n"
+	     "\tif (ctx != NULL && ctx->trans > 0) {\n"
+	     "\t\tdb_close(ctx);\n"
+	     "\t\tctx = NULL;\n"
+	     "\t}");
+	if (arena)
+		puts("\tif (ctx != NULL)\n"
+		     "\t\tdb_arena_reset(ctx);");
+	puts("\tfor (i = 0; ctx != NULL && i < STMT__MAX; i++) {\n"
+	     "\t\tif (ctx->stmts[i].id == 0 || ctx->stmts[i].done)\n"
+	     "\t\t\tcontinue;\n"
+	     "\t\tif (!sqlbox_finalise(ctx->db, ctx->stmts[i].id))\n"
+	     "\t\t\texit(EXIT_FAILURE);\n"
+	     "\t\tctx->stmts[i].id = 0;\n"
+	     "\t\tctx->stmts[i].busy = 0;\n"
+	     "\t}\n"
+	     "\n"
+	     "\tif (pthread_mutex_lock(&pool->mutex) != 0)\n"
+	     "\t\texit(EXIT_FAILURE);\n"
+	     "\tpool->idle[pool->idlesz++] = ctx;\n"
+	     "\tif (pthread_cond_signal(&pool->cond) != 0 ||\n"
+	     "\t    pthread_mutex_unlock(&pool->mutex) != 0)\n"
+	     "\t\texit(EXIT_FAILURE);\n"
+	     "}\n");
+
+	print_func_db_pool_close(0);
+	puts("{\n"
+	     "\tsize_t i;\n"
+	     "\n"
+	     "\tif (pool == NULL)\n"
 	     "\t\treturn;\n"
-             "\tsqlbox_free(p->db);\n"
-	     "\tfree(p);\n"
-	     "}\n"
-	     "");
+	     "\tassert(pool->idlesz == pool->n);\n"
+	     "\tfor (i = 0; i < pool->idlesz; i++)\n"
+	     "\t\tdb_close(pool->idle[i]);\n"
+	     "\tpthread_cond_destroy(&pool->cond);\n"
+	     "\tpthread_mutex_destroy(&pool->mutex);\n"
+	     "\tfree(pool->idle);\n"
+	     "\tfree(pool->file);\n"
+	     "\tfree(pool);\n"
+	     "}\n");
 }
 
 /*
@@ -1129,9 +3017,10 @@ gen_strct_func_count(const struct config *cfg,
 	     "{\n"
 	     "\tconst struct sqlbox_parmset *res;\n"
 	     "\tint64_t val;\n"
-	     "\tstruct sqlbox *db = ctx->db;");
+	     "\tsize_t id;");
 	if (parms > 0)
 		printf("\tstruct sqlbox_parm parms[%zu];\n", parms);
+	gen_search_in(s, 1);
 
 	/* Emit parameter binding. */
 
@@ -1147,31 +3036,32 @@ gen_strct_func_count(const struct config *cfg,
 	/* A single returned entry. */
 
 	puts("");
-	printf("\tif (!sqlbox_prepare_bind_async\n"
-	       "\t    (db, 0, STMT_%s_BY_SEARCH_%zu, %zu, %s, 0))\n"
-	       "\t	exit(EXIT_FAILURE);\n",
+	printf("\tid = db_stmt_bind(ctx, "
+			"STMT_%s_BY_SEARCH_%zu, %zu, %s, 0, 1);\n",
 	       s->parent->name, num, parms,
 	       parms > 0 ? "parms" : "NULL");
+	gen_search_in(s, 0);
 
-	printf("\tif ((res = sqlbox_step(db, 0)) == NULL)\n"
+	printf("\tif ((res = db_stmt_step(ctx, id)) == NULL)\n"
 	     "\t\texit(EXIT_FAILURE);\n"
 	     "\telse if (res->psz != 1)\n"
 	     "\t\texit(EXIT_FAILURE);\n"
 	     "\tif (sqlbox_parm_int(&res->ps[0], &val) == -1)\n"
 	     "\t\texit(EXIT_FAILURE);\n"
-	     "\tsqlbox_finalise(db, 0);\n"
+	     "\tdb_stmt_done(ctx, STMT_%s_BY_SEARCH_%zu, id);\n"
 	     "\treturn (uint64_t)val;\n"
 	     "}\n"
-	     "");
+	     "", s->parent->name, num);
 }
 
 /*
  * Print out a search function for an STYPE_SEARCH.
  * This searches for a singular value.
+ * If "arena" is set, the result is allocated from the result arena.
  */
 static void
 gen_strct_func_srch(const struct config *cfg,
-	const struct search *s, size_t num)
+	const struct search *s, size_t num, int arena)
 {
 	const struct sent	*sent;
 	const struct strct	*retstr;
@@ -1191,10 +3081,13 @@ gen_strct_func_srch(const struct config *cfg,
 	       "{\n"
 	       "\tstruct %s *p = NULL;\n"
 	       "\tconst struct sqlbox_parmset *res;\n"
-	       "\tstruct sqlbox *db = ctx->db;\n",
+	       "\tsize_t id;\n",
 	       retstr->name);
 	if (parms > 0)
 		printf("\tstruct sqlbox_parm parms[%zu];\n", parms);
+	if (arena && search_has_hash(s))
+		puts("\tsize_t mark;");
+	gen_search_in(s, 1);
 
 	/* Emit parameter binding. */
 
@@ -1211,25 +3104,28 @@ gen_strct_func_srch(const struct config *cfg,
 		} 
 	puts("");
 
-	printf("\tif (!sqlbox_prepare_bind_async\n"
-	       "\t    (db, 0, STMT_%s_BY_SEARCH_%zu, %zu, %s, 0))\n"
-	       "\t	exit(EXIT_FAILURE);\n",
+	printf("\tid = db_stmt_bind(ctx, "
+			"STMT_%s_BY_SEARCH_%zu, %zu, %s, 0, 1);\n",
 	       s->parent->name, num, parms,
 	       parms > 0 ? "parms" : "NULL");
-
-	printf("\tif ((res = sqlbox_step(db, 0)) != NULL "
-			"&& res->psz) {\n"
-	       "\t\tp = malloc(sizeof(struct %s));\n"
-	       "\t\tif (p == NULL) {\n"
-	       "\t\t\tperror(NULL);\n"
-	       "\t\t\texit(EXIT_FAILURE);\n"
-	       "\t\t}\n"
-	       "\t\tdb_%s_fill_r(ctx, p, res, NULL);\n",
-	       retstr->name, retstr->name);
-	if (STRCT_HAS_NULLREFS & retstr->flags)
-	       printf("\t\tdb_%s_reffind(%sp, db);\n",
-		      retstr->name,
-	 	      (!TAILQ_EMPTY(&cfg->rq)) ? "ctx, " : "");
+	gen_search_in(s, 0);
+
+	printf("\tif ((res = db_stmt_step(ctx, id)) != NULL "
+			"&& res->psz) {\n");
+	if (arena && search_has_hash(s))
+		puts("\t\tmark = db_arena_mark(ctx);");
+	if (arena)
+		printf("\t\tp = db_arena_alloc"
+			"(ctx, sizeof(struct %s));\n",
+		       retstr->name);
+	else
+		printf("\t\tp = malloc(sizeof(struct %s));\n"
+		       "\t\tif (p == NULL) {\n"
+		       "\t\t\tperror(NULL);\n"
+		       "\t\t\texit(EXIT_FAILURE);\n"
+		       "\t\t}\n",
+		       retstr->name);
+	gen_search_fill(s, num, "p", 0);
 
 	/* Conditional post-query password check. */
 
@@ -1244,82 +3140,247 @@ gen_strct_func_srch(const struct config *cfg,
 			continue;
 		}
 		printf("\t\tif ");
-		gen_print_checkpass(1, pos,
-			sent->fname, sent->op, sent->field);
-		printf(" {\n"
-		       "\t\t\tdb_%s_free(p);\n"
-		       "\t\t\tp = NULL;\n"
-		       "\t\t}\n", 
-		       s->parent->name);
+		gen_print_checkpass(1, pos, sent->fname, 
+			sent->op, sent->field, sent_passcache(sent));
+		if (arena)
+			puts(" {\n"
+			     "\t\t\tdb_arena_release(ctx, mark);\n"
+			     "\t\t\tp = NULL;\n"
+			     "\t\t}");
+		else
+			printf(" {\n"
+			       "\t\t\tdb_%s_free(p);\n"
+			       "\t\t\tp = NULL;\n"
+			       "\t\t}\n", 
+			       s->parent->name);
 		pos++;
 	}
 
 	puts("\t}\n"
 	     "\tif (res == NULL)\n"
+	     "\t\texit(EXIT_FAILURE);");
+	printf("\tdb_stmt_done(ctx, STMT_%s_BY_SEARCH_%zu, id);\n"
+	       "\treturn p;\n"
+	       "}\n"
+	       "\n", s->parent->name, num);
+}
+
+/*
+ * Generate the "freeq" function.
+ * This must have STRCT_HAS_QUEUE defined in its flags, otherwise the
+ * function does nothing.
+ * If "arena" is set, the queue is owned by the result arena and is
+ * not freed here.
+ */
+static void
+gen_func_freeq(const struct strct *p, int arena)
+{
+
+	if ( ! (STRCT_HAS_QUEUE & p->flags))
+		return;
+
+	print_func_db_freeq(p, 0);
+	if (arena) {
+		puts("\n"
+		     "{\n"
+		     "\t/* Released with db_arena_release(). */\n"
+		     "}\n");
+		return;
+	}
+	printf("\n"
+	       "{\n"
+	       "\tstruct %s *p;\n\n"
+	       "\tif (q == NULL)\n"
+	       "\t\treturn;\n"
+	       "\twhile ((p = TAILQ_FIRST(q)) != NULL) {\n"
+	       "\t\tTAILQ_REMOVE(q, p, _entries);\n"
+	       "\t\tdb_%s_free(p);\n"
+	       "\t}\n"
+	       "\tfree(q);\n"
+	       "}\n"
+	       "\n", 
+	       p->name, p->name);
+}
+
+/*
+ * Generate the bulk "insert" function.
+ * This binds each row in turn to a single prepared statement and runs
+ * them all within one transaction, rolling back on constraint failure.
+ * The transaction goes through db_trans_open() with the reserved
+ * DB_TRANS_INSERT_MANY identifier so that it's accounted for in
+ * "ctx->trans" like any other.
+ * This does nothing if we don't have an insert function or if there
+ * are no columns to insert.
+ */
+static void
+gen_func_insert_many(const struct config *cfg, const struct strct *p,
+	int stats)
+{
+	const struct field	*f;
+	size_t			 hpos, idx, parms = 0;
+	const char		*tabs;
+
+	if (p->ins == NULL)
+		return;
+
+	TAILQ_FOREACH(f, &p->fq, entries)
+		if (f->type != FTYPE_STRUCT && 
+		    !(f->flags & FIELD_ROWID))
+			parms++;
+	if (parms == 0)
+		return;
+
+	print_func_db_insert_many(p, 0);
+	printf("\n"
+	       "{\n"
+	       "\tsize_t i, id = 0;\n"
+	       "\tconst struct %s_insert_args *r;\n"
+	       "\tconst struct sqlbox_parmset *res;\n"
+	       "\tstruct sqlbox *db = ctx->db;\n"
+	       "\tstruct sqlbox_parm parms[%zu];\n",
+	       p->name, parms);
+	if (stats)
+		puts("\tstruct timespec start;");
+	hpos = 1;
+	TAILQ_FOREACH(f, &p->fq, entries)
+		if (f->type == FTYPE_PASSWORD)
+			printf("\tchar hash%zu[64];\n", hpos++);
+	puts("\n"
+	     "\tif (n == 0)\n"
+	     "\t\treturn 1;\n"
+	     "\tdb_trans_open(ctx, DB_TRANS_INSERT_MANY, 1);\n"
+	     "\tfor (i = 0; i < n; i++) {\n"
+	     "\t\tr = &rows[i];\n"
+	     "\t\tmemset(parms, 0, sizeof(parms));");
+
+	hpos = idx = 1;
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (f->type == FTYPE_STRUCT ||
+		    (f->flags & FIELD_ROWID))
+			continue;
+		tabs = "\t\t";
+		if (f->flags & FIELD_NULL) {
+			printf("\t\tif (r->%s == NULL) {\n"
+			       "\t\t\tparms[%zu].type = "
+					"SQLBOX_PARM_NULL;\n"
+			       "\t\t} else {\n", f->name, idx - 1);
+			tabs = "\t\t\t";
+		}
+		if (f->type == FTYPE_PASSWORD) {
+#ifdef __OpenBSD__
+			printf("%scrypt_newhash(%sr->%s, \"blowfish,a\", "
+				"hash%zu, sizeof(hash%zu));\n", tabs,
+				(f->flags & FIELD_NULL) ? "*" : "", 
+				f->name, hpos, hpos);
+#else
+			printf("%s_crypt_newhash(%sr->%s, "
+				"hash%zu, sizeof(hash%zu));\n", tabs,
+				(f->flags & FIELD_NULL) ? "*" : "", 
+				f->name, hpos, hpos);
+#endif
+			printf("%sparms[%zu].sparm = hash%zu;\n"
+			       "%sparms[%zu].type = SQLBOX_PARM_STRING;\n",
+			       tabs, idx - 1, hpos, tabs, idx - 1);
+			hpos++;
+		} else {
+			printf("%sparms[%zu].%s = %sr->%s;\n"
+			       "%sparms[%zu].type = %s;\n",
+			       tabs, idx - 1, bindvars[f->type],
+			       (f->flags & FIELD_NULL) ? "*" : "",
+			       f->name, tabs, idx - 1, 
+			       bindtypes[f->type]);
+			if (f->type == FTYPE_BLOB)
+				printf("%sparms[%zu].sz = r->%s_sz;\n",
+				       tabs, idx - 1, f->name);
+		}
+		if (f->flags & FIELD_NULL)
+			puts("\t\t}");
+		idx++;
+	}
+
+	/*
+	 * Prepare once and rebind for subsequent rows.
+	 * A constraint failure on any row rolls back all of them.
+	 */
+
+	if (stats)
+		puts("\t\tclock_gettime(CLOCK_MONOTONIC, &start);");
+	printf("\t\tif (id == 0) {\n"
+	       "\t\t\tid = sqlbox_prepare_bind_async\n"
+	       "\t\t\t    (db, 0, STMT_%s_INSERT,\n"
+	       "\t\t\t     %zu, parms, SQLBOX_STMT_CONSTRAINT);\n"
+	       "\t\t\tif (id == 0)\n"
+	       "\t\t\t\texit(EXIT_FAILURE);\n"
+	       "\t\t} else if (!sqlbox_rebind(db, id, %zu, parms))\n"
+	       "\t\t\texit(EXIT_FAILURE);\n",
+	       p->name, parms, parms);
+	puts("\t\tif ((res = sqlbox_step(db, id)) == NULL)\n"
+	     "\t\t\texit(EXIT_FAILURE);");
+	if (stats)
+		printf("\t\tdb_stats_add(ctx, STMT_%s_INSERT, "
+			"&start, 0);\n", p->name);
+	puts("\t\tif (res->code == SQLBOX_CODE_CONSTRAINT) {\n"
+	     "\t\t\tif (!sqlbox_finalise(db, id))\n"
+	     "\t\t\t\texit(EXIT_FAILURE);\n"
+	     "\t\t\tdb_trans_rollback(ctx, DB_TRANS_INSERT_MANY);\n"
+	     "\t\t\treturn 0;\n"
+	     "\t\t}\n"
+	     "\t\tif (ids != NULL && "
+		"!sqlbox_lastid(db, 0, &ids[i]))\n"
+	     "\t\t\texit(EXIT_FAILURE);\n"
+	     "\t}\n"
+	     "\tif (!sqlbox_finalise(db, id))\n"
 	     "\t\texit(EXIT_FAILURE);\n"
-	     "\tif (!sqlbox_finalise(db, 0))\n"
-	     "\t\texit(EXIT_FAILURE);\n"
-	     "\treturn p;\n"
-	     "}\n"
-	     "");
+	     "\tdb_trans_commit(ctx, DB_TRANS_INSERT_MANY);\n"
+	     "\treturn 1;\n"
+	     "}\n");
 }
 
 /*
- * Generate the "freeq" function.
- * This must have STRCT_HAS_QUEUE defined in its flags, otherwise the
- * function does nothing.
+ * Generate the "freearray" function.
+ * Like gen_func_freeq(), this does nothing if the structure has no
+ * listings and releases nothing if "arena" is set.
  */
 static void
-gen_func_freeq(const struct strct *p)
+gen_func_freearray(const struct strct *p, int arena)
 {
 
-	if ( ! (STRCT_HAS_QUEUE & p->flags))
+	if (!(p->flags & STRCT_HAS_QUEUE))
 		return;
 
-	print_func_db_freeq(p, 0);
+	print_func_db_freearray(p, 0);
+	if (arena) {
+		puts("\n"
+		     "{\n"
+		     "\t/* Released with db_arena_release(). */\n"
+		     "}\n");
+		return;
+	}
 	printf("\n"
 	       "{\n"
-	       "\tstruct %s *p;\n\n"
-	       "\tif (q == NULL)\n"
+	       "\tsize_t i;\n"
+	       "\n"
+	       "\tif (a == NULL)\n"
 	       "\t\treturn;\n"
-	       "\twhile ((p = TAILQ_FIRST(q)) != NULL) {\n"
-	       "\t\tTAILQ_REMOVE(q, p, _entries);\n"
-	       "\t\tdb_%s_free(p);\n"
-	       "\t}\n"
-	       "\tfree(q);\n"
+	       "\tfor (i = 0; i < a->len; i++)\n"
+	       "\t\tdb_%s_unfill_r(&a->rows[i]);\n"
+	       "\tfree(a->rows);\n"
+	       "\tfree(a);\n"
 	       "}\n"
 	       "\n", 
-	       p->name, p->name);
+	       p->name);
 }
 
 /*
- * Generate the "insert" function.
- * This does nothing if we don't have an insert function.
+ * Emit the declarations of password hashes followed by binding the
+ * function arguments of an insert (with the rowid if "rowid") of "p"
+ * into "parms", which has "parms" elements.
  */
 static void
-gen_func_insert(const struct config *cfg, const struct strct *p)
+gen_insert_bind(const struct strct *p, int rowid, size_t parms)
 {
 	const struct field	*f;
-	size_t			 hpos, idx, parms = 0, tabs, pos;
-
-	if (p->ins == NULL)
-		return;
-
-	/* Count non-struct non-rowid parameters to bind. */
-
-	TAILQ_FOREACH(f, &p->fq, entries)
-		if (f->type != FTYPE_STRUCT && 
-		    !(f->flags & FIELD_ROWID))
-			parms++;
-
-	print_func_db_insert(p, 0);
-	puts("\n"
-	     "{\n"
-	     "\tint rc;\n"
-	     "\tint64_t id = -1;\n"
-	     "\tstruct sqlbox *db = ctx->db;");
-	if (parms > 0)
-		printf("\tstruct sqlbox_parm parms[%zu];\n", parms);
+	size_t			 hpos, idx, tabs, pos;
 
 	/* Start by generating password hashes. */
 
@@ -1331,8 +3392,7 @@ gen_func_insert(const struct config *cfg, const struct strct *p)
 
 	hpos = idx = 1;
 	TAILQ_FOREACH(f, &p->fq, entries) {
-		if (f->type == FTYPE_STRUCT ||
-		    (f->flags & FIELD_ROWID))
+		if (!insert_field(f, rowid))
 			continue;
 		if (f->type != FTYPE_PASSWORD) {
 			idx++;
@@ -1356,8 +3416,7 @@ gen_func_insert(const struct config *cfg, const struct strct *p)
 
 	hpos = pos = idx = 1;
 	TAILQ_FOREACH(f, &p->fq, entries) {
-		if (f->type == FTYPE_STRUCT ||
-		    (f->flags & FIELD_ROWID))
+		if (!insert_field(f, rowid))
 			continue;
 		tabs = 1;
 		if (f->flags & FIELD_NULL) {
@@ -1386,10 +3445,49 @@ gen_func_insert(const struct config *cfg, const struct strct *p)
 	}
 	if (parms > 0)
 		puts("");
+}
+
+/*
+ * Generate the "insert" function.
+ * This does nothing if we don't have an insert function.
+ */
+static void
+gen_func_insert(const struct config *cfg, const struct strct *p,
+	int stats)
+{
+	const struct field	*f;
+	size_t			 parms = 0;
+
+	if (p->ins == NULL)
+		return;
 
+	/* Count non-struct non-rowid parameters to bind. */
+
+	TAILQ_FOREACH(f, &p->fq, entries)
+		if (insert_field(f, 0))
+			parms++;
+
+	print_func_db_insert(p, 0);
+	puts("\n"
+	     "{\n"
+	     "\tint rc;\n"
+	     "\tint64_t id = -1;\n"
+	     "\tstruct sqlbox *db = ctx->db;");
+	if (parms > 0)
+		printf("\tstruct sqlbox_parm parms[%zu];\n", parms);
+	if (stats)
+		puts("\tstruct timespec start;");
+	gen_insert_bind(p, 0, parms);
+
+	if (stats)
+		puts("\tclock_gettime(CLOCK_MONOTONIC, &start);");
 	printf("\trc = sqlbox_exec(db, 0, STMT_%s_INSERT, \n"
-	       "\t     %zu, %s, SQLBOX_STMT_CONSTRAINT);\n"
-	       "\tif (rc == SQLBOX_CODE_ERROR)\n"
+	       "\t     %zu, %s, SQLBOX_STMT_CONSTRAINT);\n",
+	       p->name, parms, parms > 0 ? "parms" : "NULL");
+	if (stats)
+		printf("\tdb_stats_add(ctx, STMT_%s_INSERT, "
+			"&start, 0);\n", p->name);
+	printf("\tif (rc == SQLBOX_CODE_ERROR)\n"
 	       "\t\texit(EXIT_FAILURE);\n"
 	       "\telse if (rc != SQLBOX_CODE_OK)\n"
 	       "\t\treturn (-1);\n"
@@ -1397,19 +3495,150 @@ gen_func_insert(const struct config *cfg, const struct strct *p)
 	       "\t\texit(EXIT_FAILURE);\n"
 	       "\treturn id;\n"
 	       "}\n"
+	       "\n");
+}
+
+/*
+ * Emit stepping the statement "id" of an insert or update returning
+ * rows of "p" and, if it returns one, allocating and filling "p" with
+ * it from the result arena if "arena" is set.
+ * The statement is then stepped until done so that db_stmt_done() keeps
+ * it cached, as an update may return several rows.
+ * The linker makes sure that "p" has no nested structures.
+ */
+static void
+gen_returning_fill(const struct strct *p, int arena)
+{
+
+	puts("	if ((res = db_stmt_step(ctx, id)) == NULL)\n"
+	     "		exit(EXIT_FAILURE);\n"
+	     "	if (res->code != SQLBOX_CODE_CONSTRAINT && "
+	      "res->psz) {");
+	if (arena)
+		printf("\t\tp = db_arena_alloc"
+			"(ctx, sizeof(struct %s));\n", p->name);
+	else
+		printf("\t\tp = malloc(sizeof(struct %s));\n"
+		       "\t\tif (p == NULL) {\n"
+		       "\t\t\tperror(NULL);\n"
+		       "\t\t\texit(EXIT_FAILURE);\n"
+		       "\t\t}\n", p->name);
+	printf("\t\tdb_%s_fill(ctx, p, res, NULL);\n"
+	       "\t\twhile ((res = db_stmt_step(ctx, id)) != NULL &&\n"
+	       "\t\t    res->psz)\n"
+	       "\t\t\tcontinue;\n"
+	       "\t\tif (res == NULL)\n"
+	       "\t\t\texit(EXIT_FAILURE);\n"
+	       "\t}\n", p->name);
+}
+
+/*
+ * Generate the variant of the "insert" function returning the inserted
+ * row, including default values, from the same statement.
+ * This does nothing if the insert doesn't have this variant.
+ */
+static void
+gen_func_insert_returning(const struct config *cfg, 
+	const struct strct *p, int arena)
+{
+	const struct field	*f;
+	size_t			 parms = 0;
+
+	if (p->ins == NULL || !(p->ins->flags & INSERT_RETURNING))
+		return;
+
+	TAILQ_FOREACH(f, &p->fq, entries)
+		if (insert_field(f, 0))
+			parms++;
+
+	print_func_db_insert_returning(p, 0);
+	printf("\n"
+	       "{\n"
+	       "\tstruct %s *p = NULL;\n"
+	       "\tconst struct sqlbox_parmset *res;\n"
+	       "\tsize_t id;\n", p->name);
+	if (parms > 0)
+		printf("\tstruct sqlbox_parm parms[%zu];\n", parms);
+	gen_insert_bind(p, 0, parms);
+
+	printf("\tid = db_stmt_bind(ctx, STMT_%s_INSERT_RETURNING,\n"
+	       "\t    %zu, %s, SQLBOX_STMT_CONSTRAINT, 0);\n",
+	       p->name, parms, parms > 0 ? "parms" : "NULL");
+	gen_returning_fill(p, arena);
+	printf("\tdb_stmt_done(ctx, STMT_%s_INSERT_RETURNING, id);\n"
+	       "\treturn p;\n"
+	       "}\n"
+	       "\n", p->name);
+}
+
+/*
+ * Generate the "upsert" function, which inserts like the "insert"
+ * function but updates the conflicting row instead, returning its rowid
+ * in both cases.
+ * The row is returned by the statement, as the last insert identifier
+ * isn't set when updating.
+ * The statement is stepped until done to complete it.
+ * This does nothing if we don't have an upsert function.
+ */
+static void
+gen_func_upsert(const struct config *cfg, const struct strct *p)
+{
+	const struct field	*f;
+	size_t			 parms = 0;
+	int			 rowid;
+
+	if (p->ups == NULL)
+		return;
+
+	rowid = (p->ups->flags & UPSERT_ROWID) != 0;
+	TAILQ_FOREACH(f, &p->fq, entries)
+		if (insert_field(f, rowid))
+			parms++;
+	assert(parms > 0);
+
+	print_func_db_upsert(p, 0);
+	printf("\n"
+	       "{\n"
+	       "\tconst struct sqlbox_parmset *res;\n"
+	       "\tint64_t rowid = -1;\n"
+	       "\tsize_t id;\n"
+	       "\tstruct sqlbox_parm parms[%zu];\n", parms);
+	gen_insert_bind(p, rowid, parms);
+
+	printf("\tid = db_stmt_bind(ctx, STMT_%s_UPSERT,\n"
+	       "\t    %zu, parms, SQLBOX_STMT_CONSTRAINT, 0);\n"
+	       "\tif ((res = db_stmt_step(ctx, id)) == NULL)\n"
+	       "\t\texit(EXIT_FAILURE);\n"
+	       "\tif (res->code != SQLBOX_CODE_CONSTRAINT) {\n"
+	       "\t\tif (res->psz != 1 ||\n"
+	       "\t\t    sqlbox_parm_int(&res->ps[0], &rowid) == -1)\n"
+	       "\t\t\texit(EXIT_FAILURE);\n"
+	       "\t\tif ((res = db_stmt_step(ctx, id)) == NULL)\n"
+	       "\t\t\texit(EXIT_FAILURE);\n"
+	       "\t}\n"
+	       "\tdb_stmt_done(ctx, STMT_%s_UPSERT, id);\n"
+	       "\treturn rowid;\n"
+	       "}\n"
 	       "\n",
-	       p->name, parms,
-	       parms > 0 ? "parms" : "NULL");
+	       p->name, parms, p->name);
 }
 
 /*
  * Generate the "free" function.
+ * Like gen_func_freeq(), this does nothing if "arena" is set.
  */
 static void
-gen_func_free(const struct strct *p)
+gen_func_free(const struct strct *p, int arena)
 {
 
 	print_func_db_free(p, 0);
+	if (arena) {
+		puts("\n"
+		     "{\n"
+		     "\t/* Released with db_arena_release(). */\n"
+		     "}\n");
+		return;
+	}
 	printf("\n"
 	       "{\n"
 	       "\tdb_%s_unfill_r(p);\n"
@@ -1487,104 +3716,155 @@ gen_func_unfill_r(const struct strct *p)
 }
 
 /*
- * If a structure has possible null foreign keys, we need to fill in the
- * null keys after the lookup has taken place IFF they aren't null.
- * Do that here, using the STMT_XXX_BY_UNIQUE_yyy fields we generated
- * earlier.
- * This is only done for structures that have (or have nested)
- * structures with null foreign keys.
+ * Count the columns selected for "p" by gen_stmt_schema(), which
+ * includes those of all nested structures.
  */
-static void
-gen_func_reffind(const struct config *cfg, const struct strct *p)
+static size_t
+gen_ncols_r(const struct strct *p)
 {
 	const struct field *f;
-
-	if (!(p->flags & STRCT_HAS_NULLREFS))
-		return;
+	size_t		    n = 0;
 
 	TAILQ_FOREACH(f, &p->fq, entries)
-		if ((f->type == FTYPE_STRUCT) &&
-		    (f->ref->source->flags & FIELD_NULL))
-			break;
-
-	printf("static void\n"
-	       "db_%s_reffind(%sstruct %s *p, struct sqlbox *db)\n"
-	       "{\n", p->name, (!TAILQ_EMPTY(&cfg->rq)) ? 
-	       "struct ort *ctx, " : "", p->name);
-	if (f != NULL)
-		puts("\tconst struct sqlbox_parmset *res;\n"
-		     "\tstruct sqlbox_parm parm;");
-
-	puts("");
-	TAILQ_FOREACH(f, &p->fq, entries) {
-		if (f->type != FTYPE_STRUCT)
-			continue;
-		if ((f->ref->source->flags & FIELD_NULL))
-			printf("\tif (p->has_%s) {\n"
-			       "\t\tparm.type = SQLBOX_PARM_INT;\n"
-			       "\t\tparm.iparm = p->%s;\n"
-			       "\t\tif (!sqlbox_prepare_bind_async\n"
-			       "\t\t    (db, 0, STMT_%s_BY_UNIQUE_%s, 1, &parm, 0))\n"
-			       "\t\t\texit(EXIT_FAILURE);\n"
-			       "\t\tif ((res = sqlbox_step(db, 0)) == NULL)\n"
-			       "\t\t\texit(EXIT_FAILURE);\n"
-			       "\t\tdb_%s_fill_r(ctx, &p->%s, res, NULL);\n"
-			       "\t\tif (!sqlbox_finalise(db, 0))\n"
-			       "\t\t\texit(EXIT_FAILURE);\n"
-			       "\t\tp->has_%s = 1;\n"
-			       "\t}\n",
-			       f->ref->source->name,
-			       f->ref->source->name,
-			       f->ref->target->parent->name,
-			       f->ref->target->name,
-			       f->ref->target->parent->name,
-			       f->name, f->name);
-		if (!(f->ref->target->parent->flags & 
-		    STRCT_HAS_NULLREFS))
-			continue;
-		printf("\tdb_%s_reffind(%s&p->%s, db);\n", 
-			f->ref->target->parent->name, 
-			(!TAILQ_EMPTY(&cfg->rq)) ? 
-			"ctx, " : "", f->name);
-	}
-	puts("}\n");
+		if (f->type == FTYPE_STRUCT)
+			n += gen_ncols_r(f->ref->target->parent);
+		else
+			n++;
+	return n;
 }
 
 /*
  * Generate the recursive "fill" function.
  * This simply calls to the underlying "fill" function for all
  * strutcures in the object.
+ * Structures on null foreign keys are from a LEFT OUTER JOIN, so they
+ * exist only if the joined target column is not null.
+ * Otherwise, their columns are skipped.
+ * If "borrow" is set, this uses the "fill_borrow" functions.
  */
 static void
-gen_func_fill_r(const struct config *cfg, const struct strct *p)
+gen_func_fill_r(const struct config *cfg, 
+	const struct strct *p, int borrow)
 {
-	const struct field *f;
+	const struct field *f, *ff;
+	size_t		    col;
+	const char	   *sfx = borrow ? "_borrow" : "";
 
 	printf("static void\n"
-	       "db_%s_fill_r(struct ort *ctx, struct %s *p,\n"
+	       "db_%s_fill%s_r(struct ort *ctx, struct %s *p,\n"
 	       "\tconst struct sqlbox_parmset *res, size_t *pos)\n"
 	       "{\n"
 	       "\tsize_t i = 0;\n"
 	       "\n"
 	       "\tif (pos == NULL)\n"
 	       "\t\tpos = &i;\n"
-	       "\tdb_%s_fill(ctx, p, res, pos);\n",
-	       p->name, p->name, p->name);
+	       "\tdb_%s_fill%s(ctx, p, res, pos);\n",
+	       p->name, sfx, p->name, p->name, sfx);
 
-	TAILQ_FOREACH(f, &p->fq, entries)
-		if (f->type == FTYPE_STRUCT &&
-		    !(f->ref->source->flags & FIELD_NULL))
-			printf("\tdb_%s_fill_r(ctx, &p->%s, "
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (f->type != FTYPE_STRUCT)
+			continue;
+		if (!(f->ref->source->flags & FIELD_NULL)) {
+			printf("\tdb_%s_fill%s_r(ctx, &p->%s, "
 				"res, pos);\n", 
-				f->ref->target->parent->name, f->name);
+				f->ref->target->parent->name, sfx, 
+				f->name);
+			continue;
+		}
+		col = 0;
+		TAILQ_FOREACH(ff, &f->ref->target->parent->fq, entries)
+			if (ff == f->ref->target)
+				break;
+			else if (ff->type != FTYPE_STRUCT)
+				col++;
+		assert(ff != NULL);
+		printf("\tp->has_%s = res->ps[*pos + %zu].type != "
+			"SQLBOX_PARM_NULL;\n"
+		       "\tif (p->has_%s)\n"
+		       "\t\tdb_%s_fill%s_r(ctx, &p->%s, res, pos);\n"
+		       "\telse\n"
+		       "\t\t*pos += %zu;\n",
+		       f->name, col, f->name,
+		       f->ref->target->parent->name, sfx, f->name,
+		       gen_ncols_r(f->ref->target->parent));
+	}
 	puts("}\n");
 }
 
+/*
+ * Emit allocating the role store of a freshly filled "p", if roles are
+ * defined.
+ * Borrowed rows share the store in the context, which is set by the
+ * borrowed iterate functions.
+ */
+static void
+gen_func_fill_store(const struct config *cfg, int arena, int borrow)
+{
+
+	if (!TAILQ_EMPTY(&cfg->rq) && borrow) {
+		puts("\tp->priv_store = &ctx->store;");
+	} else if (!TAILQ_EMPTY(&cfg->rq) && arena) {
+		puts("\tp->priv_store = db_arena_alloc"
+		      "(ctx, sizeof(struct ort_store));\n"
+		     "\tp->priv_store->role = ctx->role;");
+	} else if (!TAILQ_EMPTY(&cfg->rq)) {
+		puts("\tp->priv_store = malloc"
+		      "(sizeof(struct ort_store));\n"
+		     "\tif (p->priv_store == NULL) {\n"
+		     "\t\tperror(NULL);\n"
+		     "\t\texit(EXIT_FAILURE);\n"
+		     "\t}\n"
+		     "\tp->priv_store->role = ctx->role;");
+	}
+}
+
+/*
+ * Whether filling "from" also fills "p", either as itself or as a
+ * nested structure.
+ */
+static int
+strct_fills(const struct strct *from, const struct strct *p)
+{
+	const struct field	*f;
+
+	if (from == p)
+		return 1;
+	TAILQ_FOREACH(f, &from->fq, entries)
+		if (f->type == FTYPE_STRUCT &&
+		    strct_fills(f->ref->target->parent, p))
+			return 1;
+	return 0;
+}
+
+/*
+ * Whether "p" needs the "fill_borrow" functions, i.e., it's filled by
+ * the borrowed variant of an iterate search without a projection.
+ */
+static int
+strct_borrowed(const struct config *cfg, const struct strct *p)
+{
+	const struct strct	*ps;
+	const struct search	*s;
+
+	TAILQ_FOREACH(ps, &cfg->sq, entries)
+		TAILQ_FOREACH(s, &ps->sq, entries)
+			if (s->type == STYPE_ITERATE &&
+			    TAILQ_EMPTY(&s->projq) &&
+			    strct_fills(s->dst != NULL ? 
+			     s->dst->strct : ps, p))
+				return 1;
+	return 0;
+}
+
 /*
  * Generate the "fill" function.
+ * If "arena" is set, all memory is allocated from the result arena.
+ * If "borrow" is set, this is the allocation-free "fill_borrow"
+ * function, whose strings and blobs point into the result set.
  */
 static void
-gen_func_fill(const struct config *cfg, const struct strct *p)
+gen_func_fill(const struct config *cfg, 
+	const struct strct *p, int arena, int borrow)
 {
 	const struct field	*f;
 	int	 		 needint = 0;
@@ -1601,16 +3881,25 @@ gen_func_fill(const struct config *cfg, const struct strct *p)
 		    f->type == FTYPE_EPOCH)
 			needint = 1;
 
-	print_commentv(0, COMMENT_C, 
-	       "Fill in a %s from an open statement \"stmt\".\n"
-	       "This starts grabbing results from \"pos\", "
-	       "which may be NULL to start from zero.\n"
-	       "This follows DB_SCHEMA_%s's order for columns.",
-	       p->name, p->name);
+	if (borrow)
+		print_commentv(0, COMMENT_C, 
+		       "Like db_%s_fill(), but strings and blobs "
+		       "point into \"set\" and are not allocated.\n"
+		       "The result must not be unfilled.",
+		       p->name);
+	else
+		print_commentv(0, COMMENT_C, 
+		       "Fill in a %s from an open statement "
+		       "\"stmt\".\n"
+		       "This starts grabbing results from \"pos\", "
+		       "which may be NULL to start from zero.\n"
+		       "This follows DB_SCHEMA_%s's order for "
+		       "columns.",
+		       p->name, p->name);
 	printf("static void\n"
-	       "db_%s_fill(struct ort *ctx, struct %s *p, "
+	       "db_%s_fill%s(struct ort *ctx, struct %s *p, "
 		"const struct sqlbox_parmset *set, size_t *pos)\n",
-	       p->name, p->name);
+	       p->name, borrow ? "_borrow" : "", p->name);
 	puts("{\n"
 	     "\tsize_t i = 0;");
 	if (needint)
@@ -1620,25 +3909,66 @@ gen_func_fill(const struct config *cfg, const struct strct *p)
 	     "\t\tpos = &i;\n"
 	     "\tmemset(p, 0, sizeof(*p));");
 	TAILQ_FOREACH(f, &p->fq, entries)
-		gen_strct_fill_field(f);
-	if (!TAILQ_EMPTY(&cfg->rq)) {
-		puts("\tp->priv_store = malloc"
-		      "(sizeof(struct ort_store));\n"
-		     "\tif (p->priv_store == NULL) {\n"
-		     "\t\tperror(NULL);\n"
-		     "\t\texit(EXIT_FAILURE);\n"
-		     "\t}\n"
-		     "\tp->priv_store->role = ctx->role;");
-	}
+		gen_strct_fill_field(f, arena, borrow);
+	gen_func_fill_store(cfg, arena, borrow);
+	puts("}\n");
+}
+
+/*
+ * Like gen_func_fill(), but for the "num"th search "s", which has a
+ * projection: only the projected columns are in the result set, in
+ * order, and all other members (including nested structures) are
+ * zeroed.
+ */
+static void
+gen_func_fill_proj(const struct config *cfg, 
+	const struct search *s, size_t num, int arena, int borrow)
+{
+	const struct proj	*pr;
+	int	 		 needint = 0;
+
+	TAILQ_FOREACH(pr, &s->projq, entries)
+		if (pr->field->type == FTYPE_ENUM || 
+		    pr->field->type == FTYPE_DATE ||
+		    pr->field->type == FTYPE_EPOCH)
+			needint = 1;
+
+	if (borrow)
+		print_commentv(0, COMMENT_C, 
+		       "Like db_%s_fill_proj_%zu(), but strings and "
+		       "blobs point into \"set\".",
+		       s->parent->name, num);
+	else
+		print_commentv(0, COMMENT_C, 
+		       "Fill in the projected fields of a %s from an "
+		       "open statement \"set\" of query %zu.\n"
+		       "Other fields are zeroed.",
+		       s->parent->name, num);
+	printf("static void\n"
+	       "db_%s_fill_proj_%zu%s(struct ort *ctx, struct %s *p, "
+		"const struct sqlbox_parmset *set)\n",
+	       s->parent->name, num, borrow ? "_borrow" : "",
+	       s->parent->name);
+	puts("{\n"
+	     "\tsize_t i = 0, *pos = &i;");
+	if (needint)
+		puts("\tint64_t tmpint;");
+	puts("\n"
+	     "\tmemset(p, 0, sizeof(*p));");
+	TAILQ_FOREACH(pr, &s->projq, entries)
+		gen_strct_fill_field(pr->field, arena, borrow);
+	gen_func_fill_store(cfg, arena, borrow);
 	puts("}\n");
 }
 
 /*
  * Generate an update or delete function.
+ * If "returning", this is the variant of an update returning the first
+ * updated row, allocated from the result arena if "arena" is set.
  */
 static void
-gen_func_update(const struct config *cfg,
-	const struct update *up, size_t num)
+gen_func_update(const struct config *cfg, const struct update *up,
+	size_t num, int arena, int returning, int stats)
 {
 	const struct uref	*ref;
 	size_t	 		 pos, idx, hpos, parms = 0, tabs;
@@ -1657,13 +3987,25 @@ gen_func_update(const struct config *cfg,
 
 	/* Emit function prologue. */
 
-	print_func_db_update(up, 0);
-	puts("\n"
-	     "{\n"
-	     "\tenum sqlbox_code c;\n"
-	     "\tstruct sqlbox *db = ctx->db;");
+	if (returning) {
+		print_func_db_update_returning(up, 0);
+		printf("\n"
+		       "{\n"
+		       "\tstruct %s *p = NULL;\n"
+		       "\tconst struct sqlbox_parmset *res;\n"
+		       "\tsize_t id;\n", up->parent->name);
+	} else {
+		print_func_db_update(up, 0);
+		puts("\n"
+		     "{\n"
+		     "\tenum sqlbox_code c;\n"
+		     "\tstruct sqlbox *db = ctx->db;");
+		if (stats)
+			puts("\tstruct timespec start;");
+	}
 	if (parms > 0)
 		printf("\tstruct sqlbox_parm parms[%zu];\n", parms);
+	gen_update_in(up, 1);
 
 	/* 
 	 * Handle case of hashing first.
@@ -1748,18 +4090,42 @@ gen_func_update(const struct config *cfg,
 		pos++;
 	}
 
-	printf("\n"
-	       "\tc = sqlbox_exec\n"
+	if (returning) {
+		printf("\n"
+		       "\tid = db_stmt_bind(ctx, "
+			"STMT_%s_UPDATE_%zu_RETURNING,\n"
+		       "\t    %zu, %s, SQLBOX_STMT_CONSTRAINT, 0);\n",
+		       up->parent->name, num, 
+		       parms, parms > 0 ? "parms" : "NULL");
+		gen_update_in(up, 0);
+		gen_returning_fill(up->parent, arena);
+		printf("\tdb_stmt_done(ctx, "
+			"STMT_%s_UPDATE_%zu_RETURNING, id);\n"
+		       "\treturn p;\n"
+		       "}\n"
+		       "\n", up->parent->name, num);
+		return;
+	}
+
+	puts("");
+	if (stats)
+		puts("\tclock_gettime(CLOCK_MONOTONIC, &start);");
+	printf("\tc = sqlbox_exec\n"
 	       "\t\t(db, 0, STMT_%s_%s_%zu,\n"
-	       "\t\t %zu, %s, SQLBOX_STMT_CONSTRAINT);\n"
-	       "\tif (c == SQLBOX_CODE_ERROR)\n"
-	       "\t\texit(EXIT_FAILURE);\n"
-	       "\treturn (c == SQLBOX_CODE_OK) ? 1 : 0;\n"
-	       "}\n"
-	       "\n",
+	       "\t\t %zu, %s, SQLBOX_STMT_CONSTRAINT);\n",
 	       up->parent->name, 
 	       up->type == UP_MODIFY ? "UPDATE" : "DELETE",
 	       num, parms, parms > 0 ? "parms" : "NULL");
+	if (stats)
+		printf("\tdb_stats_add(ctx, STMT_%s_%s_%zu, "
+			"&start, 0);\n", up->parent->name,
+			up->type == UP_MODIFY ? "UPDATE" : "DELETE",
+			num);
+	gen_update_in(up, 0);
+	puts("\tif (c == SQLBOX_CODE_ERROR)\n"
+	     "\t\texit(EXIT_FAILURE);\n"
+	     "\treturn (c == SQLBOX_CODE_OK) ? 1 : 0;\n"
+	     "}\n");
 }
 
 /*
@@ -1853,16 +4219,28 @@ gen_func_json_obj(const struct strct *p)
 	if (STRCT_HAS_QUEUE & p->flags) {
 		print_func_json_array(p, 0);
 		printf("{\n"
-		       "\tstruct %s *p;\n"
+		       "\tstruct %s *p;\n"
+		       "\n"
+		       "\tkjson_arrayp_open(r, \"%s_q\");\n"
+		       "\tTAILQ_FOREACH(p, q, _entries) {\n"
+		       "\t\tkjson_obj_open(r);\n"
+		       "\t\tjson_%s_data(r, p);\n"
+		       "\t\tkjson_obj_close(r);\n"
+		       "\t}\n"
+		       "\tkjson_array_close(r);\n"
+		       "}\n\n", p->name, p->name, p->name);
+		print_func_json_rows(p, 0);
+		printf("{\n"
+		       "\tsize_t i;\n"
 		       "\n"
 		       "\tkjson_arrayp_open(r, \"%s_q\");\n"
-		       "\tTAILQ_FOREACH(p, q, _entries) {\n"
+		       "\tfor (i = 0; i < a->len; i++) {\n"
 		       "\t\tkjson_obj_open(r);\n"
-		       "\t\tjson_%s_data(r, p);\n"
+		       "\t\tjson_%s_data(r, &a->rows[i]);\n"
 		       "\t\tkjson_obj_close(r);\n"
 		       "\t}\n"
 		       "\tkjson_array_close(r);\n"
-		       "}\n\n", p->name, p->name, p->name);
+		       "}\n\n", p->name, p->name);
 	}
 
 	if (STRCT_HAS_ITERATOR & p->flags) {
@@ -2243,17 +4621,17 @@ gen_func_json_parse(const struct strct *p)
 	       "\n", p->name, p->name);
 }
 
+/*
+ * Emit the body of a JSON data function writing the "fsz" fields "fa"
+ * of the object "p".
+ */
 static void
-gen_func_json_data(const struct strct *p)
+gen_json_data_fields(const struct field *const *fa, size_t fsz)
 {
 	const struct field *f;
-	size_t	 pos;
+	size_t	 i, pos;
 	int	 sp;
 
-	print_func_json_data(p, 0);
-	puts("\n"
-	     "{");
-
 	/* 
 	 * Declare our base64 buffers. 
 	 * FIXME: have the buffer only be allocated if we have the value
@@ -2261,9 +4639,9 @@ gen_func_json_data(const struct strct *p)
 	 */
 
 	pos = 0;
-	TAILQ_FOREACH(f, &p->fq, entries)
-		if (FTYPE_BLOB == f->type &&
-		    ! (FIELD_NOEXPORT & f->flags)) 
+	for (i = 0; i < fsz; i++)
+		if (FTYPE_BLOB == fa[i]->type &&
+		    ! (FIELD_NOEXPORT & fa[i]->flags)) 
 			printf("\tchar *buf%zu;\n", ++pos);
 
 	if (pos > 0) {
@@ -2279,7 +4657,8 @@ gen_func_json_data(const struct strct *p)
 	}
 
 	pos = 0;
-	TAILQ_FOREACH(f, &p->fq, entries) {
+	for (i = 0; i < fsz; i++) {
+		f = fa[i];
 		if (FTYPE_BLOB != f->type || 
 		    FIELD_NOEXPORT & f->flags)
 			continue;
@@ -2301,13 +4680,14 @@ gen_func_json_data(const struct strct *p)
 		puts("");
 
 	pos = 0;
-	TAILQ_FOREACH(f, &p->fq, entries)
-		gen_field_json_data(f, &pos, &sp);
+	for (i = 0; i < fsz; i++)
+		gen_field_json_data(fa[i], &pos, &sp);
 
 	/* Free our temporary base64 buffers. */
 
 	pos = 0;
-	TAILQ_FOREACH(f, &p->fq, entries) {
+	for (i = 0; i < fsz; i++) {
+		f = fa[i];
 		if (FIELD_NOEXPORT & f->flags)
 			continue;
 		if (FTYPE_BLOB == f->type && 0 == pos)
@@ -2315,9 +4695,57 @@ gen_func_json_data(const struct strct *p)
 		if (FTYPE_BLOB == f->type) 
 			printf("\tfree(buf%zu);\n", ++pos);
 	}
+}
+
+static void
+gen_func_json_data(const struct strct *p)
+{
+	const struct field	 *f, **fa;
+	size_t			  fsz = 0;
+
+	TAILQ_FOREACH(f, &p->fq, entries)
+		fsz++;
+	if ((fa = calloc(fsz, sizeof(struct field *))) == NULL)
+		err(EXIT_FAILURE, NULL);
+	fsz = 0;
+	TAILQ_FOREACH(f, &p->fq, entries)
+		fa[fsz++] = f;
+
+	print_func_json_data(p, 0);
+	puts("\n"
+	     "{");
+	gen_json_data_fields(fa, fsz);
+	puts("}\n"
+	     "");
+	free(fa);
+}
 
+/*
+ * Like gen_func_json_data(), but only writing the fields projected by
+ * the search "s", as the others are not filled in.
+ */
+static void
+gen_func_json_search_data(const struct search *s)
+{
+	const struct proj	 *pr;
+	const struct field	**fa;
+	size_t			  fsz = 0;
+
+	TAILQ_FOREACH(pr, &s->projq, entries)
+		fsz++;
+	if ((fa = calloc(fsz, sizeof(struct field *))) == NULL)
+		err(EXIT_FAILURE, NULL);
+	fsz = 0;
+	TAILQ_FOREACH(pr, &s->projq, entries)
+		fa[fsz++] = pr->field;
+
+	print_func_json_search_data(s, 0);
+	puts("\n"
+	     "{");
+	gen_json_data_fields(fa, fsz);
 	puts("}\n"
 	     "");
+	free(fa);
 }
 
 /*
@@ -2326,21 +4754,31 @@ gen_func_json_data(const struct strct *p)
  */
 static void
 gen_funcs(const struct config *cfg, const struct strct *p, 
-	int json, int jsonparse, int valids, int dbin)
+	int json, int jsonparse, int valids, int dbin, int arena,
+	int stats)
 {
 	const struct search *s;
 	const struct update *u;
 	size_t	 pos;
 
 	if (dbin) {
-		gen_func_fill(cfg, p);
-		gen_func_fill_r(cfg, p);
-		gen_func_unfill(cfg, p);
-		gen_func_unfill_r(p);
-		gen_func_reffind(cfg, p);
-		gen_func_free(p);
-		gen_func_freeq(p);
-		gen_func_insert(cfg, p);
+		gen_func_fill(cfg, p, arena, 0);
+		gen_func_fill_r(cfg, p, 0);
+		if (strct_borrowed(cfg, p)) {
+			gen_func_fill(cfg, p, arena, 1);
+			gen_func_fill_r(cfg, p, 1);
+		}
+		if (!arena) {
+			gen_func_unfill(cfg, p);
+			gen_func_unfill_r(p);
+		}
+		gen_func_free(p, arena);
+		gen_func_freeq(p, arena);
+		gen_func_freearray(p, arena);
+		gen_func_insert(cfg, p, stats);
+		gen_func_insert_returning(cfg, p, arena);
+		gen_func_insert_many(cfg, p, stats);
+		gen_func_upsert(cfg, p);
 	}
 
 	if (json) {
@@ -2358,503 +4796,201 @@ gen_funcs(const struct config *cfg, const struct strct *p,
 		return;
 
 	pos = 0;
-	TAILQ_FOREACH(s, &p->sq, entries)
+	TAILQ_FOREACH(s, &p->sq, entries) {
+		if (!TAILQ_EMPTY(&s->projq))
+			gen_func_fill_proj(cfg, s, pos, arena, 0);
+		if (!TAILQ_EMPTY(&s->projq) && 
+		    s->type == STYPE_ITERATE)
+			gen_func_fill_proj(cfg, s, pos, arena, 1);
 		if (s->type == STYPE_SEARCH)
-			gen_strct_func_srch(cfg, s, pos++);
-		else if (s->type == STYPE_LIST)
-			gen_strct_func_list(cfg, s, pos++);
-		else if (s->type == STYPE_COUNT)
+			gen_strct_func_srch(cfg, s, pos++, arena);
+		else if (s->type == STYPE_LIST) {
+			gen_strct_func_list(cfg, s, pos, arena, 0);
+			if (s->flags & SEARCH_PAGINATE)
+				gen_strct_func_list(cfg, s, pos, arena, 1);
+			gen_strct_func_array(cfg, s, pos++, arena);
+		} else if (s->type == STYPE_COUNT)
 			gen_strct_func_count(cfg, s, pos++);
-		else
-			gen_strct_func_iter(cfg, s, pos++);
+		else {
+			gen_strct_func_iter(cfg, s, pos, arena, 0, 0);
+			if (s->flags & SEARCH_PAGINATE)
+				gen_strct_func_iter
+					(cfg, s, pos, arena, 1, 0);
+			gen_strct_func_iter(cfg, s, pos, arena, 0, 1);
+			if (json && s->dst == NULL &&
+			    TAILQ_EMPTY(&s->projq))
+				gen_strct_func_iter_json(s);
+			pos++;
+		}
+	}
+
+	if (json)
+		TAILQ_FOREACH(s, &p->sq, entries)
+			if (!TAILQ_EMPTY(&s->projq))
+				gen_func_json_search_data(s);
 
 	pos = 0;
-	TAILQ_FOREACH(u, &p->uq, entries)
-		gen_func_update(cfg, u, pos++);
+	TAILQ_FOREACH(u, &p->uq, entries) {
+		gen_func_update(cfg, u, pos, arena, 0, stats);
+		if (u->flags & UPDATE_RETURNING)
+			gen_func_update(cfg, u, pos, arena, 1, stats);
+		pos++;
+	}
 	pos = 0;
 	TAILQ_FOREACH(u, &p->dq, entries)
-		gen_func_update(cfg, u, pos++);
+		gen_func_update(cfg, u, pos++, arena, 0, stats);
 }
 
 /*
- * Generate a set of statements as an enumeration that will be used for
- * this structure.
- * Does not print the opening "enum xxx {" parts or trailing.
+ * Print a statement enumeration built from "fmt": as an enumeration
+ * value or, if "name" is set, as its name in a string literal.
  */
 static void
-gen_enum(const struct strct *p)
+gen_enum_ent(int name, const char *fmt, ...)
 {
-	const struct search	*s;
-	const struct update	*u;
-	const struct field	*f;
-	size_t			 pos;
-
-	TAILQ_FOREACH(f, &p->fq, entries)
-		if ((f->flags & (FIELD_UNIQUE|FIELD_ROWID)))
-			printf("\tSTMT_%s_BY_UNIQUE_%s,\n", 
-				p->name, f->name);
-
-	pos = 0;
-	TAILQ_FOREACH(s, &p->sq, entries)
-		printf("\tSTMT_%s_BY_SEARCH_%zu,\n", p->name, pos++);
-
-	if (p->ins != NULL)
-		printf("\tSTMT_%s_INSERT,\n", p->name);
-
-	pos = 0;
-	TAILQ_FOREACH(u, &p->uq, entries)
-		printf("\tSTMT_%s_UPDATE_%zu,\n", p->name, pos++);
+	va_list	 ap;
 
-	pos = 0;
-	TAILQ_FOREACH(u, &p->dq, entries)
-		printf("\tSTMT_%s_DELETE_%zu,\n", p->name, pos++);
+	fputs(name ? "\t\"" : "\t", stdout);
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	puts(name ? "\"," : ",");
 }
 
 /*
- * Recursively generate a series of DB_SCHEMA_xxx statements for getting
- * data on a structure.
- * This will specify the schema of the top-level structure (pname is
- * NULL), then generate aliased schemas for all of the recursive
- * structures.
- * It breaks lines depending upon the output position in "col".
- * See gen_stmt_joins().
+ * Generate a set of statements as an enumeration that will be used for
+ * this structure, which are those of stmt_gen() as printed by gen_stmt().
+ * If "name" is set, print the enumeration names as strings instead.
+ * Does not print the opening "enum xxx {" parts or trailing.
  */
 static void
-gen_stmt_schema(const struct strct *orig, int first,
-	const struct strct *p, const char *pname, size_t *col)
+gen_enum(const struct strct *p, int name)
 {
-	const struct field *f;
-	const struct alias *a = NULL;
-	int	 	    c;
-	char		   *name = NULL;
-
-	*col += printf("\"%s ", !first ? ",\"" : "");
-	if (!first && *col >= 72) {
-		printf("\n\t\t");
-		*col = 16;
-	}
-
-	/* 
-	 * If applicable, looks up our alias and emit it as the alias
-	 * for the table.
-	 * Otherwise, use the table name itself.
-	 */
-
-	if (pname != NULL) {
-		TAILQ_FOREACH(a, &orig->aq, entries)
-			if (strcasecmp(a->name, pname) == 0)
-				break;
-		assert(a != NULL);
-		*col += printf("DB_SCHEMA_%s(%s) ", p->name, a->alias);
-	} else
-		*col += printf("DB_SCHEMA_%s(%s) ", p->name, p->name);
-
-	/*
-	 * Recursive step.
-	 * Search through all of our fields for structures.
-	 * If we find them, build up the canonical field reference and
-	 * descend.
-	 */
-
-	TAILQ_FOREACH(f, &p->fq, entries) {
-		if (f->type != FTYPE_STRUCT ||
-		    (f->ref->source->flags & FIELD_NULL))
-			continue;
+	struct sqlstmtq	 q;
+	size_t		 i;
 
-		if (pname != NULL) {
-			c = asprintf(&name, "%s.%s", pname, f->name);
-			if (c < 0)
-				err(EXIT_FAILURE, NULL);
-		} else if ((name = strdup(f->name)) == NULL)
-			err(EXIT_FAILURE, "strdup");
-		gen_stmt_schema(orig, 0,
-			f->ref->target->parent, name, col);
-		free(name);
-	}
+	stmt_gen(p, 0, &q);
+	for (i = 0; i < q.stmtsz; i++)
+		gen_enum_ent(name, "%s", q.stmt[i].name);
+	stmt_free(&q);
 }
 
 /*
- * Recursively generate a series of INNER JOIN statements for any
- * structure object.
- * If the structure object has no inner nested components, this will not
- * do anything.
- * See gen_stmt_schema().
+ * Generate the statement enumerations (or their names if "name" is set)
+ * for the pragmas of "db".
  */
 static void
-gen_stmt_joins(const struct strct *orig, const struct strct *p, 
-	const struct alias *parent, size_t *count)
+gen_enum_database(const struct database *db, int name)
 {
-	const struct field *f;
-	const struct alias *a;
-	int	 c;
-	char	*name;
-
-	TAILQ_FOREACH(f, &p->fq, entries) {
-		if (FTYPE_STRUCT != f->type ||
-		    FIELD_NULL & f->ref->source->flags)
-			continue;
-
-		if (NULL != parent) {
-			c = asprintf(&name, "%s.%s", 
-				parent->name, f->name);
-			if (c < 0)
-				err(EXIT_FAILURE, NULL);
-		} else if (NULL == (name = strdup(f->name)))
-			err(EXIT_FAILURE, NULL);
 
-		TAILQ_FOREACH(a, &orig->aq, entries)
-			if (0 == strcasecmp(a->name, name))
-				break;
-		assert(NULL != a);
-
-		if (0 == *count)
-			printf(" \"");
-
-		(*count)++;
-		printf("\n\t\t\"INNER JOIN %s AS %s ON %s.%s=%s.%s \"",
-			f->ref->target->parent->name, a->alias,
-			a->alias, f->ref->target->name,
-			NULL == parent ? p->name : parent->alias,
-			f->ref->source->name);
-		gen_stmt_joins(orig, 
-			f->ref->target->parent, a, count);
-		free(name);
-	}
+	if (db->journal != JOURNAL_UNSET)
+		gen_enum_ent(name, "STMT__PRAGMA_JOURNAL");
+	if (db->sync != SYNCMODE_UNSET)
+		gen_enum_ent(name, "STMT__PRAGMA_SYNC");
+	if (db->temp != TEMPSTORE_UNSET)
+		gen_enum_ent(name, "STMT__PRAGMA_TEMP");
+	if (db->flags & DATABASE_MMAP)
+		gen_enum_ent(name, "STMT__PRAGMA_MMAP");
+	if (db->flags & DATABASE_CACHE)
+		gen_enum_ent(name, "STMT__PRAGMA_CACHE");
 }
 
 /*
- * Fill in the statements noted in gen_enum().
- * This function is an important one because we're going to create the
- * raw SQL that's passed into sqlbox.
+ * Print part "pt" of a statement from output column "col", breaking
+ * lines before words that would exceed the 72nd column.
+ * Text is printed within a string literal and columns as DB_SCHEMA_xxx
+ * macros outside of it, "quoted" being whether within the literal.
  */
 static void
-gen_stmt(const struct strct *p)
+gen_stmt_part(const struct sqlpart *pt, size_t *col, int *quoted)
 {
-	const struct search *s;
-	const struct sent   *sent;
-	const struct field  *f;
-	const struct update *up;
-	const struct uref   *ur;
-	const struct ord    *ord;
-	int		     first, hastrail, needquot;
-	size_t		     pos, rc, col;
-
-	/* 
-	 * We have a special query just for our unique fields.
-	 * These are generated in the event of null foreign key
-	 * reference lookups with the generated db_xxx_reffind()
-	 * functions.
-	 * TODO: figure out which ones we should be generating and only
-	 * do this, as otherwise we're just wasting static space.
-	 */
-
-	TAILQ_FOREACH(f, &p->fq, entries) 
-		if ((f->flags & (FIELD_ROWID|FIELD_UNIQUE))) {
-			printf("\t/* STMT_%s_BY_UNIQUE_%s */\n"
-			       "\t\"SELECT ", p->name, f->name);
-			col = 16;
-			gen_stmt_schema(p, 1, p, NULL, &col);
-			printf("\" FROM %s", p->name);
-			rc = 0;
-			gen_stmt_joins(p, p, NULL, &rc);
-			if (rc > 0)
-				printf("\n\t\t\"");
-			else
-				printf(" ");
-			printf("WHERE %s.%s = ?\",\n",
-				p->name, f->name);
-		}
-
-	/* 
-	 * Print custom search queries.
-	 * This also uses the recursive selection.
-	 */
-
-	pos = 0;
-	TAILQ_FOREACH(s, &p->sq, entries) {
-		printf("\t/* STMT_%s_BY_SEARCH_%zu */\n"
-		       "\t\"SELECT ", p->name, pos++);
-		col = 16;
-		needquot = 0;
-
-		/* 
-		 * Juggle around the possibilities of...
-		 *   select count(*)
-		 *   select count(distinct --gen_stmt_schema-- )
-		 *   select --gen_stmt_schema--
-		 */
+	const char	*cp;
+	size_t		 sz;
 
-		if (s->type == STYPE_COUNT)
-			col += printf("COUNT(");
-		if (s->dst) {
-			col += printf("DISTINCT ");
-			gen_stmt_schema(p, 1, s->dst->strct, 
-				s->dst->fname, &col);
-			needquot = 1;
-		} else if (s->type != STYPE_COUNT) {
-			gen_stmt_schema(p, 1, p, NULL, &col);
-			needquot = 1;
+	if (pt->strct != NULL) {
+		if (*quoted)
+			*col += printf("\"");
+		sz = strlen(pt->strct->name) + strlen(pt->tab) + 12;
+		if (*col + 1 + sz > 72) {
+			printf("\n\t\t");
+			*col = 16;
 		} else
-			printf("*");
-
-		if (needquot)
-			putchar('"');
-		if (s->type == STYPE_COUNT)
-			putchar(')');
-
-		printf(" FROM %s", p->name);
-
-		/* 
-		 * Whether anything is coming after the "FROM" clause,
-		 * which includes all ORDER, WHERE, GROUP, LIMIT, and
-		 * OFFSET commands.
-		 */
-
-		hastrail = 
-			(s->aggr != NULL && s->group != NULL) ||
-			(!TAILQ_EMPTY(&s->sntq)) ||
-			(!TAILQ_EMPTY(&s->ordq)) ||
-			(s->type != STYPE_SEARCH && s->limit > 0) ||
-			(s->type != STYPE_SEARCH && s->offset > 0);
-		
-		rc = 0;
-		gen_stmt_joins(p, p, NULL, &rc);
-
-		/* 
-		 * We need to have a special JOIN command for aggregate
-		 * groupings: we LEFT OUTER JOIN the grouped set to
-		 * itself, conditioning upon the aggregate inequality.
-		 * We'll filter NULL joinings in the WHERE statement.
-		 */
-
-		if (NULL != s->aggr && NULL != s->group) {
-			assert(s->aggr->field->parent == 
-			       s->group->field->parent);
-			printf("\n\t\t\"LEFT OUTER JOIN %s as _custom "
-				"ON %s.%s = _custom.%s "
-				"AND %s.%s %s _custom.%s \"",
-				s->group->field->parent->name, 
-				NULL == s->group->alias ?
-				s->group->field->parent->name : 
-				s->group->alias->alias,
-				s->group->field->name, 
-				s->group->field->name,
-				NULL == s->group->alias ?
-				s->group->field->parent->name : 
-				s->group->alias->alias, 
-				s->aggr->field->name, 
-				AGGR_MAXROW == s->aggr->op ?  "<" : ">",
-				s->aggr->field->name);
-		}
-
-		if ( ! hastrail) {
-			if (0 == rc)
-				putchar('"');
-			puts(",");
-			continue;
-		}
-
-		if (rc > 0)
-			printf("\n\t\t\"");
-		else
-			printf(" \"\n\t\t\"");
-
-		if ( ! TAILQ_EMPTY(&s->sntq) || 
-		    (NULL != s->aggr && NULL != s->group))
-			printf("WHERE");
-
-		first = 1;
-
-		/* 
-		 * If we're grouping, filter out all of the joins that
-		 * failed and aren't part of the results.
-		 */
-
-		if (NULL != s->group) {
-			printf(" _custom.%s IS NULL", 
-				s->group->field->name);
-			first = 0;
-		}
-
-		/* Continue with our proper WHERE clauses. */
-
-		TAILQ_FOREACH(sent, &s->sntq, entries) {
-			if (sent->field->type == FTYPE_PASSWORD &&
-			    sent->op != OPTYPE_STREQ &&
-			    sent->op != OPTYPE_STRNEQ)
-				continue;
-			if (!first)
-				printf(" AND");
-			first = 0;
-			if (OPTYPE_ISUNARY(sent->op))
-				printf(" %s.%s %s",
-					sent->alias == NULL ?
-					p->name : sent->alias->alias,
-					sent->field->name, 
-					optypes[sent->op]);
-			else
-				printf(" %s.%s %s ?", 
-					sent->alias == NULL ?
-					p->name : sent->alias->alias,
-					sent->field->name, 
-					optypes[sent->op]);
-		}
-
-		first = 1;
-		if (!TAILQ_EMPTY(&s->ordq))
-			printf(" ORDER BY ");
-		TAILQ_FOREACH(ord, &s->ordq, entries) {
-			if ( ! first)
-				printf(", ");
-			first = 0;
-			printf("%s.%s %s",
-				NULL == ord->alias ?
-				p->name : ord->alias->alias,
-				ord->field->name, 
-				ORDTYPE_ASC == ord->op ?
-				"ASC" : "DESC");
-		}
-
-		if (STYPE_SEARCH != s->type && s->limit > 0)
-			printf(" LIMIT %" PRId64, s->limit);
-		if (STYPE_SEARCH != s->type && s->offset > 0)
-			printf(" OFFSET %" PRId64, s->offset);
-
-		puts("\",");
+			*col += printf(" ");
+		*col += printf("DB_SCHEMA_%s(%s)",
+			pt->strct->name, pt->tab);
+		*quoted = 0;
+		return;
 	}
 
-	/* Insertion of a new record. */
-
-	if (p->ins != NULL) {
-		printf("\t/* STMT_%s_INSERT */\n", p->name);
-		col = printf("\t\"INSERT INTO %s ", p->name);
-
-		first = 1;
-		TAILQ_FOREACH(f, &p->fq, entries) {
-			if (f->type == FTYPE_STRUCT ||
-			    (f->flags & FIELD_ROWID))
-				continue;
-			if (col >= 72) {
-				printf("%s\"\n\t\t\"%s", 
-					first ? "" : ",",
-					first ? "(" : " ");
-				col = 16;
-			} else
-				putchar(first ? '(' : ',');
-			col += 1 + printf("%s", f->name);
-			first = 0;
+	for (cp = pt->text.data; *cp != '\0'; cp += sz) {
+		sz = 1 + strcspn(cp + 1, " ");
+		if (!*quoted && *col + 2 + sz > 72) {
+			printf("\n\t\t\"");
+			*col = 17;
+		} else if (!*quoted)
+			*col += printf(" \"");
+		else if (*col + sz > 72 && *col > 17) {
+			printf("\"\n\t\t\"");
+			*col = 17;
 		}
-
-		if (first == 0) {
-			if ((col += printf(") ")) >= 72) {
-				printf("\"\n\t\t\"");
-				col = 17;
-			}
-			col += printf("VALUES ");
-			first = 1;
-			TAILQ_FOREACH(f, &p->fq, entries) {
-				if (f->type == FTYPE_STRUCT ||
-				    (f->flags & FIELD_ROWID))
-					continue;
-				if (col >= 72) {
-					printf("%s\"\n\t\t\"%s", 
-						first ? "" : ",",
-						first ? "(" : " ");
-					col = 16;
-				} else
-					putchar(first ? '(' : ',');
-				putchar('?');
-				col += 2;
-				first = 0;
-			}
-			puts(")\",");
-		} else
-			puts("DEFAULT VALUES\",");
+		*quoted = 1;
+		*col += printf("%.*s", (int)sz, cp);
 	}
-	
-	/* 
-	 * Custom update queries. 
-	 * Our updates can have modifications where they modify the
-	 * given field (instead of setting it externally).
-	 */
+}
 
-	pos = 0;
-	TAILQ_FOREACH(up, &p->uq, entries) {
-		printf("\t/* STMT_%s_UPDATE_%zu */\n"
-		       "\t\"UPDATE %s SET",
-		       p->name, pos++, p->name);
-		first = 1;
-		TAILQ_FOREACH(ur, &up->mrq, entries) {
-			putchar(first ? ' ' : ',');
-			first = 0;
-			switch (ur->mod) {
-			case MODTYPE_INC:
-				printf("%s = %s + ?", 
-					ur->field->name, 
-					ur->field->name);
-				break;
-			case MODTYPE_DEC:
-				printf("%s = %s - ?", 
-					ur->field->name, 
-					ur->field->name);
-				break;
-			case MODTYPE_CONCAT:
-				printf("%s = ", ur->field->name);
-
-				/*
-				 * If we concatenate a NULL with a
-				 * non-NULL, we'll always get a NULL
-				 * value, which isn't what we want.
-				 * This will wrap possibly-null values
-				 * so that they're always strings.
-				 */
-
-				if ((ur->field->flags & FIELD_NULL))
-					printf("COALESCE(%s,'')",
-						ur->field->name);
-				else
-					printf("%s", ur->field->name);
-				printf(" || ?");
-				break;
-			default:
-				printf("%s = ?", ur->field->name);
-				break;
-			}
-		}
-		first = 1;
-		TAILQ_FOREACH(ur, &up->crq, entries) {
-			printf(" %s ", first ? "WHERE" : "AND");
-			if (OPTYPE_ISUNARY(ur->op))
-				printf("%s %s", ur->field->name, 
-					optypes[ur->op]);
-			else
-				printf("%s %s ?", ur->field->name,
-					optypes[ur->op]);
-			first = 0;
-		}
-		puts("\",");
+/*
+ * Fill in the statements noted in gen_enum().
+ * This function is an important one because we're going to create the
+ * raw SQL that's passed into sqlbox.
+ */
+static void
+gen_stmt(const struct strct *p, int selfjoin)
+{
+	struct sqlstmtq	 q;
+	size_t		 i, j, col;
+	int		 quoted;
+
+	stmt_gen(p, selfjoin, &q);
+	for (i = 0; i < q.stmtsz; i++) {
+		printf("\t/* %s */\n\t\"", q.stmt[i].name);
+		col = 9;
+		quoted = 1;
+		for (j = 0; j < q.stmt[i].partsz; j++)
+			gen_stmt_part(&q.stmt[i].parts[j],
+				&col, &quoted);
+		puts(quoted ? "\"," : ",");
 	}
+	stmt_free(&q);
+}
 
-	/* Custom delete queries. */
+/*
+ * Generate the pragma statements of "db" in the same order as
+ * gen_enum_database().
+ */
+static void
+gen_stmt_database(const struct database *db)
+{
 
-	pos = 0;
-	TAILQ_FOREACH(up, &p->dq, entries) {
-		printf("\t/* STMT_%s_DELETE_%zu */\n"
-		       "\t\"DELETE FROM %s",
-		       p->name, pos++, p->name);
-		first = 1;
-		TAILQ_FOREACH(ur, &up->crq, entries) {
-			printf(" %s ", first ? "WHERE" : "AND");
-			if (OPTYPE_ISUNARY(ur->op))
-				printf("%s %s", ur->field->name, 
-					optypes[ur->op]);
-			else
-				printf("%s %s ?", ur->field->name,
-					optypes[ur->op]);
-			first = 0;
-		}
-		puts("\",");
-	}
+	if (db->journal != JOURNAL_UNSET)
+		printf("\t/* STMT__PRAGMA_JOURNAL */\n"
+		       "\t\"PRAGMA journal_mode = %s\",\n",
+		       journals[db->journal]);
+	if (db->sync != SYNCMODE_UNSET)
+		printf("\t/* STMT__PRAGMA_SYNC */\n"
+		       "\t\"PRAGMA synchronous = %s\",\n",
+		       syncmodes[db->sync]);
+	if (db->temp != TEMPSTORE_UNSET)
+		printf("\t/* STMT__PRAGMA_TEMP */\n"
+		       "\t\"PRAGMA temp_store = %s\",\n",
+		       tempstores[db->temp]);
+	if (db->flags & DATABASE_MMAP)
+		printf("\t/* STMT__PRAGMA_MMAP */\n"
+		       "\t\"PRAGMA mmap_size = %" PRId64 "\",\n",
+		       db->mmap);
+	if (db->flags & DATABASE_CACHE)
+		printf("\t/* STMT__PRAGMA_CACHE */\n"
+		       "\t\"PRAGMA cache_size = %" PRId64 "\",\n",
+		       db->cache);
 }
 
 /*
@@ -2923,8 +5059,9 @@ gen_define_schema(const struct strct *p)
  */
 static int
 gen_c_source(const struct config *cfg, int json, int jsonparse,
-	int valids, int dbin, const char *header, 
-	const char *incls, const int *exs)
+	int valids, int dbin, int arena, int pool, int stats,
+	int selfjoin, const char *header, const char *incls,
+	const int *exs)
 {
 	const struct strct *p;
 	const char	*start;
@@ -3001,6 +5138,9 @@ gen_c_source(const struct config *cfg, int json, int jsonparse,
 	if (need_kcgi)
 		puts("#include <stdarg.h>");
 
+	if (dbin && pool)
+		puts("#include <pthread.h>");
+
 	puts("#include <stdio.h>\n"
 	     "#include <stdint.h> /* int64_t */\n"
 	     "#include <stdlib.h>\n"
@@ -3052,24 +5192,66 @@ gen_c_source(const struct config *cfg, int json, int jsonparse,
 			"define in \"stmts\".");
 		puts("enum\tstmt {");
 		TAILQ_FOREACH(p, &cfg->sq, entries)
-			gen_enum(p);
+			gen_enum(p, 0);
+		if (cfg->db != NULL)
+			gen_enum_database(cfg->db, 0);
 		puts("\tSTMT__MAX\n"
 		     "};\n"
 		     "");
 
 		print_commentt(0, COMMENT_C,
-			"Definition of our opaque \"ort\", "
-			"which contains role information.");
-		puts("struct\tort {");
+			"A statement cached by db_stmt_bind().");
+		puts("struct\tort_stmt {");
 		print_commentt(1, COMMENT_C,
-			"Hidden database connection");
-		puts("\tstruct sqlbox *db;");
+			"Statement identifier or zero if unprepared.");
+		puts("\tsize_t id;");
+		print_commentt(1, COMMENT_C,
+			"Source the statement was prepared on.");
+		puts("\tsize_t src;");
+		print_commentt(1, COMMENT_C,
+			"Non-zero if between bind and done.");
+		puts("\tint busy;");
+		print_commentt(1, COMMENT_C,
+			"Non-zero if stepped until done since bound.");
+		puts("\tint done;\n"
+		     "};\n");
 
-		if (!TAILQ_EMPTY(&cfg->rq)) {
+		if (stats) {
+			print_commentt(0, COMMENT_C,
+				"A statement between db_stmt_bind() "
+				"and db_stmt_done().");
+			puts("struct\tort_run {");
 			print_commentt(1, COMMENT_C,
-				"Current RBAC role.");
-			puts("\tenum ort_role role;\n"
+				"Statement identifier.");
+			puts("\tsize_t id;");
+			print_commentt(1, COMMENT_C,
+				"Statement enumeration.");
+			puts("\tenum stmt stmt;");
+			print_commentt(1, COMMENT_C,
+				"Nanoseconds spent binding and stepping.");
+			puts("\tuint64_t nsec;");
+			print_commentt(1, COMMENT_C,
+				"Rows stepped so far.");
+			puts("\tuint64_t rows;\n"
+			     "};\n");
+		}
+
+		if (config_passcache(cfg)) {
+			print_commentt(0, COMMENT_C,
+				"The last password check of a "
+				"list or iterate search.");
+			puts("struct\tort_passcache {");
+			print_commentt(1, COMMENT_C,
+				"Copy of the last stored hash or "
+				"NULL if none.");
+			puts("\tchar *hash;");
+			print_commentt(1, COMMENT_C,
+				"Non-zero if it matched.");
+			puts("\tint match;\n"
 			     "};\n");
+		}
+
+		if (!TAILQ_EMPTY(&cfg->rq)) {
 			print_commentt(0, COMMENT_C,
 				"A saved role state attached to "
 				"generated objects.\n"
@@ -3080,11 +5262,106 @@ gen_c_source(const struct config *cfg, int json, int jsonparse,
 			puts("struct\tort_store {");
 			print_commentt(1, COMMENT_C,
 				"Role at the time of acquisition.");
+			puts("\tenum ort_role role;\n"
+			     "};\n");
+		}
+
+		print_commentt(0, COMMENT_C,
+			"Definition of our opaque \"ort\", "
+			"which contains role information.");
+		puts("struct\tort {");
+		print_commentt(1, COMMENT_C,
+			"Hidden database connection");
+		puts("\tstruct sqlbox *db;");
+		print_commentt(1, COMMENT_C,
+			"Prepared statements by enum stmt.");
+		puts("\tstruct ort_stmt stmts[STMT__MAX];");
+		print_commentt(1, COMMENT_C,
+			"Statements re-used from and prepared "
+			"into the cache.");
+		puts("\tuint64_t stmt_hits;\n"
+		     "\tuint64_t stmt_misses;");
+		print_commentt(1, COMMENT_C,
+			"Read-only source or zero if none.");
+		puts("\tsize_t rosrc;");
+		print_commentt(1, COMMENT_C,
+			"Open transactions, during which reads "
+			"use the read-write source to see their "
+			"writes.");
+		puts("\tsize_t trans;");
+		if (arena) {
+			print_commentt(1, COMMENT_C,
+				"Newest block of the result arena.");
+			puts("\tstruct ort_arena *arena;");
+		}
+		if (stats) {
+			print_commentt(1, COMMENT_C,
+				"Statistics by enum stmt.");
+			puts("\tstruct ort_stmt_stats stats[STMT__MAX];");
+			print_commentt(1, COMMENT_C,
+				"Statements between bind and done, "
+				"newest last.");
+			puts("\tstruct ort_run *runs;\n"
+			     "\tsize_t runsz;\n"
+			     "\tsize_t runmax;");
+			print_commentt(1, COMMENT_C,
+				"Slow-query callback, its threshold "
+				"in microseconds, and its argument.");
+			puts("\tvoid (*slow)(const char *, uint64_t, void *);\n"
+			     "\tuint64_t slow_usec;\n"
+			     "\tvoid *slow_arg;");
+		}
+
+		if (cfg_has_iterate(cfg)) {
+			print_commentt(1, COMMENT_C,
+				"Values converted for rows of "
+				"borrowed iterate callbacks, freed "
+				"as each row is released.");
+			puts("\tvoid **borrow;\n"
+			     "\tsize_t borrowsz;\n"
+			     "\tsize_t borrowmax;");
+		}
+
+		if (!TAILQ_EMPTY(&cfg->rq)) {
+			print_commentt(1, COMMENT_C,
+				"Current RBAC role.");
 			puts("\tenum ort_role role;");
+			print_commentt(1, COMMENT_C,
+				"Role store shared by rows passed to "
+				"borrowed iterate callbacks.");
+			puts("\tstruct ort_store store;");
 		}
 
 		puts("};\n");
 
+		if (arena) {
+			print_commentt(0, COMMENT_C,
+				"A block of the result arena.\n"
+				"Blocks are chained newest-first and "
+				"their data immediately follows this "
+				"header, padded to ORT_ARENA_ALIGN.\n"
+				"Positions in the arena are the total "
+				"bytes used in all blocks.");
+			puts("struct\tort_arena {");
+			print_commentt(1, COMMENT_C,
+				"Next-oldest block or NULL.");
+			puts("\tstruct ort_arena *prev;");
+			print_commentt(1, COMMENT_C,
+				"Position at the start of the block.");
+			puts("\tsize_t base;");
+			print_commentt(1, COMMENT_C,
+				"Bytes used in this block.");
+			puts("\tsize_t len;");
+			print_commentt(1, COMMENT_C,
+				"Bytes available in this block.");
+			puts("\tsize_t cap;\n"
+			     "};\n"
+			     "\n"
+			     "#define ORT_ARENA_ALIGN(_sz) \\\n"
+			     "\t(((_sz) + 15) & ~(size_t)15)\n"
+			     "#define ORT_ARENA_BLKSZ (64 * 1024)\n");
+		}
+
 		print_commentt(0, COMMENT_C, 
 			"Table columns.\n"
 			"The macro accepts a table name because "
@@ -3105,9 +5382,27 @@ gen_c_source(const struct config *cfg, int json, int jsonparse,
 			"ambiguity.");
 		puts("static\tconst char *const stmts[STMT__MAX] = {");
 		TAILQ_FOREACH(p, &cfg->sq, entries)
-			gen_stmt(p);
+			gen_stmt(p, selfjoin);
+		if (cfg->db != NULL)
+			gen_stmt_database(cfg->db);
 		puts("};");
 		puts("");
+
+		if (stats) {
+			print_commentt(0, COMMENT_C,
+				"Names of our SQL statements for "
+				"db_stats_get().");
+			puts("static\tconst char *const "
+			      "stmt_names[STMT__MAX] = {");
+			TAILQ_FOREACH(p, &cfg->sq, entries)
+				gen_enum(p, 1);
+			if (cfg->db != NULL)
+				gen_enum_database(cfg->db, 1);
+			puts("};\n");
+		}
+
+		if (!TAILQ_EMPTY(&cfg->rq) && !gen_role_table(cfg))
+			return 0;
 	}
 
 	/*
@@ -3134,15 +5429,25 @@ gen_c_source(const struct config *cfg, int json, int jsonparse,
 
 	if (dbin) {
 		gen_func_trans(cfg);
-		if (!gen_func_open(cfg))
-			return 0;
-		gen_func_close(cfg);
+		if (stats)
+			gen_func_stats();
+		gen_func_stmt(cfg, stats);
+		gen_func_checkpass(cfg);
+		gen_func_in(cfg);
+		gen_func_open(cfg);
+		gen_func_borrow(cfg);
+		gen_func_close(cfg, arena, stats);
+		if (arena)
+			gen_func_arena(cfg);
+		if (pool)
+			gen_func_pool(cfg, arena);
 		if (!TAILQ_EMPTY(&cfg->rq))
 			gen_func_role_transitions(cfg);
 	}
 
 	TAILQ_FOREACH(p, &cfg->sq, entries)
-		gen_funcs(cfg, p, json, jsonparse, valids, dbin);
+		gen_funcs(cfg, p, json, jsonparse, valids, dbin, 
+			arena, stats);
 
 	return 1;
 }
@@ -3154,7 +5459,8 @@ main(int argc, char *argv[])
 	     		 *sharedir = SHAREDIR;
 	struct config	 *cfg = NULL;
 	int		  c, json = 0, jsonparse = 0, valids = 0,
-			  dbin = 1, rc = 0;
+			  dbin = 1, arena = 0, pool = 0, stats = 0,
+			  selfjoin = 0, rc = 0;
 	FILE		**confs = NULL;
 	size_t		  i, confsz;
 	int		  exs[EX__MAX], sz;
@@ -3165,8 +5471,14 @@ main(int argc, char *argv[])
 		err(EXIT_FAILURE, "pledge");
 #endif
 
-	while ((c = getopt(argc, argv, "h:I:jJN:sS:v")) != -1)
+	while ((c = getopt(argc, argv, "AGh:I:jJN:PsS:Tv")) != -1)
 		switch (c) {
+		case 'A':
+			arena = 1;
+			break;
+		case 'G':
+			selfjoin = 1;
+			break;
 		case 'h':
 			header = optarg;
 			break;
@@ -3183,12 +5495,18 @@ main(int argc, char *argv[])
 			if (strchr(optarg, 'd') != NULL)
 				dbin = 0;
 			break;
+		case 'P':
+			pool = 1;
+			break;
 		case 's':
 			/* Ignore. */
 			break;
 		case 'S':
 			sharedir = optarg;
 			break;
+		case 'T':
+			stats = 1;
+			break;
 		case 'v':
 			valids = 1;
 			break;
@@ -3242,8 +5560,8 @@ main(int argc, char *argv[])
 		goto out;
 
 	if ((rc = ort_parse_close(cfg)))
-		rc = gen_c_source(cfg, json, jsonparse, 
-			valids, dbin, header, incls, exs);
+		rc = gen_c_source(cfg, json, jsonparse, valids, 
+			dbin, arena, pool, stats, selfjoin, header, incls, exs);
 
 out:
 	for (i = 0; i < EX__MAX; i++)
@@ -3258,7 +5576,7 @@ out:
 usage:
 	fprintf(stderr, 
 		"usage: %s "
-		"[-jJsv] "
+		"[-AGjJPsTv] "
 		"[-h header[,header...] "
 		"[-I bjJv] "
 		"[-N b] "
@@ -0,0 +1,326 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 Kristaps Dzonsons <kristaps@bsd.lv>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "config.h"
+
+#if HAVE_SYS_QUEUE
+# include <sys/queue.h>
+#endif
+
+#if HAVE_ERR
+# include <err.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sqlite3.h>
+
+#include "ort.h"
+#include "sqlidx.h"
+#include "sqlstmt.h"
+
+/*
+ * The in-memory database and what's been reported on it.
+ */
+struct	explain {
+	sqlite3	*db;
+	size_t	 found; /* number of reports */
+	int	 selfjoin; /* self-join aggregate groupings */
+};
+
+/*
+ * Create the tables and indexes of ort-sql(1) without its comments.
+ * Returns zero on failure (reported), non-zero on success.
+ */
+static int
+explain_schema(sqlite3 *db, const struct config *cfg)
+{
+	const struct strct	*p;
+	struct sqlidxq		 iq;
+	struct sqlbuf		 b;
+	size_t			 i;
+	char			*er = NULL;
+
+	memset(&b, 0, sizeof(struct sqlbuf));
+	idx_gen(&cfg->sq, &iq);
+
+	TAILQ_FOREACH(p, &cfg->sq, entries) {
+		ddl_table(&b, p);
+		buf_appendv(&b, ";\n");
+	}
+
+	for (i = 0; i < iq.idxsz; i++) {
+		if (iq.idx[i].covered)
+			continue;
+		ddl_index(&b, &iq.idx[i]);
+		buf_appendv(&b, ";\n");
+	}
+
+	idx_free(&iq);
+
+	if (sqlite3_exec(db, b.data, NULL, NULL, &er) != SQLITE_OK) {
+		warnx("schema: %s", er);
+		sqlite3_free(er);
+		free(b.data);
+		return 0;
+	}
+
+	free(b.data);
+	return 1;
+}
+
+/*
+ * Report "msg" for statement "name" at parse point "pos".
+ */
+static void
+explain_report(struct explain *ex, const struct pos *pos,
+	const char *name, const char *msg)
+{
+
+	printf("%s:%zu:%zu: %s: %s\n", pos->fname,
+		pos->line, pos->column, name, msg);
+	ex->found++;
+}
+
+/*
+ * Allocate the table name "cp" of "sz" bytes from a query plan of a
+ * statement on "p", adding the field path for joined aliases.
+ */
+static char *
+explain_table(const struct strct *p, const char *cp, size_t sz)
+{
+	const struct alias	*a;
+	char			*name;
+	int			 c;
+
+	TAILQ_FOREACH(a, &p->aq, entries)
+		if (strlen(a->alias) == sz &&
+		    strncmp(a->alias, cp, sz) == 0)
+			break;
+
+	c = a == NULL ?
+		asprintf(&name, "%.*s", (int)sz, cp) :
+		asprintf(&name, "%s (%s)", a->alias, a->name);
+	if (c == -1)
+		err(EXIT_FAILURE, NULL);
+	return name;
+}
+
+/*
+ * Run EXPLAIN QUERY PLAN on the statement "b" named "name" and report
+ * each full table scan, temporary b-tree, and automatic index.
+ * Full scans of the statement's own table "p" are only reported if
+ * "constrained", as otherwise the statement reads the whole table.
+ */
+static void
+explain_stmt(struct explain *ex, const struct strct *p,
+	const struct pos *pos, const char *name, const struct sqlbuf *b,
+	int constrained)
+{
+	sqlite3_stmt	*stmt;
+	const char	*detail, *cp;
+	char		*q, *msg, *tab;
+	size_t		 sz;
+	int		 rc;
+
+	if (asprintf(&q, "EXPLAIN QUERY PLAN %s", b->data) == -1)
+		err(EXIT_FAILURE, NULL);
+
+	if (sqlite3_prepare_v2(ex->db, q, -1, &stmt, NULL) !=
+	    SQLITE_OK) {
+		if (asprintf(&msg, "cannot prepare: %s",
+		    sqlite3_errmsg(ex->db)) == -1)
+			err(EXIT_FAILURE, NULL);
+		explain_report(ex, pos, name, msg);
+		free(msg);
+		free(q);
+		return;
+	}
+
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+		detail = (const char *)sqlite3_column_text(stmt, 3);
+		if (detail == NULL)
+			continue;
+		msg = NULL;
+
+		/*
+		 * Older sqlite3 says "SCAN TABLE foo".
+		 * Virtual tables are those of json_each() reading the
+		 * bound arrays of set membership.
+		 */
+
+		if (strncmp(detail, "SCAN ", 5) == 0 &&
+		    strncmp(detail, "SCAN CONSTANT ", 14) != 0 &&
+		    strstr(detail, " VIRTUAL TABLE") == NULL) {
+			cp = detail + 5;
+			if (strncmp(cp, "TABLE ", 6) == 0)
+				cp += 6;
+			sz = strcspn(cp, " ");
+			if (!constrained && sz == strlen(p->name) &&
+			    strncmp(cp, p->name, sz) == 0)
+				continue;
+			tab = explain_table(p, cp, sz);
+			if (asprintf(&msg, "full table scan of %s",
+			    tab) == -1)
+				err(EXIT_FAILURE, NULL);
+			free(tab);
+		} else if ((cp = strstr(detail, "TEMP B-TREE")) != NULL) {
+			cp += 11;
+			if (strncmp(cp, " FOR ", 5) == 0)
+				cp += 5;
+			if (asprintf(&msg, "temporary b-tree%s%s",
+			    *cp == '\0' ? "" : " for ", cp) == -1)
+				err(EXIT_FAILURE, NULL);
+		} else if (strstr(detail, "AUTOMATIC") != NULL) {
+			if ((cp = strchr(detail, ' ')) == NULL)
+				cp = detail;
+			else
+				cp++;
+			if (strncmp(cp, "TABLE ", 6) == 0)
+				cp += 6;
+			tab = explain_table(p, cp, strcspn(cp, " "));
+			if (asprintf(&msg, "automatic index on %s",
+			    tab) == -1)
+				err(EXIT_FAILURE, NULL);
+			free(tab);
+		}
+
+		if (msg != NULL) {
+			explain_report(ex, pos, name, msg);
+			free(msg);
+		}
+	}
+
+	if (rc != SQLITE_DONE)
+		warnx("%s: %s", name, sqlite3_errmsg(ex->db));
+	sqlite3_finalize(stmt);
+	free(q);
+}
+
+/*
+ * Explain all statements of structure "p" that ort-c-source(1) would
+ * generate, in the same order.
+ */
+static void
+explain_strct(struct explain *ex, const struct strct *p)
+{
+	struct sqlstmtq		 q;
+	struct sqlbuf		 b;
+	size_t			 i;
+
+	memset(&b, 0, sizeof(struct sqlbuf));
+	stmt_gen(p, ex->selfjoin, &q);
+
+	for (i = 0; i < q.stmtsz; i++) {
+		buf_reset(&b);
+		stmt_sql(&b, &q.stmt[i]);
+		explain_stmt(ex, p, q.stmt[i].pos, q.stmt[i].name,
+			&b, q.stmt[i].constrained);
+	}
+
+	stmt_free(&q);
+	buf_free(&b);
+}
+
+int
+main(int argc, char *argv[])
+{
+	FILE		**confs = NULL;
+	struct config	 *cfg = NULL;
+	struct explain	  ex;
+	const struct strct *p;
+	int		  rc = 0, c, strict = 0, selfjoin = 0;
+	size_t		  confsz, i;
+
+#if HAVE_PLEDGE
+	if (pledge("stdio rpath", NULL) == -1)
+		err(EXIT_FAILURE, "pledge");
+#endif
+
+	while ((c = getopt(argc, argv, "Gs")) != -1)
+		switch (c) {
+		case 'G':
+			selfjoin = 1;
+			break;
+		case 's':
+			strict = 1;
+			break;
+		default:
+			goto usage;
+		}
+
+	argc -= optind;
+	argv += optind;
+
+	confsz = (size_t)argc;
+	if (confsz > 0 &&
+	    (confs = calloc(confsz, sizeof(FILE *))) == NULL)
+		err(EXIT_FAILURE, "calloc");
+
+	for (i = 0; i < confsz; i++)
+		if ((confs[i] = fopen(argv[i], "r")) == NULL)
+			err(EXIT_FAILURE, "%s", argv[i]);
+
+#if HAVE_PLEDGE
+	if (pledge("stdio", NULL) == -1)
+		err(EXIT_FAILURE, "pledge");
+#endif
+
+	memset(&ex, 0, sizeof(struct explain));
+	ex.selfjoin = selfjoin;
+
+	if ((cfg = ort_config_alloc()) == NULL)
+		goto out;
+
+	for (i = 0; i < confsz; i++)
+		if (!ort_parse_file_r(cfg, confs[i], argv[i]))
+			goto out;
+
+	if (confsz == 0 && !ort_parse_file_r(cfg, stdin, "<stdin>"))
+		goto out;
+
+	if (!ort_parse_close(cfg))
+		goto out;
+
+	/* The database is in-memory, so this touches no files. */
+
+	if (sqlite3_open(":memory:", &ex.db) != SQLITE_OK) {
+		warnx("sqlite3_open: %s", ex.db == NULL ?
+			"out of memory" : sqlite3_errmsg(ex.db));
+		goto out;
+	}
+	if (!explain_schema(ex.db, cfg))
+		goto out;
+
+	TAILQ_FOREACH(p, &cfg->sq, entries)
+		explain_strct(&ex, p);
+
+	rc = !strict || ex.found == 0;
+out:
+	sqlite3_close(ex.db);
+	for (i = 0; i < confsz; i++)
+		if (fclose(confs[i]) == EOF)
+			warn("%s", argv[i]);
+	free(confs);
+	ort_config_free(cfg);
+	return rc ? EXIT_SUCCESS : EXIT_FAILURE;
+usage:
+	fprintf(stderr, "usage: %s [-Gs] [config...]\n",
+		getprogname());
+	return EXIT_FAILURE;
+}
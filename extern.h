@@ -28,13 +28,16 @@ enum	resolvet {
 	RESOLVE_AGGR,
 	RESOLVE_DISTINCT,
 	RESOLVE_GROUPROW,
+	RESOLVE_INDEX,
 	RESOLVE_ORDER,
+	RESOLVE_PROJ,
 	RESOLVE_ROLE,
 	RESOLVE_ROLEMAP,
 	RESOLVE_SENT,
 	RESOLVE_UNIQUE,
 	RESOLVE_UP_CONSTRAINT,
-	RESOLVE_UP_MODIFIER
+	RESOLVE_UP_MODIFIER,
+	RESOLVE_UPSERT
 };
 
 /*
@@ -91,6 +94,10 @@ struct	resolve {
 				char		**names;
 				size_t		  namesz;
 		} struct_order; /* ...order ->bar<- */
+		struct struct_proj {
+				struct proj	*result;
+				char		*name;
+		} struct_proj; /* ...fields ->bar<- */
 		struct struct_role {
 				struct rref	*result;
 				char		*name;
@@ -109,6 +116,14 @@ struct	resolve {
 				struct nref	*result;
 				char		*name;
 		} struct_unique; /* unique ->bar<-... */
+		struct struct_index {
+				struct iref	*result;
+				char		*name;
+		} struct_index; /* index ->bar<-... */
+		struct struct_upsert {
+				struct cref	*result;
+				char		*name;
+		} struct_upsert; /* upsert ->bar<-... */
 		struct field_def_eitem {
 				struct field	*result;
 				char		*name;
@@ -16,23 +16,108 @@
  */
 
 /*
- * Use standard (but unsafe) Linux tools for salting.
- * Not secure.
+ * Reentrant password hashing and checking for systems without
+ * crypt_newhash(3) and crypt_checkpass(3), with the same semantics.
+ * Salts are drawn from getrandom(2) on Linux and arc4random_buf(3)
+ * elsewhere.
+ * Systems with crypt_r(3) use it with per-call state; others fall back
+ * to crypt(3), which is not thread-safe.
  */
 
-static const char *
-_gensalt(void)
+#if defined(__linux__) || defined(__FreeBSD__)
+# define ORT_CRYPT_R 1
+#endif
+#if defined(__linux__)
+# include <crypt.h>
+# include <sys/random.h>
+#endif
+
+/*
+ * Fill "salt", which must be 12 bytes, with a random MD5 salt.
+ * Exits on failure to get random data.
+ */
+static void
+_gensalt(char *salt)
 {
 	size_t		  i;
-	static char 	  salt[] = "$1$........";
+	unsigned char	  buf[8];
 	const char *const seedchars =
 		"./0123456789ABCDEFGHIJKLMNOPQRST"
 		"UVWXYZabcdefghijklmnopqrstuvwxyz";
 
+#if defined(__linux__)
+	if (getrandom(buf, sizeof(buf), 0) != (ssize_t)sizeof(buf)) {
+		perror(NULL);
+		exit(EXIT_FAILURE);
+	}
+#else
+	arc4random_buf(buf, sizeof(buf));
+#endif
+
 	/* According to crypt(3), salt is at most 8 bytes. */
 
-	for (i = 0; i < 8; i++)
-		salt[i + 3] = seedchars[random() % 64];
+	memcpy(salt, "$1$", 3);
+	for (i = 0; i < sizeof(buf); i++)
+		salt[i + 3] = seedchars[buf[i] % 64];
+	salt[i + 3] = '\0';
+}
+
+/*
+ * Hash "pass" with "salt" into "hash" of size "sz".
+ * Returns zero on success, -1 on failure.
+ */
+static int
+_crypt(const char *pass, const char *salt, char *hash, size_t sz)
+{
+	const char		*cp;
+#if ORT_CRYPT_R
+	struct crypt_data	*data;
+
+	if ((data = calloc(1, sizeof(struct crypt_data))) == NULL) {
+		perror(NULL);
+		exit(EXIT_FAILURE);
+	}
+	cp = crypt_r(pass, salt, data);
+#else
+	cp = crypt(pass, salt);
+#endif
+	if (cp != NULL && strlen(cp) < sz)
+		memcpy(hash, cp, strlen(cp) + 1);
+	else
+		cp = NULL;
+#if ORT_CRYPT_R
+	free(data);
+#endif
+	return cp == NULL ? -1 : 0;
+}
+
+/*
+ * Like crypt_newhash(3): hash "pass" with a new salt into "hash" of
+ * size "sz".
+ * Exits on failure.
+ */
+static void
+_crypt_newhash(const char *pass, char *hash, size_t sz)
+{
+	char	 salt[12];
+
+	_gensalt(salt);
+	if (_crypt(pass, salt, hash, sz) == -1) {
+		perror(NULL);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Like crypt_checkpass(3): returns zero if "pass" matches "hash", -1
+ * otherwise.
+ */
+static int
+_crypt_checkpass(const char *pass, const char *hash)
+{
+	char	 buf[128];
 
-	return salt;
+	if (_crypt(pass, hash, buf, sizeof(buf)) == -1)
+		return -1;
+	return strcmp(buf, hash) == 0 ? 0 : -1;
 }
@@ -216,6 +216,160 @@ resolve_aliases(struct config *cfg, struct strct *orig,
 	return 1;
 }
 
+/*
+ * See whether the dot-form path of structure fields "name" from "p"
+ * passes through a null foreign key, which is a LEFT OUTER JOIN and so
+ * may make everything beneath it null.
+ * The path must already have been resolved.
+ */
+static int
+check_path_null(const struct strct *p, const char *name)
+{
+	const struct field	*f;
+	const char		*cp;
+	size_t			 sz;
+
+	while (*name != '\0') {
+		if ((cp = strchr(name, '.')) == NULL)
+			cp = name + strlen(name);
+		sz = cp - name;
+		TAILQ_FOREACH(f, &p->fq, entries)
+			if (f->type == FTYPE_STRUCT &&
+			    strncasecmp(f->name, name, sz) == 0 &&
+			    f->name[sz] == '\0')
+				break;
+		assert(f != NULL);
+		if (f->ref->source->flags & FIELD_NULL)
+			return 1;
+		p = f->ref->target->parent;
+		name = *cp == '.' ? cp + 1 : cp;
+	}
+	return 0;
+}
+
+/*
+ * Keyset pagination seeks past the last row's ordering value and rowid,
+ * so it needs a rowid, at most one ordering term, and that term must be
+ * comparable and never null.
+ * Limits, offsets, grouping, distinct rows, and password checks (which
+ * discard rows after the limit) conflict with the seek.
+ * Return zero on failure, non-zero on success.
+ */
+static int
+check_paginate(struct config *cfg, const struct search *srch)
+{
+	const struct ord	*ord;
+	const struct sent	*sent;
+
+	if (srch->parent->rowid == NULL) {
+		gen_errx(cfg, &srch->pos, 
+			"paginate requires a rowid field");
+		return 0;
+	}
+	if (srch->limit || srch->offset || (srch->flags & 
+	    (SEARCH_LIMIT_BOUND | SEARCH_OFFSET_BOUND))) {
+		gen_errx(cfg, &srch->pos, 
+			"paginate with limit or offset");
+		return 0;
+	}
+	if (srch->group != NULL || srch->dst != NULL) {
+		gen_errx(cfg, &srch->pos, 
+			"paginate with grouprow or distinct");
+		return 0;
+	}
+	TAILQ_FOREACH(sent, &srch->sntq, entries)
+		if (sent->field->type == FTYPE_PASSWORD &&
+		    OPTYPE_ISBINARY(sent->op) &&
+		    sent->op != OPTYPE_STREQ &&
+		    sent->op != OPTYPE_STRNEQ) {
+			gen_errx(cfg, &sent->pos, 
+				"paginate with password check");
+			return 0;
+		}
+	if ((ord = TAILQ_FIRST(&srch->ordq)) == NULL)
+		return 1;
+	if (TAILQ_NEXT(ord, entries) != NULL) {
+		gen_errx(cfg, &ord->pos, 
+			"paginate with multiple order terms");
+		return 0;
+	}
+	if ((ord->field->flags & FIELD_NULL) || (ord->name != NULL &&
+	    check_path_null(srch->parent, ord->name))) {
+		gen_errx(cfg, &ord->pos, 
+			"paginate order on null field");
+		return 0;
+	}
+	if (ord->field->type == FTYPE_BLOB ||
+	    ord->field->type == FTYPE_PASSWORD) {
+		gen_errx(cfg, &ord->pos, 
+			"paginate order on blob or password");
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Return whether the field "f" is selected by the projection of "srch",
+ * which is true of all fields if it has no projection.
+ */
+static int
+check_proj_has(const struct search *srch, const struct field *f)
+{
+	const struct proj	*pr;
+
+	if (TAILQ_EMPTY(&srch->projq))
+		return 1;
+	TAILQ_FOREACH(pr, &srch->projq, entries)
+		if (pr->field == f)
+			return 1;
+	return 0;
+}
+
+/*
+ * A projection only fills some fields of the search's structure, so it
+ * can't be used with distinct queries (which return other structures).
+ * Password hashes that are checked after the query, and the ordering
+ * and rowid values that keyset pagination needs from the last row,
+ * must be in the projection.
+ * Return zero on failure, non-zero on success.
+ */
+static int
+check_proj(struct config *cfg, const struct search *srch)
+{
+	const struct sent	*sent;
+	const struct ord	*ord;
+
+	if (srch->dst != NULL) {
+		gen_errx(cfg, &srch->pos, 
+			"fields with distinct");
+		return 0;
+	}
+	TAILQ_FOREACH(sent, &srch->sntq, entries)
+		if (sent->field->type == FTYPE_PASSWORD &&
+		    OPTYPE_ISBINARY(sent->op) &&
+		    sent->op != OPTYPE_STREQ &&
+		    sent->op != OPTYPE_STRNEQ &&
+		    !check_proj_has(srch, sent->field)) {
+			gen_errx(cfg, &sent->pos, 
+				"checked password not in fields");
+			return 0;
+		}
+	if (!(srch->flags & SEARCH_PAGINATE))
+		return 1;
+	if (!check_proj_has(srch, srch->parent->rowid)) {
+		gen_errx(cfg, &srch->pos, 
+			"paginate rowid not in fields");
+		return 0;
+	}
+	ord = TAILQ_FIRST(&srch->ordq);
+	if (ord != NULL && !check_proj_has(srch, ord->field)) {
+		gen_errx(cfg, &ord->pos, 
+			"paginate order not in fields");
+		return 0;
+	}
+	return 1;
+}
+
 /*
  * Check to see that our search type (e.g., list or iterate) is
  * consistent with the fields that we're searching for.
@@ -296,8 +450,24 @@ check_searchtype(struct config *cfg, struct strct *p)
 					"textual field.");
 				return 0;
 			}
+
+			/* Arrays are bound as JSON, without blobs. */
+
+			if (sent->op == OPTYPE_IN &&
+			    sent->field->type == FTYPE_BLOB) {
+				gen_errx(cfg, &sent->pos, 
+					"IN operator on blob field");
+				return 0;
+			}
 		}
 
+		if ((srch->flags & SEARCH_PAGINATE) &&
+		    !check_paginate(cfg, srch))
+			return 0;
+		if (!TAILQ_EMPTY(&srch->projq) &&
+		    !check_proj(cfg, srch))
+			return 0;
+
 		if (srch->dst == NULL)
 			continue;
 
@@ -600,6 +770,96 @@ check_unique_unique(struct config *cfg, const struct strct *s)
 	return errs == 0;
 }
 
+/*
+ * Make sure that the conflict target of the upsert statement of "s", if
+ * any, is unique: either a single rowid or unique field or the fields
+ * of a unique statement in any order.
+ * The rowid is only permitted alone, as it's otherwise not inserted.
+ * Returns zero on failure, non-zero on success.
+ */
+static int
+check_upsert_unique(struct config *cfg, struct strct *s)
+{
+	const struct unique	*u;
+	const struct nref	*nf;
+	const struct cref	*cf;
+	size_t			 sz = 0, usz;
+
+	if (s->ups == NULL)
+		return 1;
+
+	TAILQ_FOREACH(cf, &s->ups->cq, entries)
+		sz++;
+
+	cf = TAILQ_FIRST(&s->ups->cq);
+	if (sz == 1 && (cf->field->flags & FIELD_ROWID)) {
+		s->ups->flags |= UPSERT_ROWID;
+		return 1;
+	} else if (sz == 1 && (cf->field->flags & FIELD_UNIQUE))
+		return 1;
+
+	TAILQ_FOREACH(cf, &s->ups->cq, entries)
+		if (cf->field->flags & FIELD_ROWID) {
+			gen_errx(cfg, &cf->pos, "upsert rowid "
+				"must be the only field");
+			return 0;
+		}
+
+	TAILQ_FOREACH(u, &s->nq, entries) {
+		usz = 0;
+		TAILQ_FOREACH(nf, &u->nq, entries)
+			usz++;
+		if (usz != sz)
+			continue;
+		TAILQ_FOREACH(cf, &s->ups->cq, entries) {
+			TAILQ_FOREACH(nf, &u->nq, entries)
+				if (cf->field == nf->field)
+					break;
+			if (nf == NULL)
+				break;
+		}
+		if (cf == NULL)
+			return 1;
+	}
+
+	gen_errx(cfg, &s->ups->pos, "upsert fields "
+		"not a rowid, unique field, or unique statement");
+	return 0;
+}
+
+/*
+ * Make sure that the insert and updates of "s" returning their rows
+ * don't do so for a structure with nested structures, as these are
+ * only filled by the joins of searches.
+ * Returns zero on failure, non-zero on success.
+ */
+static int
+check_returning(struct config *cfg, const struct strct *s)
+{
+	const struct field	*f;
+	const struct update	*u;
+	int			 rc = 1;
+
+	TAILQ_FOREACH(f, &s->fq, entries)
+		if (f->type == FTYPE_STRUCT)
+			break;
+	if (f == NULL)
+		return 1;
+
+	if (s->ins != NULL && (s->ins->flags & INSERT_RETURNING)) {
+		gen_errx(cfg, &s->ins->pos, "insert returning "
+			"not allowed with struct fields");
+		rc = 0;
+	}
+	TAILQ_FOREACH(u, &s->uq, entries)
+		if (u->flags & UPDATE_RETURNING) {
+			gen_errx(cfg, &u->pos, "update returning "
+				"not allowed with struct fields");
+			rc = 0;
+		}
+	return rc;
+}
+
 /*
  * Make sure that the rolemap contains unique roles.
  * Returns zero on failure (duplicate roles), non-zero otherwise.
@@ -656,6 +916,22 @@ ort_parse_close(struct config *cfg)
 	if (i > 0)
 		return 0;
 
+	/* Check that upsert conflicts are on unique fields. */
+
+	i = 0;
+	TAILQ_FOREACH(p, &cfg->sq, entries)
+		i += !check_upsert_unique(cfg, p);
+	if (i > 0)
+		return 0;
+
+	/* Check that returned rows have no nested structures. */
+
+	i = 0;
+	TAILQ_FOREACH(p, &cfg->sq, entries)
+		i += !check_returning(cfg, p);
+	if (i > 0)
+		return 0;
+
 	/* Check that each rolemap has no duplicate roles. */
 
 	i = 0;
@@ -701,6 +977,10 @@ ort_parse_close(struct config *cfg)
 				gen_warnx(cfg, &p->ins->pos, 
 					"no roles defined for "
 					"insert function");
+			if (p->ups != NULL && p->ups->rolemap == NULL)
+				gen_warnx(cfg, &p->ups->pos, 
+					"no roles defined for "
+					"upsert function");
 		}
 
 	/* Check for reference recursion. */
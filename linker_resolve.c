@@ -254,6 +254,16 @@ resolve_up_const(struct config *cfg, struct struct_up_const *r)
 		errs++;
 	}
 
+	/* Arrays are bound as JSON, without blobs. */
+
+	if (r->result->field != NULL &&
+	    r->result->op == OPTYPE_IN &&
+	    r->result->field->type == FTYPE_BLOB) {
+		gen_errx(cfg, &r->result->pos, 
+			"IN operator on blob field");
+		errs++;
+	}
+
 	return errs == 0;
 }
 
@@ -326,6 +336,74 @@ resolve_up_mod(struct config *cfg, struct struct_up_mod *r)
 	return errs == 0;
 }
 
+static int
+resolve_struct_index(struct config *cfg, struct struct_index *r)
+{
+	struct field	*f;
+	struct iref	*ir;
+
+	TAILQ_FOREACH(f, &r->result->parent->parent->fq, entries) {
+		if (strcasecmp(f->name, r->name) != 0)
+			continue;
+		if (f->type != FTYPE_STRUCT)
+			break;
+		gen_errx(cfg, &r->result->pos, "index field "
+			"may not be a struct: %s", f->name);
+		return 0;
+	}
+
+	if (f == NULL) {
+		gen_errx(cfg, &r->result->pos, "unknown field");
+		return 0;
+	}
+
+	/* Disallow duplicates. */
+
+	TAILQ_FOREACH(ir, &r->result->parent->iq, entries)
+		if (f == ir->field) {
+			gen_errx(cfg, &r->result->pos, 
+				"duplicate field: %s", f->name);
+			return 0;
+		}
+
+	r->result->field = f;
+	return 1;
+}
+
+static int
+resolve_struct_upsert(struct config *cfg, struct struct_upsert *r)
+{
+	struct field	*f;
+	struct cref	*cr;
+
+	TAILQ_FOREACH(f, &r->result->parent->parent->fq, entries) {
+		if (strcasecmp(f->name, r->name) != 0)
+			continue;
+		if (f->type != FTYPE_STRUCT)
+			break;
+		gen_errx(cfg, &r->result->pos, "upsert field "
+			"may not be a struct: %s", f->name);
+		return 0;
+	}
+
+	if (f == NULL) {
+		gen_errx(cfg, &r->result->pos, "unknown field");
+		return 0;
+	}
+
+	/* Disallow duplicates. */
+
+	TAILQ_FOREACH(cr, &r->result->parent->cq, entries)
+		if (f == cr->field) {
+			gen_errx(cfg, &r->result->pos, 
+				"duplicate field: %s", f->name);
+			return 0;
+		}
+
+	r->result->field = f;
+	return 1;
+}
+
 static int
 resolve_struct_unique(struct config *cfg, struct struct_unique *r)
 {
@@ -361,6 +439,44 @@ resolve_struct_unique(struct config *cfg, struct struct_unique *r)
 	return 1;
 }
 
+/*
+ * Resolve a projected field, which must be a native field in the
+ * search's structure.
+ */
+static int
+resolve_struct_proj(struct config *cfg, struct struct_proj *r)
+{
+	struct field	*f;
+	struct proj	*pr;
+
+	TAILQ_FOREACH(f, &r->result->parent->parent->fq, entries) {
+		if (strcasecmp(f->name, r->name) != 0)
+			continue;
+		if (f->type != FTYPE_STRUCT)
+			break;
+		gen_errx(cfg, &r->result->pos, "projected field "
+			"may not be a struct: %s", f->name);
+		return 0;
+	}
+
+	if (f == NULL) {
+		gen_errx(cfg, &r->result->pos, "unknown field");
+		return 0;
+	}
+
+	/* Disallow duplicates. */
+
+	TAILQ_FOREACH(pr, &r->result->parent->projq, entries)
+		if (f == pr->field) {
+			gen_errx(cfg, &r->result->pos, 
+				"duplicate field: %s", f->name);
+			return 0;
+		}
+
+	r->result->field = f;
+	return 1;
+}
+
 /*
  * Look up the enum type by its name.
  */
@@ -428,6 +544,17 @@ resolve_struct_rolemap_insert(struct config *cfg, struct struct_rolemap *r)
 	return 1;
 }
 
+static int
+resolve_struct_rolemap_upsert(struct config *cfg, struct struct_rolemap *r)
+{
+
+	if (r->result->parent->ups == NULL) 
+		return 0;
+	assert(r->result->parent->ups->rolemap == NULL);
+	r->result->parent->ups->rolemap = r->result;
+	return 1;
+}
+
 static int
 resolve_struct_rolemap_update(struct config *cfg, struct struct_rolemap *r)
 {
@@ -640,6 +767,14 @@ resolve_struct_rolemap_post(struct config *cfg, struct struct_rolemap *r)
 		    (cfg, p->ins->rolemap, p->arolemap))
 			return 0;
 	}
+
+	if (p->ups != NULL && p->ups->rolemap == NULL) {
+		p->ups->rolemap = p->arolemap;
+	} else if (p->ups != NULL) {
+		if (!resolve_struct_rolemap_post_cover
+		    (cfg, p->ups->rolemap, p->arolemap))
+			return 0;
+	}
 	
 	return 1;
 }
@@ -675,6 +810,12 @@ resolve_struct_rolemap(struct config *cfg, struct struct_rolemap *r)
 		gen_errx(cfg, &r->result->parent->pos,
 			"insert operation not specified");
 		break;
+	case ROLEMAP_UPSERT:
+		if (resolve_struct_rolemap_upsert(cfg, r))
+			return 1;
+		gen_errx(cfg, &r->result->parent->pos,
+			"upsert operation not specified");
+		break;
 	case ROLEMAP_COUNT:
 	case ROLEMAP_ITERATE:
 	case ROLEMAP_LIST:
@@ -901,10 +1042,22 @@ linker_resolve(struct config *cfg)
 		case RESOLVE_ROLEMAP:
 			/* This requires RESOLVE_ROLE. */
 			break;
+		case RESOLVE_PROJ:
+			fail += !resolve_struct_proj
+				(cfg, &r->struct_proj);
+			break;
 		case RESOLVE_UNIQUE:
 			fail += !resolve_struct_unique
 				(cfg, &r->struct_unique);
 			break;
+		case RESOLVE_INDEX:
+			fail += !resolve_struct_index
+				(cfg, &r->struct_index);
+			break;
+		case RESOLVE_UPSERT:
+			fail += !resolve_struct_upsert
+				(cfg, &r->struct_upsert);
+			break;
 		case RESOLVE_UP_CONSTRAINT:
 			fail += !resolve_up_const
 				(cfg, &r->struct_up_const);
@@ -20,13 +20,17 @@
 TAILQ_HEAD(aliasq, alias);
 TAILQ_HEAD(bitfq, bitf);
 TAILQ_HEAD(bitidxq, bitidx);
+TAILQ_HEAD(crefq, cref);
 TAILQ_HEAD(eitemq, eitem);
 TAILQ_HEAD(enmq, enm);
 TAILQ_HEAD(fieldq, field);
 TAILQ_HEAD(fvalidq, fvalid);
+TAILQ_HEAD(indexq, index);
+TAILQ_HEAD(irefq, iref);
 TAILQ_HEAD(labelq, label);
 TAILQ_HEAD(nrefq, nref);
 TAILQ_HEAD(ordq, ord);
+TAILQ_HEAD(projq, proj);
 TAILQ_HEAD(rolemapq, rolemap);
 TAILQ_HEAD(roleq, role);
 TAILQ_HEAD(rrefq, rref);
@@ -240,6 +244,7 @@ enum	optype {
 	OPTYPE_OR, /* logical (bitwise) or */
 	OPTYPE_STREQ, /* string equality */
 	OPTYPE_STRNEQ, /* string non-equality */
+	OPTYPE_IN, /* set membership: x IN array */
 	/* Unary types... */
 	OPTYPE_ISNULL, /* nullity: x isnull */
 	OPTYPE_NOTNULL, /* non-nullity: x notnull */
@@ -274,6 +279,7 @@ enum	rolemapt {
 	ROLEMAP_LIST, /* list */
 	ROLEMAP_SEARCH, /* search */
 	ROLEMAP_UPDATE, /* update */
+	ROLEMAP_UPSERT, /* upsert */
 	ROLEMAP_NOEXPORT, /* noexport */
 	ROLEMAP__MAX
 };
@@ -412,6 +418,17 @@ struct	dstnct {
 	struct search	*parent; /* search entry */
 };
 
+/*
+ * A field projected by a search: only these columns of the search's
+ * structure are selected and filled.
+ */
+struct	proj {
+	struct field	 *field; /* resolved field */
+	struct pos	  pos; /* position in parse */
+	struct search	 *parent; /* up-reference */
+	TAILQ_ENTRY(proj) entries;
+};
+
 /*
  * A set of fields to search by and return results.
  * A "search" implies zero or more responses given a query; for example,
@@ -421,6 +438,7 @@ struct	dstnct {
 struct	search {
 	struct sentq	    sntq; /* nested reference chain */
 	struct ordq	    ordq; /* ordering chains */
+	struct projq	    projq; /* projected fields or empty for all */
 	struct aggr	   *aggr; /* aggregate chain or NULL */
 	struct group	   *group; /* grouping chain or NULL */
 	struct pos	    pos; /* parse point */
@@ -434,6 +452,9 @@ struct	search {
 	struct rolemap	   *rolemap; /* roles assigned to search */
 	unsigned int	    flags; 
 #define	SEARCH_IS_UNIQUE    0x01 /* has a rowid or unique somewhere */
+#define	SEARCH_PAGINATE     0x02 /* has keyset pagination */
+#define	SEARCH_LIMIT_BOUND  0x04 /* limit bound at run-time */
+#define	SEARCH_OFFSET_BOUND 0x08 /* offset bound at run-time */
 	TAILQ_ENTRY(search) entries;
 };
 
@@ -471,6 +492,27 @@ struct	unique {
 	TAILQ_ENTRY(unique) entries;
 };
 
+/*
+ * A single field in the local structure that will be part of an index.
+ */
+struct	iref {
+	struct field	 *field; /* resolved field */
+	struct pos	  pos; /* position in parse */
+	struct index	 *parent; /* up-reference */
+	TAILQ_ENTRY(iref) entries;
+};
+
+/*
+ * Define a sequence of fields in the given structure that combine to
+ * form an index in addition to those inferred by ort-sql(1).
+ */
+struct	index {
+	struct irefq	    iq; /* indexed fields in order */
+	struct strct	   *parent; /* up-reference */
+	struct pos	    pos; /* position in parse */
+	TAILQ_ENTRY(index)  entries;
+};
+
 /*
  * Type of modifier.
  */
@@ -495,6 +537,7 @@ struct	update {
 	struct rolemap	   *rolemap; /* roles assigned to function */
 	unsigned int	    flags;
 #define	UPDATE_ALL	    0x01 /* UP_MODIFY for all w/"set" */
+#define	UPDATE_RETURNING    0x02 /* also returning updated row */
 	TAILQ_ENTRY(update) entries;
 };
 
@@ -507,6 +550,31 @@ struct	insert {
 	struct rolemap	*rolemap; /* roles assigned to function */
 	struct strct	*parent; /* up-reference */
 	struct pos	 pos; /* parse point */
+	unsigned int	 flags;
+#define	INSERT_RETURNING 0x01 /* also returning inserted row */
+};
+
+/*
+ * A single field in the conflict target of an upsert.
+ */
+struct	cref {
+	struct field	 *field; /* resolved field */
+	struct pos	  pos; /* position in parse */
+	struct upsert	 *parent; /* up-reference */
+	TAILQ_ENTRY(cref) entries;
+};
+
+/*
+ * An insertion that updates the existing row instead when the fields of
+ * its conflict target, which must be unique, are already present.
+ */
+struct	upsert {
+	struct crefq	 cq; /* conflict target */
+	struct rolemap	*rolemap; /* roles assigned to function */
+	struct strct	*parent; /* up-reference */
+	struct pos	 pos; /* parse point */
+	unsigned int	 flags;
+#define	UPSERT_ROWID	 0x01 /* conflict target is the rowid */
 };
 
 /*
@@ -527,8 +595,10 @@ struct	strct {
 	struct updateq	   uq; /* update conditions */
 	struct updateq	   dq; /* delete constraints */
 	struct uniqueq	   nq; /* unique constraints */
+	struct indexq	   iq; /* index statements */
 	struct rolemapq	   rq; /* role assignments */
 	struct insert	  *ins; /* insert function */
+	struct upsert	  *ups; /* upsert function */
 	struct rolemap	  *arolemap; /* catcha-all rolemap */
 	unsigned int	   flags;
 #define	STRCT_HAS_QUEUE	   0x01 /* needs a queue interface */
@@ -554,6 +624,59 @@ struct	role {
 	TAILQ_ENTRY(role)  entries;
 };
 
+/*
+ * SQLite journal modes (the "journal_mode" pragma).
+ */
+enum	journal {
+	JOURNAL_UNSET = 0, /* SQLite's default */
+	JOURNAL_DELETE, /* delete */
+	JOURNAL_MEMORY, /* memory */
+	JOURNAL_OFF, /* off */
+	JOURNAL_PERSIST, /* persist */
+	JOURNAL_TRUNCATE, /* truncate */
+	JOURNAL_WAL, /* wal */
+	JOURNAL__MAX
+};
+
+/*
+ * SQLite synchronisation modes (the "synchronous" pragma).
+ */
+enum	syncmode {
+	SYNCMODE_UNSET = 0, /* SQLite's default */
+	SYNCMODE_EXTRA, /* extra */
+	SYNCMODE_FULL, /* full */
+	SYNCMODE_NORMAL, /* normal */
+	SYNCMODE_OFF, /* off */
+	SYNCMODE__MAX
+};
+
+/*
+ * SQLite temporary storage (the "temp_store" pragma).
+ */
+enum	tempstore {
+	TEMPSTORE_UNSET = 0, /* SQLite's default */
+	TEMPSTORE_FILE, /* file */
+	TEMPSTORE_MEMORY, /* memory */
+	TEMPSTORE__MAX
+};
+
+/*
+ * Database settings of the "database" block, each of which is applied
+ * as a pragma when creating the database or opening a connection.
+ * Unset values are left to SQLite.
+ */
+struct	database {
+	enum journal	 journal; /* journal mode */
+	enum syncmode	 sync; /* synchronisation */
+	enum tempstore	 temp; /* temporary storage */
+	int64_t		 mmap; /* bytes memory-mapped */
+	int64_t		 cache; /* pages or, if negative, KiB cached */
+	struct pos	 pos; /* parse point */
+	unsigned int	 flags;
+#define	DATABASE_MMAP	 0x01 /* mmap is set */
+#define	DATABASE_CACHE	 0x02 /* cache is set */
+};
+
 enum	msgtype {
 	MSGTYPE_WARN, /* recoverable warning */
 	MSGTYPE_ERROR, /* fatal non-system error */
@@ -578,6 +701,7 @@ struct	config {
 	struct enmq	  eq; /* all enumerations */
 	struct bitfq	  bq; /* all bitfields */
 	struct roleq	  rq; /* all roles (this is a tree) */
+	struct database	 *db; /* database settings or NULL */
 	char		**langs; /* known label langs */
 	size_t		  langsz; /* number of langs */
 	char		**fnames; /* filenames referenced */
@@ -492,6 +492,8 @@ again:
 		p->lasttype = TOK_PERIOD;
 	} else if (':' == c) {
 		p->lasttype = TOK_COLON;
+	} else if ('?' == c) {
+		p->lasttype = TOK_QUESTION;
 	} else if ('"' == c) {
 		p->bufsz = 0;
 		last = ' ';
@@ -723,6 +725,7 @@ parse_comment(struct parse *p, char **doc)
  *  [ "struct" ident STRUCT | 
  *    "enum" ident ENUM |
  *    "bitfield" ident BITFIELD |
+ *    "database" DATABASE |
  *    "roles" ident ROLESET ]*
  *
  * Returns zero on failure, non-zero otherwise.
@@ -749,6 +752,8 @@ parse_root(struct parse *p)
 
 		if (strcasecmp(p->last.string, "roles") == 0)
 			parse_roles(p);
+		else if (strcasecmp(p->last.string, "database") == 0)
+			parse_database(p);
 		else if (strcasecmp(p->last.string, "struct") == 0)
 			parse_struct(p);
 		else if (strcasecmp(p->last.string, "enum") == 0)
@@ -32,6 +32,7 @@ enum	tok {
 	TOK_LBRACE, /* { */
 	TOK_LITERAL, /* "text" */
 	TOK_PERIOD, /* } */
+	TOK_QUESTION, /* ? */
 	TOK_RBRACE, /* } */
 	TOK_SEMICOLON /* ; */
 };
@@ -83,6 +84,7 @@ void		parse_warnx(struct parse *, const char *, ...)
 			__attribute__((format(printf, 2, 3)));
 
 void		parse_bitfield(struct parse *);
+void		parse_database(struct parse *);
 void		parse_enum(struct parse *);
 void		parse_field(struct parse *, struct strct *);
 void		parse_struct(struct parse *);
@@ -0,0 +1,206 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 Kristaps Dzonsons <kristaps@bsd.lv>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "config.h"
+
+#if HAVE_SYS_QUEUE
+# include <sys/queue.h>
+#endif
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ort.h"
+#include "extern.h"
+#include "parser.h"
+
+static	const char *const journals[JOURNAL__MAX] = {
+	NULL, /* JOURNAL_UNSET */
+	"delete", /* JOURNAL_DELETE */
+	"memory", /* JOURNAL_MEMORY */
+	"off", /* JOURNAL_OFF */
+	"persist", /* JOURNAL_PERSIST */
+	"truncate", /* JOURNAL_TRUNCATE */
+	"wal", /* JOURNAL_WAL */
+};
+
+static	const char *const syncmodes[SYNCMODE__MAX] = {
+	NULL, /* SYNCMODE_UNSET */
+	"extra", /* SYNCMODE_EXTRA */
+	"full", /* SYNCMODE_FULL */
+	"normal", /* SYNCMODE_NORMAL */
+	"off", /* SYNCMODE_OFF */
+};
+
+static	const char *const tempstores[TEMPSTORE__MAX] = {
+	NULL, /* TEMPSTORE_UNSET */
+	"file", /* TEMPSTORE_FILE */
+	"memory", /* TEMPSTORE_MEMORY */
+};
+
+/*
+ * Look up the current identifier in the "sz" names "names", skipping
+ * the first, unset value.
+ * Returns the index or zero if not found, having reported an error.
+ */
+static size_t
+parse_database_name(struct parse *p, 
+	const char *const *names, size_t sz)
+{
+	size_t	 i;
+
+	if (parse_next(p) != TOK_IDENT) {
+		parse_errx(p, "expected value");
+		return 0;
+	}
+	for (i = 1; i < sz; i++)
+		if (strcasecmp(p->last.string, names[i]) == 0)
+			return i;
+	parse_errx(p, "unknown value: %s", p->last.string);
+	return 0;
+}
+
+/*
+ * Parse a size, which is an integer optionally followed by one of the
+ * "K", "M", or "G" binary multipliers, into "v".
+ * The multiplier is only accepted for non-negative sizes.
+ * On success, also sets "mult" to whether a multiplier was given.
+ * Returns zero on failure, non-zero on success.
+ */
+static int
+parse_database_size(struct parse *p, int64_t *v, int *mult)
+{
+	int64_t	 m;
+
+	if (parse_next(p) != TOK_INTEGER) {
+		parse_errx(p, "expected integer");
+		return 0;
+	}
+	*v = p->last.integer;
+	*mult = 0;
+	if (parse_next(p) != TOK_IDENT)
+		return 1;
+
+	if (strcasecmp(p->last.string, "K") == 0)
+		m = INT64_C(1) << 10;
+	else if (strcasecmp(p->last.string, "M") == 0)
+		m = INT64_C(1) << 20;
+	else if (strcasecmp(p->last.string, "G") == 0)
+		m = INT64_C(1) << 30;
+	else {
+		parse_errx(p, "unknown size multiplier");
+		return 0;
+	}
+	if (*v < 0 || *v > INT64_MAX / m) {
+		parse_errx(p, "size out of range");
+		return 0;
+	}
+	*v *= m;
+	*mult = 1;
+	parse_next(p);
+	return 1;
+}
+
+/*
+ * Parse database settings, which are applied as pragmas.
+ * Its syntax is:
+ *
+ *  "database" "{" 
+ *    [ "cache" size ";" |
+ *      "journal" mode ";" |
+ *      "mmap" size ";" |
+ *      "synchronous" mode ";" |
+ *      "temp" mode ";" ]*
+ *  "}" ";"
+ *
+ * Sizes with a multiplier are in bytes, so a "cache" size with one is
+ * converted into SQLite's negative KiB.
+ */
+void
+parse_database(struct parse *p)
+{
+	struct database	*db;
+	int		 mult;
+
+	if (p->cfg->db != NULL) {
+		parse_errx(p, "database already specified");
+		return;
+	}
+	if ((db = p->cfg->db = calloc(1, sizeof(struct database))) == NULL) {
+		parse_err(p);
+		return;
+	}
+	parse_point(p, &db->pos);
+
+	if (parse_next(p) != TOK_LBRACE) {
+		parse_errx(p, "expected left brace");
+		return;
+	}
+
+	while (!PARSE_STOP(p)) {
+		if (parse_next(p) == TOK_RBRACE)
+			break;
+		if (p->lasttype != TOK_IDENT) {
+			parse_errx(p, "expected database setting");
+			return;
+		}
+		if (strcasecmp(p->last.string, "journal") == 0) {
+			db->journal = parse_database_name
+				(p, journals, JOURNAL__MAX);
+			parse_next(p);
+		} else if (strcasecmp(p->last.string, "synchronous") == 0) {
+			db->sync = parse_database_name
+				(p, syncmodes, SYNCMODE__MAX);
+			parse_next(p);
+		} else if (strcasecmp(p->last.string, "temp") == 0) {
+			db->temp = parse_database_name
+				(p, tempstores, TEMPSTORE__MAX);
+			parse_next(p);
+		} else if (strcasecmp(p->last.string, "mmap") == 0) {
+			if (!parse_database_size(p, &db->mmap, &mult))
+				return;
+			if (db->mmap < 0) {
+				parse_errx(p, "negative mmap size");
+				return;
+			}
+			db->flags |= DATABASE_MMAP;
+		} else if (strcasecmp(p->last.string, "cache") == 0) {
+			if (!parse_database_size(p, &db->cache, &mult))
+				return;
+			if (mult)
+				db->cache = -(db->cache / 1024);
+			db->flags |= DATABASE_CACHE;
+		} else {
+			parse_errx(p, "unknown database setting: %s",
+				p->last.string);
+			return;
+		}
+		if (PARSE_STOP(p))
+			return;
+		if (p->lasttype != TOK_SEMICOLON) {
+			parse_errx(p, "expected semicolon");
+			return;
+		}
+	}
+
+	if (PARSE_STOP(p))
+		return;
+	if (parse_next(p) != TOK_SEMICOLON) 
+		parse_errx(p, "expected semicolon");
+}
@@ -44,6 +44,7 @@ static	const char *const optypes[OPTYPE__MAX] = {
 	"or", /* OPTYPE_OR */
 	"streq", /* OPTYPE_STREQ */
 	"strneq", /* OPTYPE_STRNEQ */
+	"in", /* OPTYPE_IN */
 	/* Unary types... */
 	"isnull", /* OPTYPE_ISNULL */
 	"notnull", /* OPTYPE_NOTNULL */
@@ -58,6 +59,7 @@ static	const char *const rolemapts[ROLEMAP__MAX] = {
 	"list", /* ROLEMAP_LIST */
 	"search", /* ROLEMAP_SEARCH */
 	"update", /* ROLEMAP_UPDATE */
+	"upsert", /* ROLEMAP_UPSERT */
 	"noexport", /* ROLEMAP_NOEXPORT */
 };
 
@@ -104,6 +106,7 @@ strct_alloc(struct parse *p, const char *name)
 	TAILQ_INIT(&s->aq);
 	TAILQ_INIT(&s->uq);
 	TAILQ_INIT(&s->nq);
+	TAILQ_INIT(&s->iq);
 	TAILQ_INIT(&s->dq);
 	TAILQ_INIT(&s->rq);
 	return s;
@@ -695,38 +698,113 @@ parse_config_search_terms(struct parse *p, struct search *srch)
 	} 
 }
 
+/*
+ * Parse the fields projected by a search, which must be native fields
+ * of the search's structure (resolved later).
+ *
+ *   field [ "," field ]*
+ */
+static void
+parse_config_proj_fields(struct parse *p, struct search *s)
+{
+	struct proj	*pr;
+	struct resolve	*r;
+
+	if (!TAILQ_EMPTY(&s->projq)) {
+		parse_errx(p, "redeclaring fields");
+		return;
+	}
+
+	for (;;) {
+		if (p->lasttype != TOK_IDENT) {
+			parse_errx(p, "expected projected field");
+			return;
+		}
+		if ((pr = calloc(1, sizeof(struct proj))) == NULL) {
+			parse_err(p);
+			return;
+		}
+		pr->parent = s;
+		parse_point(p, &pr->pos);
+		TAILQ_INSERT_TAIL(&s->projq, pr, entries);
+
+		if ((r = calloc(1, sizeof(struct resolve))) == NULL) {
+			parse_err(p);
+			return;
+		}
+		r->type = RESOLVE_PROJ;
+		TAILQ_INSERT_TAIL(&p->cfg->priv->rq, r, entries);
+		r->struct_proj.result = pr;
+		r->struct_proj.name = strdup(p->last.string);
+		if (r->struct_proj.name == NULL) {
+			parse_err(p);
+			return;
+		}
+		if (parse_next(p) != TOK_COMMA)
+			break;
+		parse_next(p);
+	}
+}
+
 /*
  * Parse the limit/offset parameters, where the first integer is the
  * limit, the second is the offset.
+ * Either may be a question mark, in which case it's bound at run-time
+ * as a function argument (only for list and iterate).
  *
- *   integer [ "," integer ]
+ *   ( integer | "?" ) [ "," ( integer | "?" ) ]
  */
 static void
 parse_config_limit_params(struct parse *p, struct search *s)
 {
-	if (p->lasttype != TOK_INTEGER) {
+	if (p->lasttype == TOK_QUESTION) {
+		if (s->type != STYPE_LIST && 
+		    s->type != STYPE_ITERATE) {
+			parse_errx(p, "run-time limit only "
+				"for list and iterate");
+			return;
+		} else if (s->limit || (s->flags & SEARCH_LIMIT_BOUND))
+			parse_warnx(p, "redeclaring limit");
+		s->limit = 0;
+		s->flags |= SEARCH_LIMIT_BOUND;
+	} else if (p->lasttype != TOK_INTEGER) {
 		parse_errx(p, "expected limit value");
 		return;
 	} else if (p->last.integer <= 0) {
 		parse_errx(p, "expected limit >0");
 		return;
-	} else if (s->limit)
-		parse_warnx(p, "redeclaring limit");
+	} else {
+		if (s->limit || (s->flags & SEARCH_LIMIT_BOUND))
+			parse_warnx(p, "redeclaring limit");
+		s->limit = p->last.integer;
+		s->flags &= ~SEARCH_LIMIT_BOUND;
+	}
 
-	s->limit = p->last.integer;
 	if (parse_next(p) != TOK_COMMA)
 		return;
 
-	if (parse_next(p) != TOK_INTEGER) {
+	if (parse_next(p) == TOK_QUESTION) {
+		if (s->type != STYPE_LIST && 
+		    s->type != STYPE_ITERATE) {
+			parse_errx(p, "run-time offset only "
+				"for list and iterate");
+			return;
+		} else if (s->offset || (s->flags & SEARCH_OFFSET_BOUND))
+			parse_warnx(p, "redeclaring offset");
+		s->offset = 0;
+		s->flags |= SEARCH_OFFSET_BOUND;
+	} else if (p->lasttype != TOK_INTEGER) {
 		parse_errx(p, "expected offset value");
 		return;
 	} else if (p->last.integer <= 0) {
 		parse_errx(p, "expected offset >0");
 		return;
-	} else if (s->offset)
-		parse_warnx(p, "redeclaring offset");
-
-	s->offset = p->last.integer;
+	} else {
+		if (s->offset || (s->flags & SEARCH_OFFSET_BOUND))
+			parse_warnx(p, "redeclaring offset");
+		s->offset = p->last.integer;
+		s->flags &= ~SEARCH_OFFSET_BOUND;
+	}
 	parse_next(p);
 }
 
@@ -736,9 +814,11 @@ parse_config_limit_params(struct parse *p, struct search *s)
  *   [ "name" name |
  *     "comment" quoted_string |
  *     "distinct" distinct_struct |
+ *     "fields" proj_fields |
  *     "minrow"|"maxrow" aggr_fields ]* |
  *     "grouprow" group_fields |
- *     "order" order_fields ]* ";"
+ *     "order" order_fields |
+ *     "paginate" ]* ";"
  */
 static void
 parse_config_search_params(struct parse *p, struct search *s)
@@ -801,6 +881,24 @@ parse_config_search_params(struct parse *p, struct search *s)
 		} else if (strcasecmp("distinct", p->last.string) == 0) {
 			parse_next(p);
 			parse_config_distinct_term(p, s);
+		} else if (strcasecmp("fields", p->last.string) == 0) {
+			if (s->type == STYPE_COUNT) {
+				parse_errx(p, "fields not "
+					"for count");
+				break;
+			}
+			parse_next(p);
+			parse_config_proj_fields(p, s);
+		} else if (strcasecmp("paginate", p->last.string) == 0) {
+			if (s->type != STYPE_LIST &&
+			    s->type != STYPE_ITERATE) {
+				parse_errx(p, "paginate only "
+					"for list and iterate");
+				break;
+			} else if (s->flags & SEARCH_PAGINATE)
+				parse_warnx(p, "redeclaring paginate");
+			s->flags |= SEARCH_PAGINATE;
+			parse_next(p);
 		} else {
 			parse_errx(p, "unknown search parameter");
 			break;
@@ -881,13 +979,78 @@ parse_struct_unique(struct parse *p, struct strct *s)
 			"required for unique constraint");
 }
 
+/*
+ * Parse an index clause.
+ * This has the following syntax:
+ *
+ *  "index" field ["," field]* ";"
+ *
+ * The fields are within the current structure.
+ */
+static void
+parse_struct_index(struct parse *p, struct strct *s)
+{
+	struct iref	 *ir;
+	struct index	 *ip;
+	struct resolve	 *r;
+
+	if ((ip = calloc(1, sizeof(struct index))) == NULL) {
+		parse_err(p);
+		return;
+	}
+
+	ip->parent = s;
+	parse_point(p, &ip->pos);
+	TAILQ_INIT(&ip->iq);
+	TAILQ_INSERT_TAIL(&s->iq, ip, entries);
+
+	while (!PARSE_STOP(p)) {
+		if (parse_next(p) != TOK_IDENT) {
+			parse_errx(p, "expected index field");
+			return;
+		}
+
+		/* Append to resolver. */
+
+		if ((ir = calloc(1, sizeof(struct iref))) == NULL) {
+			parse_err(p);
+			return;
+		}
+		TAILQ_INSERT_TAIL(&ip->iq, ir, entries);
+		parse_point(p, &ir->pos);
+		ir->parent = ip;
+
+		if ((r = calloc(1, sizeof(struct resolve))) == NULL) {
+			parse_err(p);
+			return;
+		}
+		r->type = RESOLVE_INDEX;
+		TAILQ_INSERT_TAIL(&p->cfg->priv->rq, r, entries);
+		r->struct_index.result = ir;
+		r->struct_index.name = strdup(p->last.string);
+		if (r->struct_index.name == NULL) {
+			parse_err(p);
+			return;
+		}
+
+		/* Next statement. */
+
+		if (parse_next(p) == TOK_SEMICOLON)
+			break;
+		if (p->lasttype != TOK_COMMA) {
+			parse_errx(p, "expected semicolon or comma");
+			return;
+		}
+	}
+}
+
 /*
  * Parse an update clause.
  * This has the following syntax:
  *
  *  "update" [ ufield [,ufield]* ]?
  *     [ ":" sfield [,sfield]*
- *       [ ":" [ "name" name | "comment" quot | "action" action ]* ]? 
+ *       [ ":" [ "name" name | "comment" quot | "returning" ]* ]? 
  *     ]? ";"
  *
  * The fields ("ufield" for update field and "sfield" for select field)
@@ -1040,7 +1203,7 @@ crq:
 
 	/*
 	 * Lastly, process update terms.
-	 * This now consists of "name" and "comment".
+	 * This now consists of "name", "comment", and "returning".
 	 */
 terms:
 	parse_next(p);
@@ -1067,6 +1230,13 @@ terms:
 		} else if (0 == strcasecmp(p->last.string, "comment")) {
 			if ( ! parse_comment(p, &up->doc))
 				return;
+		} else if (0 == strcasecmp(p->last.string, "returning")) {
+			if (UP_MODIFY != up->type) {
+				parse_errx(p, "returning "
+					"only for updates");
+				return;
+			}
+			up->flags |= UPDATE_RETURNING;
 		} else
 			parse_errx(p, "unknown term: %s", p->last.string);
 
@@ -1098,6 +1268,7 @@ parse_struct_search(struct parse *p, struct strct *s, enum stype stype)
 	parse_point(p, &srch->pos);
 	TAILQ_INIT(&srch->sntq);
 	TAILQ_INIT(&srch->ordq);
+	TAILQ_INIT(&srch->projq);
 	TAILQ_INSERT_TAIL(&s->sq, srch, entries);
 
 	if (stype == STYPE_LIST)
@@ -1293,6 +1464,7 @@ parse_struct_roles(struct parse *p, struct strct *s)
 		parse_next(p);
 		if (p->lasttype == TOK_IDENT) {
 			if (type == ROLEMAP_INSERT || 
+			    type == ROLEMAP_UPSERT ||
 			    type == ROLEMAP_ALL) {
 				parse_errx(p, "unexpected "
 					"role constraint name");
@@ -1302,6 +1474,7 @@ parse_struct_roles(struct parse *p, struct strct *s)
 			parse_next(p);
 		} else if (p->lasttype == TOK_SEMICOLON) {
 			if (type != ROLEMAP_INSERT &&
+			    type != ROLEMAP_UPSERT &&
 			    type != ROLEMAP_NOEXPORT &&
 			    type != ROLEMAP_ALL) {
 				parse_errx(p, "expected "
@@ -1354,6 +1527,9 @@ parse_struct_comment(struct parse *p, struct strct *s)
 /*
  * Parse the insert statement of a struct until and including the
  * trailing semicolon.
+ * This has the following syntax:
+ *
+ *  "insert" [ "returning" ]? ";"
  */
 static void
 parse_struct_insert(struct parse *p, struct strct *s)
@@ -1369,10 +1545,82 @@ parse_struct_insert(struct parse *p, struct strct *s)
 	}
 	s->ins->parent = s;
 	parse_point(p, &s->ins->pos);
-	if (parse_next(p) != TOK_SEMICOLON)
+	if (parse_next(p) == TOK_IDENT &&
+	    strcasecmp(p->last.string, "returning") == 0) {
+		s->ins->flags |= INSERT_RETURNING;
+		parse_next(p);
+	}
+	if (p->lasttype != TOK_SEMICOLON)
 		parse_errx(p, "expected semicolon");
 }
 
+/*
+ * Parse the upsert statement of a struct until and including the
+ * trailing semicolon.
+ * This has the following syntax:
+ *
+ *  "upsert" field ["," field]* ";"
+ *
+ * The fields, within the current structure, are the conflict target.
+ */
+static void
+parse_struct_upsert(struct parse *p, struct strct *s)
+{
+	struct cref	 *cr;
+	struct resolve	 *r;
+
+	if (s->ups != NULL) {
+		parse_errx(p, "upsert already defined");
+		return;
+	}
+	if ((s->ups = calloc(1, sizeof(struct upsert))) == NULL) {
+		parse_err(p);
+		return;
+	}
+	s->ups->parent = s;
+	parse_point(p, &s->ups->pos);
+	TAILQ_INIT(&s->ups->cq);
+
+	while (!PARSE_STOP(p)) {
+		if (parse_next(p) != TOK_IDENT) {
+			parse_errx(p, "expected upsert field");
+			return;
+		}
+
+		/* Append to resolver. */
+
+		if ((cr = calloc(1, sizeof(struct cref))) == NULL) {
+			parse_err(p);
+			return;
+		}
+		TAILQ_INSERT_TAIL(&s->ups->cq, cr, entries);
+		parse_point(p, &cr->pos);
+		cr->parent = s->ups;
+
+		if ((r = calloc(1, sizeof(struct resolve))) == NULL) {
+			parse_err(p);
+			return;
+		}
+		r->type = RESOLVE_UPSERT;
+		TAILQ_INSERT_TAIL(&p->cfg->priv->rq, r, entries);
+		r->struct_upsert.result = cr;
+		r->struct_upsert.name = strdup(p->last.string);
+		if (r->struct_upsert.name == NULL) {
+			parse_err(p);
+			return;
+		}
+
+		/* Next statement. */
+
+		if (parse_next(p) == TOK_SEMICOLON)
+			break;
+		if (p->lasttype != TOK_COMMA) {
+			parse_errx(p, "expected semicolon or comma");
+			return;
+		}
+	}
+}
+
 /*
  * Parse a full struct until and including the semicolon following.
  */
@@ -1406,8 +1654,12 @@ parse_struct_data(struct parse *p, struct strct *s)
 			parse_struct_update(p, s, UP_DELETE);
 		else if (strcasecmp(p->last.string, "insert") == 0)
 			parse_struct_insert(p, s);
+		else if (strcasecmp(p->last.string, "upsert") == 0)
+			parse_struct_upsert(p, s);
 		else if (strcasecmp(p->last.string, "unique") == 0)
 			parse_struct_unique(p, s);
+		else if (strcasecmp(p->last.string, "index") == 0)
+			parse_struct_index(p, s);
 		else if (strcasecmp(p->last.string, "roles") == 0)
 			parse_struct_roles(p, s);
 		else if (strcasecmp(p->last.string, "field") == 0)
@@ -34,6 +34,8 @@
 #include "ort.h"
 #include "extern.h"
 #include "comments.h"
+#include "sqlidx.h"
+#include "sqlstmt.h"
 
 static	const char *const realtypes[FTYPE__MAX] = {
 	"int", /* FTYPE_BIT */
@@ -50,27 +52,14 @@ static	const char *const realtypes[FTYPE__MAX] = {
 	"bitfield", /* FTYPE_BITFIELD */
 };
 
-static	const char *const upacts[UPACT__MAX] = {
-	"NO ACTION", /* UPACT_NONE */
-	"RESTRICT", /* UPACT_RESTRICT */
-	"SET NULL", /* UPACT_NULLIFY */
-	"CASCADE", /* UPACT_CASCADE */
-	"SET DEFAULT", /* UPACT_DEFAULT */
-};
-
-static	const char *const ftypes[FTYPE__MAX] = {
-	"INTEGER", /* FTYPE_BIT */
-	"INTEGER", /* FTYPE_DATE */
-	"INTEGER", /* FTYPE_EPOCH */
-	"INTEGER", /* FTYPE_INT */
-	"REAL", /* FTYPE_REAL */
-	"BLOB", /* FTYPE_BLOB */
-	"TEXT", /* FTYPE_TEXT */
-	"TEXT", /* FTYPE_PASSWORD */
-	"TEXT", /* FTYPE_EMAIL */
-	NULL, /* FTYPE_STRUCT */
-	"INTEGER", /* FTYPE_ENUM */
-	"INTEGER", /* FTYPE_BITFIELD */
+static	const char *const journals[JOURNAL__MAX] = {
+	NULL, /* JOURNAL_UNSET */
+	"DELETE", /* JOURNAL_DELETE */
+	"MEMORY", /* JOURNAL_MEMORY */
+	"OFF", /* JOURNAL_OFF */
+	"PERSIST", /* JOURNAL_PERSIST */
+	"TRUNCATE", /* JOURNAL_TRUNCATE */
+	"WAL", /* JOURNAL_WAL */
 };
 
 /* Forward declarations to get __attribute__ bits. */
@@ -152,17 +141,12 @@ gen_prologue(int *prol)
 static void
 gen_unique(const struct unique *n, int *first)
 {
-	struct nref	*ref;
-	int		 ffirst = 1;
-
-	printf("%s\n\tUNIQUE(", *first ? "" : ",");
+	struct sqlbuf	 b;
 
-	TAILQ_FOREACH(ref, &n->nq, entries) {
-		printf("%s%s", ffirst ? "" : ", ",
-			ref->field->name);
-		ffirst = 0;
-	}
-	putchar(')');
+	memset(&b, 0, sizeof(struct sqlbuf));
+	ddl_unique(&b, n);
+	printf("%s\n\t%s", *first ? "" : ",", b.data);
+	buf_free(&b);
 	*first = 0;
 }
 
@@ -172,21 +156,15 @@ gen_unique(const struct unique *n, int *first)
 static void
 gen_fkeys(const struct field *f, int *first)
 {
+	struct sqlbuf	 b;
 
 	if (f->type == FTYPE_STRUCT || f->ref == NULL)
 		return;
 
-	printf("%s\n\tFOREIGN KEY(%s) REFERENCES %s(%s)",
-		*first ? "" : ",",
-		f->ref->source->name,
-		f->ref->target->parent->name,
-		f->ref->target->name);
-	
-	if (UPACT_NONE != f->actdel)
-		printf(" ON DELETE %s", upacts[f->actdel]);
-	if (UPACT_NONE != f->actup)
-		printf(" ON UPDATE %s", upacts[f->actup]);
-
+	memset(&b, 0, sizeof(struct sqlbuf));
+	ddl_fkey(&b, f);
+	printf("%s\n\t%s", *first ? "" : ",", b.data);
+	buf_free(&b);
 	*first = 0;
 }
 
@@ -196,6 +174,7 @@ gen_fkeys(const struct field *f, int *first)
 static void
 gen_field(const struct field *f, int *first, int comments)
 {
+	struct sqlbuf	 b;
 
 	if (f->type == FTYPE_STRUCT)
 		return;
@@ -206,14 +185,10 @@ gen_field(const struct field *f, int *first, int comments)
 	if (f->type == FTYPE_EPOCH || f->type == FTYPE_DATE)
 		print_commentt(1, COMMENT_SQL, 
 			"(Stored as a UNIX epoch value.)");
-	printf("\t%s %s", f->name, ftypes[f->type]);
-	if (FIELD_ROWID & f->flags)
-		printf(" PRIMARY KEY");
-	if (FIELD_UNIQUE & f->flags)
-		printf(" UNIQUE");
-	if (!(FIELD_ROWID & f->flags) &&
-	    !(FIELD_NULL & f->flags))
-		printf(" NOT NULL");
+	memset(&b, 0, sizeof(struct sqlbuf));
+	ddl_column(&b, f);
+	printf("\t%s", b.data);
+	buf_free(&b);
 	*first = 0;
 }
 
@@ -242,16 +217,109 @@ gen_struct(const struct strct *p, int comments)
 	     "");
 }
 
+/*
+ * Look up an uncovered index in "q" with the same table and column
+ * names as "ip".
+ * Returns NULL if not found.
+ */
+static const struct sqlidx *
+idx_find(const struct sqlidxq *q, const struct sqlidx *ip)
+{
+	size_t	 i, j;
+
+	for (i = 0; i < q->idxsz; i++) {
+		if (q->idx[i].covered ||
+		    q->idx[i].fieldsz != ip->fieldsz ||
+		    strcasecmp(q->idx[i].parent->name, 
+		     ip->parent->name))
+			continue;
+		for (j = 0; j < ip->fieldsz; j++)
+			if (strcasecmp(q->idx[i].fields[j]->name,
+			    ip->fields[j]->name))
+				break;
+		if (j == ip->fieldsz)
+			return &q->idx[i];
+	}
+	return NULL;
+}
+
+/*
+ * Print the name of index "ip": the table and column names joined by
+ * underscores with a "_idx" suffix.
+ */
+static void
+gen_index_name(const struct sqlidx *ip)
+{
+	struct sqlbuf	 b;
+
+	memset(&b, 0, sizeof(struct sqlbuf));
+	ddl_index_name(&b, ip);
+	fputs(b.data, stdout);
+	buf_free(&b);
+}
+
+/*
+ * Generate the "CREATE INDEX" statement for "ip".
+ */
+static void
+gen_index(const struct sqlidx *ip)
+{
+	struct sqlbuf	 b;
+
+	memset(&b, 0, sizeof(struct sqlbuf));
+	ddl_index(&b, ip);
+	printf("%s;\n", b.data);
+	buf_free(&b);
+}
+
+/*
+ * Generate all uncovered indexes of table "p".
+ */
 static void
-gen_sql(const struct strctq *q)
+gen_indexes(const struct sqlidxq *q, const struct strct *p)
 {
-	const struct strct *p;
+	size_t	 i, count = 0;
+
+	for (i = 0; i < q->idxsz; i++)
+		if (q->idx[i].parent == p && !q->idx[i].covered) {
+			gen_index(&q->idx[i]);
+			count++;
+		}
+	if (count > 0)
+		puts("");
+}
+
+/*
+ * Generate the database settings persisted in the database file, which
+ * is only the journal mode.
+ * The remaining settings are per-connection, so they're left to the
+ * generated open functions.
+ */
+static void
+gen_database(const struct database *db)
+{
+
+	if (db != NULL && db->journal != JOURNAL_UNSET)
+		printf("PRAGMA journal_mode=%s;\n\n", 
+			journals[db->journal]);
+}
+
+static void
+gen_sql(const struct config *cfg)
+{
+	const struct strct	*p;
+	struct sqlidxq		 iq;
 
 	puts("PRAGMA foreign_keys=ON;\n"
 	     "");
+	gen_database(cfg->db);
 
-	TAILQ_FOREACH(p, q, entries)
+	idx_gen(&cfg->sq, &iq);
+	TAILQ_FOREACH(p, &cfg->sq, entries) {
 		gen_struct(p, 1);
+		gen_indexes(&iq, p);
+	}
+	idx_free(&iq);
 }
 
 /*
@@ -390,6 +458,7 @@ gen_diff_fields_new(const struct strct *s,
 	const struct strct *ds, int *prologue)
 {
 	const struct field *f, *df;
+	struct sqlbuf	 b;
 	size_t	 count = 0, errors = 0;
 
 	/*
@@ -414,16 +483,11 @@ gen_diff_fields_new(const struct strct *s,
 			gen_warnx(&f->pos, "new inner joined field");
 		} else if (NULL == df) {
 			gen_prologue(prologue);
-			printf("ALTER TABLE %s ADD COLUMN %s %s",
-				f->parent->name, f->name, 
-				ftypes[f->type]);
-			if (FIELD_ROWID & f->flags)
-				printf(" PRIMARY KEY");
-			if (FIELD_UNIQUE & f->flags)
-				printf(" UNIQUE");
-			if ( ! (FIELD_ROWID & f->flags) &&
-			     ! (FIELD_NULL & f->flags))
-				printf(" NOT NULL");
+			memset(&b, 0, sizeof(struct sqlbuf));
+			ddl_column(&b, f);
+			printf("ALTER TABLE %s ADD COLUMN %s",
+				f->parent->name, b.data);
+			buf_free(&b);
 			if (NULL != f->ref)
 				printf(" REFERENCES %s(%s)",
 					f->ref->target->parent->name,
@@ -704,6 +768,58 @@ gen_diff_enums(const struct config *cfg,
 	return errors;
 }
 
+/*
+ * Look up the table named as "p" in "q".
+ * Returns NULL if not found.
+ */
+static const struct strct *
+gen_diff_strct(const struct strctq *q, const struct strct *p)
+{
+	const struct strct	*s;
+
+	TAILQ_FOREACH(s, q, entries)
+		if (strcasecmp(s->name, p->name) == 0)
+			return s;
+	return NULL;
+}
+
+/*
+ * Create the new indexes "iq" not in the old "diq" and drop the old
+ * indexes not in the new, both only for tables in the new "sq" and old
+ * "dsq".
+ * Indexes are matched by table and column names.
+ */
+static void
+gen_diff_indexes(const struct sqlidxq *iq, const struct sqlidxq *diq,
+	const struct strctq *sq, const struct strctq *dsq, int *prol)
+{
+	const struct sqlidx	*ip;
+	size_t			 i, count = 0;
+
+	for (i = 0; i < diq->idxsz; i++) {
+		ip = &diq->idx[i];
+		if (ip->covered || gen_diff_strct(sq, ip->parent) == NULL ||
+		    idx_find(iq, ip) != NULL)
+			continue;
+		gen_prologue(prol);
+		printf("DROP INDEX ");
+		gen_index_name(ip);
+		puts(";");
+		count++;
+	}
+	for (i = 0; i < iq->idxsz; i++) {
+		ip = &iq->idx[i];
+		if (ip->covered || gen_diff_strct(dsq, ip->parent) == NULL ||
+		    idx_find(diq, ip) != NULL)
+			continue;
+		gen_prologue(prol);
+		gen_index(ip);
+		count++;
+	}
+	if (count > 0)
+		puts("");
+}
+
 /*
  * Generate an SQL diff with "cfg" being the new, "dfcg" being the old.
  * This returns zero on failure, non-zero on success.
@@ -717,12 +833,24 @@ gen_diff(const struct config *cfg,
 	const struct config *dcfg, int destruct)
 {
 	const struct strct *s, *ds;
+	struct sqlidxq	 iq, diq;
 	size_t	 errors = 0;
 	int	 rc, prol = 0;
 
 	errors += gen_diff_enums(cfg, dcfg, destruct);
 	errors += gen_diff_bits(cfg, dcfg, destruct);
 
+	/* Only the journal mode is persistent, so only it is changed. */
+
+	if (cfg->db != NULL && cfg->db->journal != JOURNAL_UNSET &&
+	    (dcfg->db == NULL || dcfg->db->journal != cfg->db->journal)) {
+		gen_prologue(&prol);
+		gen_database(cfg->db);
+	}
+
+	idx_gen(&cfg->sq, &iq);
+	idx_gen(&dcfg->sq, &diq);
+
 	/*
 	 * Start by looking through all structures in the new queue and
 	 * see if they exist in the old queue.
@@ -738,6 +866,7 @@ gen_diff(const struct config *cfg,
 		if (ds == NULL) {
 			gen_prologue(&prol);
 			gen_struct(s, 0);
+			gen_indexes(&iq, s);
 		}
 	}
 
@@ -761,6 +890,13 @@ gen_diff(const struct config *cfg,
 			puts("");
 	}
 
+	/*
+	 * Create and drop indexes of tables in both.
+	 * This comes after the new columns they might use.
+	 */
+
+	gen_diff_indexes(&iq, &diq, &cfg->sq, &dcfg->sq, &prol);
+
 	/*
 	 * Now reverse and see if we should drop tables.
 	 * Don't do this---just tell the user and return an error.
@@ -800,6 +936,8 @@ gen_diff(const struct config *cfg,
 			gen_diff_uniques_old(s, ds);
 		}
 
+	idx_free(&iq);
+	idx_free(&diq);
 	return errors ? 0 : 1;
 }
 
@@ -930,7 +1068,7 @@ main(int argc, char *argv[])
 	/* Generate output. */
 
 	if (!diff) {
-		gen_sql(&cfg->sq);
+		gen_sql(cfg);
 		rc = 1;
 	} else 
 		rc = gen_diff(cfg, dcfg, destruct);
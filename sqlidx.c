@@ -0,0 +1,323 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 Kristaps Dzonsons <kristaps@bsd.lv>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "config.h"
+
+#if HAVE_SYS_QUEUE
+# include <sys/queue.h>
+#endif
+
+#if HAVE_ERR
+# include <err.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ort.h"
+#include "sqlidx.h"
+
+/*
+ * Append an index on columns "fields" of their table, unless it's
+ * empty or already present.
+ */
+static void
+idx_add(struct sqlidxq *q, const struct field **fields, size_t sz)
+{
+	struct sqlidx	*ip;
+	size_t		 i, j;
+
+	if (sz == 0)
+		return;
+
+	for (i = 0; i < q->idxsz; i++) {
+		if (q->idx[i].fieldsz != sz)
+			continue;
+		for (j = 0; j < sz; j++)
+			if (q->idx[i].fields[j] != fields[j])
+				break;
+		if (j == sz)
+			return;
+	}
+
+	q->idx = reallocarray(q->idx, q->idxsz + 1, sizeof(struct sqlidx));
+	if (q->idx == NULL)
+		err(EXIT_FAILURE, NULL);
+	ip = &q->idx[q->idxsz++];
+	memset(ip, 0, sizeof(struct sqlidx));
+	ip->parent = fields[0]->parent;
+	ip->fieldsz = sz;
+	if ((ip->fields = calloc(sz, sizeof(struct field *))) == NULL)
+		err(EXIT_FAILURE, NULL);
+	memcpy(ip->fields, fields, sz * sizeof(struct field *));
+}
+
+/*
+ * Append column "f" to the index columns "fields" being built for a
+ * query unless it's already there.
+ */
+static void
+idx_add_col(const struct field **fields, size_t *sz, 
+	const struct field *f)
+{
+	size_t	 i;
+
+	for (i = 0; i < *sz; i++)
+		if (fields[i] == f)
+			return;
+	fields[(*sz)++] = f;
+}
+
+/*
+ * Whether the operator "op" on field "f" is evaluated in SQL and may
+ * use an index: equality ("eq") or a range.
+ * Password equality is checked after the query, so never counts.
+ */
+static int
+idx_op(const struct field *f, enum optype op, int eq)
+{
+
+	if (f->type == FTYPE_PASSWORD && op != OPTYPE_STREQ)
+		return 0;
+	if (eq)
+		return op == OPTYPE_EQUAL || op == OPTYPE_STREQ ||
+			op == OPTYPE_IN || op == OPTYPE_ISNULL;
+	return op == OPTYPE_GE || op == OPTYPE_GT ||
+		op == OPTYPE_LE || op == OPTYPE_LT;
+}
+
+/*
+ * Infer the index for search "s": its local equality constraints in
+ * order, then either its first local range constraint or its local
+ * ordering, in order.
+ * Equality constraints on joined tables are indexed on their own, as
+ * are row groupings with their aggregate.
+ */
+static void
+idx_search(struct sqlidxq *q, const struct search *s)
+{
+	const struct sent	 *sent;
+	const struct ord	 *ord;
+	const struct field	**fields, *rng = NULL, *grp[2];
+	size_t			  sz = 0, n = 0;
+
+	TAILQ_FOREACH(sent, &s->sntq, entries)
+		n++;
+	TAILQ_FOREACH(ord, &s->ordq, entries)
+		n++;
+	if ((fields = calloc(n + 1, sizeof(struct field *))) == NULL)
+		err(EXIT_FAILURE, NULL);
+
+	TAILQ_FOREACH(sent, &s->sntq, entries)
+		if (sent->name != NULL) {
+			if (idx_op(sent->field, sent->op, 1))
+				idx_add(q, (const struct field **)
+					&sent->field, 1);
+		} else if (idx_op(sent->field, sent->op, 1))
+			idx_add_col(fields, &sz, sent->field);
+		else if (rng == NULL && 
+		    idx_op(sent->field, sent->op, 0))
+			rng = sent->field;
+
+	if (rng != NULL)
+		idx_add_col(fields, &sz, rng);
+	else if (s->type != STYPE_COUNT)
+		TAILQ_FOREACH(ord, &s->ordq, entries) {
+			if (ord->name != NULL)
+				break;
+			idx_add_col(fields, &sz, ord->field);
+		}
+
+	idx_add(q, fields, sz);
+	free(fields);
+
+	/* Each row's group maximum or minimum is looked up by both. */
+
+	if (s->group != NULL && s->aggr != NULL) {
+		grp[0] = s->group->field;
+		grp[1] = s->aggr->field;
+		idx_add(q, grp, 2);
+	}
+}
+
+/*
+ * Infer the index for the constraints of update or delete "u" as for
+ * idx_search(), but without ordering.
+ */
+static void
+idx_update(struct sqlidxq *q, const struct update *u)
+{
+	const struct uref	 *ur;
+	const struct field	**fields, *rng = NULL;
+	size_t			  sz = 0, n = 0;
+
+	TAILQ_FOREACH(ur, &u->crq, entries)
+		n++;
+	if (n == 0)
+		return;
+	if ((fields = calloc(n, sizeof(struct field *))) == NULL)
+		err(EXIT_FAILURE, NULL);
+
+	TAILQ_FOREACH(ur, &u->crq, entries)
+		if (idx_op(ur->field, ur->op, 1))
+			idx_add_col(fields, &sz, ur->field);
+		else if (rng == NULL && idx_op(ur->field, ur->op, 0))
+			rng = ur->field;
+	if (rng != NULL)
+		idx_add_col(fields, &sz, rng);
+
+	idx_add(q, fields, sz);
+	free(fields);
+}
+
+/*
+ * Whether the columns "fields" are a prefix of those in "pfx", which
+ * has "pfxsz" columns.
+ */
+static int
+idx_prefix(const struct field **fields, size_t sz,
+	const struct field *const *pfx, size_t pfxsz)
+{
+	size_t	 i;
+
+	if (sz > pfxsz)
+		return 0;
+	for (i = 0; i < sz; i++)
+		if (fields[i] != pfx[i])
+			return 0;
+	return 1;
+}
+
+/*
+ * Whether the columns of index "ip" are a prefix of unique statement
+ * "u".
+ */
+static int
+idx_prefix_unique(const struct sqlidx *ip, const struct unique *u)
+{
+	const struct nref	*nr;
+	size_t			 i = 0;
+
+	TAILQ_FOREACH(nr, &u->nq, entries) {
+		if (i == ip->fieldsz)
+			break;
+		if (nr->field != ip->fields[i++])
+			return 0;
+	}
+	return i == ip->fieldsz;
+}
+
+/*
+ * Mark inferred indexes covered by an existing index: the rowid, a
+ * unique column or "unique" statement, a manual index, or a longer
+ * inferred index on the same leading columns.
+ * Manual indexes are the first "nman" and are never marked.
+ */
+static void
+idx_cover(struct sqlidxq *q, size_t nman)
+{
+	struct sqlidx		 *ip;
+	const struct unique	 *u;
+	size_t			  i, j;
+
+	for (i = nman; i < q->idxsz; i++) {
+		ip = &q->idx[i];
+		if (ip->fields[0]->flags & (FIELD_ROWID | FIELD_UNIQUE)) {
+			ip->covered = 1;
+			continue;
+		}
+		TAILQ_FOREACH(u, &ip->parent->nq, entries)
+			if (idx_prefix_unique(ip, u))
+				break;
+		if (u != NULL) {
+			ip->covered = 1;
+			continue;
+		}
+		for (j = 0; j < q->idxsz; j++) {
+			if (j == i || q->idx[j].covered ||
+			    q->idx[j].parent != ip->parent ||
+			    q->idx[j].fieldsz < ip->fieldsz ||
+			    (q->idx[j].fieldsz == ip->fieldsz && j > i))
+				continue;
+			if (idx_prefix(ip->fields, ip->fieldsz, 
+			    q->idx[j].fields, q->idx[j].fieldsz))
+				break;
+		}
+		if (j < q->idxsz)
+			ip->covered = 1;
+	}
+}
+
+/*
+ * Collect the indexes of all tables in "sq": those given by "index"
+ * statements, then those inferred from foreign keys, searches and
+ * ordering, and update and delete constraints.
+ * Inferred indexes already provided by another are marked as covered.
+ */
+void
+idx_gen(const struct strctq *sq, struct sqlidxq *q)
+{
+	const struct strct	 *p;
+	const struct index	 *ix;
+	const struct iref	 *ir;
+	const struct field	 *f;
+	const struct search	 *s;
+	const struct update	 *u;
+	const struct field	**fields;
+	size_t			  sz, nman;
+
+	memset(q, 0, sizeof(struct sqlidxq));
+
+	TAILQ_FOREACH(p, sq, entries)
+		TAILQ_FOREACH(ix, &p->iq, entries) {
+			sz = 0;
+			TAILQ_FOREACH(ir, &ix->iq, entries)
+				sz++;
+			fields = calloc(sz, sizeof(struct field *));
+			if (fields == NULL)
+				err(EXIT_FAILURE, NULL);
+			sz = 0;
+			TAILQ_FOREACH(ir, &ix->iq, entries)
+				fields[sz++] = ir->field;
+			idx_add(q, fields, sz);
+			free(fields);
+		}
+	nman = q->idxsz;
+
+	TAILQ_FOREACH(p, sq, entries) {
+		TAILQ_FOREACH(f, &p->fq, entries)
+			if (f->type != FTYPE_STRUCT && f->ref != NULL)
+				idx_add(q, &f, 1);
+		TAILQ_FOREACH(s, &p->sq, entries)
+			idx_search(q, s);
+		TAILQ_FOREACH(u, &p->uq, entries)
+			idx_update(q, u);
+		TAILQ_FOREACH(u, &p->dq, entries)
+			idx_update(q, u);
+	}
+
+	idx_cover(q, nman);
+}
+
+void
+idx_free(struct sqlidxq *q)
+{
+	size_t	 i;
+
+	for (i = 0; i < q->idxsz; i++)
+		free(q->idx[i].fields);
+	free(q->idx);
+}
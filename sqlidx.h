@@ -0,0 +1,42 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 Kristaps Dzonsons <kristaps@bsd.lv>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef SQLIDX_H
+#define SQLIDX_H
+
+/*
+ * An index on the columns "fields" of table "parent", either from an
+ * "index" statement or inferred from how the table is used.
+ */
+struct	sqlidx {
+	const struct strct	 *parent; /* table */
+	const struct field	**fields; /* columns in order */
+	size_t			  fieldsz;
+	int			  covered; /* prefix of another */
+};
+
+/*
+ * All indexes of a configuration.
+ */
+struct	sqlidxq {
+	struct sqlidx		 *idx;
+	size_t			  idxsz;
+};
+
+void	 idx_free(struct sqlidxq *);
+void	 idx_gen(const struct strctq *, struct sqlidxq *);
+
+#endif /* !SQLIDX_H */
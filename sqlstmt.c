@@ -0,0 +1,949 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 Kristaps Dzonsons <kristaps@bsd.lv>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "config.h"
+
+#if HAVE_SYS_QUEUE
+# include <sys/queue.h>
+#endif
+
+#include <assert.h>
+#if HAVE_ERR
+# include <err.h>
+#endif
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ort.h"
+#include "sqlidx.h"
+#include "sqlstmt.h"
+
+const char *const ftypes[FTYPE__MAX] = {
+	"INTEGER", /* FTYPE_BIT */
+	"INTEGER", /* FTYPE_DATE */
+	"INTEGER", /* FTYPE_EPOCH */
+	"INTEGER", /* FTYPE_INT */
+	"REAL", /* FTYPE_REAL */
+	"BLOB", /* FTYPE_BLOB */
+	"TEXT", /* FTYPE_TEXT */
+	"TEXT", /* FTYPE_PASSWORD */
+	"TEXT", /* FTYPE_EMAIL */
+	NULL, /* FTYPE_STRUCT */
+	"INTEGER", /* FTYPE_ENUM */
+	"INTEGER", /* FTYPE_BITFIELD */
+};
+
+/*
+ * SQL operators.
+ * Some of these binary, some of these are unary.
+ * Use the OPTYPE_ISUNARY or OPTYPE_ISBINARY macro to determine where
+ * within the expressions this should sit.
+ */
+const char *const optypes[OPTYPE__MAX] = {
+	"=", /* OPTYPE_EQUAL */
+	">=", /* OPTYPE_GE */
+	">", /* OPTYPE_GT */
+	"<=", /* OPTYPE_LE */
+	"<", /* OPTYPE_LT */
+	"!=", /* OPTYPE_NEQUAL */
+	"LIKE", /* OPTYPE_LIKE */
+	"&", /* OPTYPE_AND */
+	"|", /* OPTYPE_OR */
+	"=", /* OPTYPE_STREQ */
+	"!=", /* OPTYPE_STRNEQ */
+	"IN", /* OPTYPE_IN */
+	/* Unary types... */
+	"ISNULL", /* OPTYPE_ISNULL */
+	"NOTNULL", /* OPTYPE_NOTNULL */
+};
+
+const char *const upacts[UPACT__MAX] = {
+	"NO ACTION", /* UPACT_NONE */
+	"RESTRICT", /* UPACT_RESTRICT */
+	"SET NULL", /* UPACT_NULLIFY */
+	"CASCADE", /* UPACT_CASCADE */
+	"SET DEFAULT", /* UPACT_DEFAULT */
+};
+
+static void stmt_appendv(struct sqlstmt *, const char *, ...)
+	__attribute__((format(printf, 2, 3)));
+static struct sqlstmt *stmt_add(struct sqlstmtq *,
+	const struct strct *, const struct pos *, int,
+	const char *, ...)
+	__attribute__((format(printf, 5, 6)));
+
+static void
+buf_appendva(struct sqlbuf *b, const char *fmt, va_list ap)
+{
+	va_list	 cp;
+	int	 c;
+
+	va_copy(cp, ap);
+	c = vsnprintf(NULL, 0, fmt, cp);
+	va_end(cp);
+	if (c < 0)
+		err(EXIT_FAILURE, "vsnprintf");
+
+	if (b->sz + c + 1 > b->max) {
+		b->max = b->sz + c + 1024;
+		if ((b->data = realloc(b->data, b->max)) == NULL)
+			err(EXIT_FAILURE, NULL);
+	}
+
+	vsnprintf(b->data + b->sz, b->max - b->sz, fmt, ap);
+	b->sz += c;
+}
+
+void
+buf_appendv(struct sqlbuf *b, const char *fmt, ...)
+{
+	va_list	 ap;
+
+	va_start(ap, fmt);
+	buf_appendva(b, fmt, ap);
+	va_end(ap);
+}
+
+void
+buf_reset(struct sqlbuf *b)
+{
+
+	b->sz = 0;
+	if (b->data != NULL)
+		b->data[0] = '\0';
+}
+
+void
+buf_free(struct sqlbuf *b)
+{
+
+	free(b->data);
+	memset(b, 0, sizeof(struct sqlbuf));
+}
+
+/*
+ * Append the definition of column "f": its name, type, and
+ * constraints.
+ */
+void
+ddl_column(struct sqlbuf *b, const struct field *f)
+{
+
+	assert(f->type != FTYPE_STRUCT);
+	buf_appendv(b, "%s %s", f->name, ftypes[f->type]);
+	if (f->flags & FIELD_ROWID)
+		buf_appendv(b, " PRIMARY KEY");
+	if (f->flags & FIELD_UNIQUE)
+		buf_appendv(b, " UNIQUE");
+	if (!(f->flags & FIELD_ROWID) && !(f->flags & FIELD_NULL))
+		buf_appendv(b, " NOT NULL");
+}
+
+/*
+ * Append the foreign key constraint of reference field "f".
+ */
+void
+ddl_fkey(struct sqlbuf *b, const struct field *f)
+{
+
+	assert(f->type != FTYPE_STRUCT && f->ref != NULL);
+	buf_appendv(b, "FOREIGN KEY(%s) REFERENCES %s(%s)",
+		f->ref->source->name,
+		f->ref->target->parent->name,
+		f->ref->target->name);
+	if (f->actdel != UPACT_NONE)
+		buf_appendv(b, " ON DELETE %s", upacts[f->actdel]);
+	if (f->actup != UPACT_NONE)
+		buf_appendv(b, " ON UPDATE %s", upacts[f->actup]);
+}
+
+/*
+ * Append the unique constraint "n".
+ */
+void
+ddl_unique(struct sqlbuf *b, const struct unique *n)
+{
+	const struct nref	*ref;
+
+	buf_appendv(b, "UNIQUE(");
+	TAILQ_FOREACH(ref, &n->nq, entries)
+		buf_appendv(b, "%s%s", ref == TAILQ_FIRST(&n->nq) ?
+			"" : ", ", ref->field->name);
+	buf_appendv(b, ")");
+}
+
+/*
+ * Append the name of index "ip": the table and column names joined by
+ * underscores with a "_idx" suffix.
+ */
+void
+ddl_index_name(struct sqlbuf *b, const struct sqlidx *ip)
+{
+	size_t	 i;
+
+	buf_appendv(b, "%s", ip->parent->name);
+	for (i = 0; i < ip->fieldsz; i++)
+		buf_appendv(b, "_%s", ip->fields[i]->name);
+	buf_appendv(b, "_idx");
+}
+
+/*
+ * Append the "CREATE INDEX" statement for "ip" without its semicolon.
+ */
+void
+ddl_index(struct sqlbuf *b, const struct sqlidx *ip)
+{
+	size_t	 i;
+
+	buf_appendv(b, "CREATE INDEX ");
+	ddl_index_name(b, ip);
+	buf_appendv(b, " ON %s(", ip->parent->name);
+	for (i = 0; i < ip->fieldsz; i++)
+		buf_appendv(b, "%s%s", i > 0 ? ", " : "",
+			ip->fields[i]->name);
+	buf_appendv(b, ")");
+}
+
+/*
+ * Append the "CREATE TABLE" statement for "p", with its columns,
+ * foreign keys, and unique constraints, on a single line and without
+ * its semicolon.
+ */
+void
+ddl_table(struct sqlbuf *b, const struct strct *p)
+{
+	const struct field	*f;
+	const struct unique	*n;
+	int			 first = 1;
+
+	buf_appendv(b, "CREATE TABLE %s (", p->name);
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (f->type == FTYPE_STRUCT)
+			continue;
+		buf_appendv(b, "%s", first ? "" : ", ");
+		ddl_column(b, f);
+		first = 0;
+	}
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (f->type == FTYPE_STRUCT || f->ref == NULL)
+			continue;
+		buf_appendv(b, "%s", first ? "" : ", ");
+		ddl_fkey(b, f);
+		first = 0;
+	}
+	TAILQ_FOREACH(n, &p->nq, entries) {
+		buf_appendv(b, "%s", first ? "" : ", ");
+		ddl_unique(b, n);
+		first = 0;
+	}
+	buf_appendv(b, ")");
+}
+
+/*
+ * Append a statement to "q" on "p" declared at "pos" and named from
+ * "fmt".
+ * Returns the statement, which has no parts.
+ */
+static struct sqlstmt *
+stmt_add(struct sqlstmtq *q, const struct strct *p,
+	const struct pos *pos, int constrained, const char *fmt, ...)
+{
+	struct sqlstmt	*st;
+	va_list		 ap;
+
+	q->stmt = reallocarray(q->stmt,
+		q->stmtsz + 1, sizeof(struct sqlstmt));
+	if (q->stmt == NULL)
+		err(EXIT_FAILURE, NULL);
+	st = &q->stmt[q->stmtsz++];
+	memset(st, 0, sizeof(struct sqlstmt));
+	st->parent = p;
+	st->pos = pos;
+	st->constrained = constrained;
+
+	va_start(ap, fmt);
+	if (vasprintf(&st->name, fmt, ap) == -1)
+		err(EXIT_FAILURE, NULL);
+	va_end(ap);
+	return st;
+}
+
+/*
+ * Append a part to statement "st".
+ * Returns the part, which is empty.
+ */
+static struct sqlpart *
+stmt_part(struct sqlstmt *st)
+{
+	struct sqlpart	*pt;
+
+	st->parts = reallocarray(st->parts,
+		st->partsz + 1, sizeof(struct sqlpart));
+	if (st->parts == NULL)
+		err(EXIT_FAILURE, NULL);
+	pt = &st->parts[st->partsz++];
+	memset(pt, 0, sizeof(struct sqlpart));
+	return pt;
+}
+
+/*
+ * Append SQL text to statement "st", starting a new part if the last
+ * is not text.
+ */
+static void
+stmt_appendv(struct sqlstmt *st, const char *fmt, ...)
+{
+	struct sqlpart	*pt;
+	va_list		 ap;
+
+	if (st->partsz == 0 || st->parts[st->partsz - 1].strct != NULL)
+		pt = stmt_part(st);
+	else
+		pt = &st->parts[st->partsz - 1];
+
+	va_start(ap, fmt);
+	buf_appendva(&pt->text, fmt, ap);
+	va_end(ap);
+}
+
+/*
+ * Recursively append the columns of "p" and those of all of its nested
+ * structures.
+ * This will specify the columns of the top-level structure (pname is
+ * NULL), then the aliased columns of all of the recursive structures.
+ * See stmt_joins().
+ */
+static void
+stmt_schema(struct sqlstmt *st, const struct strct *orig, int first,
+	const struct strct *p, const char *pname)
+{
+	const struct field	*f;
+	const struct alias	*a = NULL;
+	struct sqlpart		*pt;
+	char			*name;
+
+	if (!first)
+		stmt_appendv(st, ",");
+
+	/*
+	 * If applicable, looks up our alias and use it as the alias
+	 * for the table.
+	 * Otherwise, use the table name itself.
+	 */
+
+	if (pname != NULL) {
+		TAILQ_FOREACH(a, &orig->aq, entries)
+			if (strcasecmp(a->name, pname) == 0)
+				break;
+		assert(a != NULL);
+	}
+
+	pt = stmt_part(st);
+	pt->strct = p;
+	pt->tab = a != NULL ? a->alias : p->name;
+
+	/*
+	 * Recursive step.
+	 * Search through all of our fields for structures.
+	 * If we find them, build up the canonical field reference and
+	 * descend.
+	 */
+
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (f->type != FTYPE_STRUCT)
+			continue;
+		if (pname != NULL) {
+			if (asprintf(&name, "%s.%s", pname, f->name) < 0)
+				err(EXIT_FAILURE, NULL);
+		} else if ((name = strdup(f->name)) == NULL)
+			err(EXIT_FAILURE, NULL);
+		stmt_schema(st, orig, 0, f->ref->target->parent, name);
+		free(name);
+	}
+}
+
+/*
+ * Recursively append the JOIN clauses of all nested structures of "p".
+ * References on null foreign keys use LEFT OUTER JOIN, as must all
+ * references nested beneath them ("outer"), so that a missing row
+ * doesn't discard the parent.
+ * See stmt_schema().
+ */
+static void
+stmt_joins(struct sqlstmt *st, const struct strct *orig,
+	const struct strct *p, const struct alias *parent, int outer)
+{
+	const struct field	*f;
+	const struct alias	*a;
+	int			 join;
+	char			*name;
+
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (f->type != FTYPE_STRUCT)
+			continue;
+		join = outer || (f->ref->source->flags & FIELD_NULL);
+
+		if (parent != NULL) {
+			if (asprintf(&name, "%s.%s",
+			    parent->name, f->name) < 0)
+				err(EXIT_FAILURE, NULL);
+		} else if ((name = strdup(f->name)) == NULL)
+			err(EXIT_FAILURE, NULL);
+
+		TAILQ_FOREACH(a, &orig->aq, entries)
+			if (strcasecmp(a->name, name) == 0)
+				break;
+		assert(a != NULL);
+
+		stmt_appendv(st, " %s JOIN %s AS %s ON %s.%s=%s.%s",
+			join ? "LEFT OUTER" : "INNER",
+			f->ref->target->parent->name, a->alias,
+			a->alias, f->ref->target->name,
+			parent == NULL ? p->name : parent->alias,
+			f->ref->source->name);
+		stmt_joins(st, orig, f->ref->target->parent, a, join);
+		free(name);
+	}
+}
+
+/*
+ * Whether field "f" is bound by an insert into its structure: all native
+ * fields except for the rowid, unless "rowid" is set.
+ */
+int
+insert_field(const struct field *f, int rowid)
+{
+
+	return f->type != FTYPE_STRUCT &&
+		(!(f->flags & FIELD_ROWID) || rowid);
+}
+
+/*
+ * Append an insert into "p", binding all native fields but the rowid,
+ * unless "rowid" is set.
+ */
+static void
+stmt_insert(struct sqlstmt *st, const struct strct *p, int rowid)
+{
+	const struct field	*f;
+	int			 first = 1;
+
+	stmt_appendv(st, "INSERT INTO %s ", p->name);
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (!insert_field(f, rowid))
+			continue;
+		stmt_appendv(st, "%c%s", first ? '(' : ',', f->name);
+		first = 0;
+	}
+
+	if (first) {
+		stmt_appendv(st, "DEFAULT VALUES");
+		return;
+	}
+
+	stmt_appendv(st, ") VALUES ");
+	first = 1;
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (!insert_field(f, rowid))
+			continue;
+		stmt_appendv(st, "%c?", first ? '(' : ',');
+		first = 0;
+	}
+	stmt_appendv(st, ")");
+}
+
+/*
+ * Append the upsert into "p": its insert followed by updating all
+ * inserted fields but the conflict target when it conflicts, and
+ * returning the rowid either way.
+ * If all inserted fields are in the conflict target, they're set to
+ * themselves so that the conflicting row is still returned.
+ */
+static void
+stmt_upsert(struct sqlstmt *st, const struct strct *p)
+{
+	const struct field	*f;
+	const struct cref	*c;
+	size_t			 set = 0;
+	int			 rowid;
+
+	rowid = (p->ups->flags & UPSERT_ROWID) != 0;
+	stmt_insert(st, p, rowid);
+
+	stmt_appendv(st, " ON CONFLICT");
+	TAILQ_FOREACH(c, &p->ups->cq, entries)
+		stmt_appendv(st, "%c%s",
+			c == TAILQ_FIRST(&p->ups->cq) ? '(' : ',',
+			c->field->name);
+	stmt_appendv(st, ") DO UPDATE SET");
+
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (!insert_field(f, rowid))
+			continue;
+		TAILQ_FOREACH(c, &p->ups->cq, entries)
+			if (c->field == f)
+				break;
+		if (c != NULL)
+			continue;
+		stmt_appendv(st, "%s %s = excluded.%s",
+			set++ ? "," : "", f->name, f->name);
+	}
+
+	if (set == 0)
+		TAILQ_FOREACH(c, &p->ups->cq, entries)
+			stmt_appendv(st, "%s %s = excluded.%s",
+				set++ ? "," : "",
+				c->field->name, c->field->name);
+
+	stmt_appendv(st, " RETURNING %s", p->rowid != NULL ?
+		p->rowid->name : "rowid");
+}
+
+/*
+ * Append operator "op" and its bound parameter, if binary.
+ * Set membership is bound as a JSON array, whose elements json_each()
+ * returns as a single-column table.
+ */
+static void
+stmt_op(struct sqlstmt *st, enum optype op)
+{
+
+	if (OPTYPE_ISUNARY(op))
+		stmt_appendv(st, " %s", optypes[op]);
+	else if (op == OPTYPE_IN)
+		stmt_appendv(st, " IN (SELECT value FROM json_each(?))");
+	else
+		stmt_appendv(st, " %s ?", optypes[op]);
+}
+
+/*
+ * Append the constraint selecting the row with the maximum or minimum
+ * aggregate value of its group, which is that of a correlated MAX() or
+ * MIN() lookup, and is satisfied by an index on the group and aggregate
+ * columns.
+ * Rows with a null group or aggregate (including from an outer join)
+ * are always selected, as they are by the self-join form.
+ */
+static void
+stmt_aggr(struct sqlstmt *st, const struct search *s)
+{
+	const char	*tab;
+	int		 nullaggr, nullgrp;
+
+	tab = s->group->alias == NULL ?
+		s->group->field->parent->name : s->group->alias->alias;
+	nullaggr = s->group->alias != NULL ||
+		(s->aggr->field->flags & FIELD_NULL);
+	nullgrp = (s->group->field->flags & FIELD_NULL);
+
+	if (nullaggr || nullgrp)
+		stmt_appendv(st, "(");
+	if (nullaggr)
+		stmt_appendv(st, "%s.%s IS NULL OR ",
+			tab, s->aggr->field->name);
+	if (nullgrp)
+		stmt_appendv(st, "%s.%s IS NULL OR ",
+			tab, s->group->field->name);
+	stmt_appendv(st, "%s.%s = (SELECT %s(_custom.%s) FROM %s AS "
+		"_custom WHERE _custom.%s = %s.%s)",
+		tab, s->aggr->field->name,
+		s->aggr->op == AGGR_MAXROW ? "MAX" : "MIN",
+		s->aggr->field->name,
+		s->group->field->parent->name,
+		s->group->field->name, tab, s->group->field->name);
+	if (nullaggr || nullgrp)
+		stmt_appendv(st, ")");
+}
+
+/*
+ * Append the statement for search "s", which is the "num"th search in
+ * "p".
+ * If "page" is non-zero, this is the keyset pagination statement for
+ * the first page (1) or for the pages following a given ordering value
+ * and rowid (2).
+ * Both are ordered with the rowid as a tiebreaker and limited by a
+ * bound parameter.
+ * If "selfjoin", aggregate groupings use the self-join form instead of
+ * stmt_aggr().
+ */
+static void
+stmt_search(struct sqlstmtq *q, const struct strct *p,
+	const struct search *s, size_t num, int page, int selfjoin)
+{
+	const struct sent	*sent;
+	const struct ord	*ord;
+	const struct proj	*pr;
+	struct sqlstmt		*st;
+	int			 first;
+
+	st = stmt_add(q, p, &s->pos, page == 2,
+		"STMT_%s_BY_SEARCH_%zu%s", p->name, num,
+		page == 0 ? "" : page == 1 ? "_PAGE" : "_AFTER");
+
+	/*
+	 * Juggle around the possibilities of...
+	 *   select count(*)
+	 *   select count(distinct --stmt_schema-- )
+	 *   select --stmt_schema--
+	 *   select --projected columns--
+	 */
+
+	stmt_appendv(st, "SELECT ");
+	if (s->type == STYPE_COUNT)
+		stmt_appendv(st, "COUNT(");
+	if (!TAILQ_EMPTY(&s->projq)) {
+		TAILQ_FOREACH(pr, &s->projq, entries)
+			stmt_appendv(st, "%s%s.%s",
+				pr == TAILQ_FIRST(&s->projq) ?
+				"" : ",", p->name, pr->field->name);
+	} else if (s->dst != NULL) {
+		stmt_appendv(st, "DISTINCT ");
+		stmt_schema(st, p, 1, s->dst->strct, s->dst->fname);
+	} else if (s->type != STYPE_COUNT)
+		stmt_schema(st, p, 1, p, NULL);
+	else
+		stmt_appendv(st, "*");
+	if (s->type == STYPE_COUNT)
+		stmt_appendv(st, ")");
+
+	stmt_appendv(st, " FROM %s", p->name);
+	stmt_joins(st, p, p, NULL, 0);
+
+	/*
+	 * In the self-join form of aggregate groupings, we LEFT
+	 * OUTER JOIN the grouped set to itself, conditioning upon
+	 * the aggregate inequality.
+	 * We'll filter NULL joinings in the WHERE statement.
+	 * This is quadratic in the group size, but doesn't need a
+	 * correlated subquery.
+	 */
+
+	if (selfjoin && s->aggr != NULL && s->group != NULL) {
+		assert(s->aggr->field->parent ==
+		       s->group->field->parent);
+		stmt_appendv(st, " LEFT OUTER JOIN %s as _custom "
+			"ON %s.%s = _custom.%s "
+			"AND %s.%s %s _custom.%s",
+			s->group->field->parent->name,
+			s->group->alias == NULL ?
+			s->group->field->parent->name :
+			s->group->alias->alias,
+			s->group->field->name,
+			s->group->field->name,
+			s->group->alias == NULL ?
+			s->group->field->parent->name :
+			s->group->alias->alias,
+			s->aggr->field->name,
+			s->aggr->op == AGGR_MAXROW ? "<" : ">",
+			s->aggr->field->name);
+	}
+
+	if (!TAILQ_EMPTY(&s->sntq) || page == 2 ||
+	    (s->aggr != NULL && s->group != NULL))
+		stmt_appendv(st, " WHERE");
+
+	first = 1;
+
+	/*
+	 * If we're grouping, filter out all of the joins that
+	 * failed and aren't part of the results, or all but the
+	 * maximum or minimum rows of each group.
+	 */
+
+	if (s->group != NULL && selfjoin) {
+		stmt_appendv(st, " _custom.%s IS NULL",
+			s->group->field->name);
+		first = 0;
+	} else if (s->group != NULL) {
+		stmt_appendv(st, " ");
+		stmt_aggr(st, s);
+		first = 0;
+	}
+
+	/* Continue with our proper WHERE clauses. */
+
+	TAILQ_FOREACH(sent, &s->sntq, entries) {
+		if (sent->field->type == FTYPE_PASSWORD &&
+		    sent->op != OPTYPE_STREQ &&
+		    sent->op != OPTYPE_STRNEQ)
+			continue;
+		stmt_appendv(st, "%s %s.%s", first ? "" : " AND",
+			sent->alias == NULL ?
+			p->name : sent->alias->alias,
+			sent->field->name);
+		stmt_op(st, sent->op);
+		first = 0;
+		st->constrained = 1;
+	}
+
+	/* Seek past the last ordering value and rowid. */
+
+	if (page == 2) {
+		ord = TAILQ_FIRST(&s->ordq);
+		if (ord != NULL)
+			stmt_appendv(st, "%s (%s.%s, %s.%s) %s (?, ?)",
+				first ? "" : " AND",
+				ord->alias == NULL ?
+				p->name : ord->alias->alias,
+				ord->field->name,
+				p->name, p->rowid->name,
+				ord->op == ORDTYPE_ASC ? ">" : "<");
+		else
+			stmt_appendv(st, "%s %s.%s > ?",
+				first ? "" : " AND",
+				p->name, p->rowid->name);
+	}
+
+	first = 1;
+	if (!TAILQ_EMPTY(&s->ordq) || page)
+		stmt_appendv(st, " ORDER BY ");
+	TAILQ_FOREACH(ord, &s->ordq, entries) {
+		stmt_appendv(st, "%s%s.%s %s", first ? "" : ", ",
+			ord->alias == NULL ?
+			p->name : ord->alias->alias,
+			ord->field->name,
+			ord->op == ORDTYPE_ASC ? "ASC" : "DESC");
+		first = 0;
+	}
+	if (page) {
+		ord = TAILQ_FIRST(&s->ordq);
+		stmt_appendv(st, "%s%s.%s %s LIMIT ?",
+			first ? "" : ", ",
+			p->name, p->rowid->name,
+			ord == NULL || ord->op == ORDTYPE_ASC ?
+			"ASC" : "DESC");
+	}
+
+	if (s->flags & SEARCH_LIMIT_BOUND)
+		stmt_appendv(st, " LIMIT ?");
+	else if (s->type != STYPE_SEARCH && s->limit > 0)
+		stmt_appendv(st, " LIMIT %" PRId64, s->limit);
+	if (s->flags & SEARCH_OFFSET_BOUND)
+		stmt_appendv(st, " OFFSET ?");
+	else if (s->type != STYPE_SEARCH && s->offset > 0)
+		stmt_appendv(st, " OFFSET %" PRId64, s->offset);
+}
+
+/*
+ * Append the constraints of update or delete "up".
+ */
+static void
+stmt_where(struct sqlstmt *st, const struct update *up)
+{
+	const struct uref	*ur;
+
+	TAILQ_FOREACH(ur, &up->crq, entries) {
+		stmt_appendv(st, " %s %s",
+			ur == TAILQ_FIRST(&up->crq) ? "WHERE" : "AND",
+			ur->field->name);
+		stmt_op(st, ur->op);
+	}
+}
+
+/*
+ * Append the "num"th update statement "up" of "p".
+ * If "returning", this is the variant also returning the updated rows'
+ * columns in the order of DB_SCHEMA_xxx, as db_xxx_fill() expects.
+ */
+static void
+stmt_update(struct sqlstmtq *q, const struct strct *p,
+	const struct update *up, size_t num, int returning)
+{
+	const struct uref	*ur;
+	struct sqlstmt		*st;
+
+	st = stmt_add(q, p, &up->pos, !TAILQ_EMPTY(&up->crq),
+		"STMT_%s_UPDATE_%zu%s", p->name, num,
+		returning ? "_RETURNING" : "");
+
+	stmt_appendv(st, "UPDATE %s SET", p->name);
+	TAILQ_FOREACH(ur, &up->mrq, entries) {
+		stmt_appendv(st, "%c",
+			ur == TAILQ_FIRST(&up->mrq) ? ' ' : ',');
+		switch (ur->mod) {
+		case MODTYPE_INC:
+			stmt_appendv(st, "%s = %s + ?",
+				ur->field->name, ur->field->name);
+			break;
+		case MODTYPE_DEC:
+			stmt_appendv(st, "%s = %s - ?",
+				ur->field->name, ur->field->name);
+			break;
+		case MODTYPE_CONCAT:
+			/*
+			 * If we concatenate a NULL with a
+			 * non-NULL, we'll always get a NULL
+			 * value, which isn't what we want.
+			 * This will wrap possibly-null values
+			 * so that they're always strings.
+			 */
+			if ((ur->field->flags & FIELD_NULL))
+				stmt_appendv(st, "%s = COALESCE(%s,'')"
+					" || ?", ur->field->name,
+					ur->field->name);
+			else
+				stmt_appendv(st, "%s = %s || ?",
+					ur->field->name,
+					ur->field->name);
+			break;
+		default:
+			stmt_appendv(st, "%s = ?", ur->field->name);
+			break;
+		}
+	}
+	stmt_where(st, up);
+	if (returning) {
+		stmt_appendv(st, " RETURNING ");
+		stmt_schema(st, p, 1, p, NULL);
+	}
+}
+
+/*
+ * Fill "q" with all statements run by the functions of "p" in the order
+ * of their enumeration.
+ * If "selfjoin", aggregate groupings use the self-join form.
+ */
+void
+stmt_gen(const struct strct *p, int selfjoin, struct sqlstmtq *q)
+{
+	const struct field	*f;
+	const struct search	*s;
+	const struct update	*up;
+	struct sqlstmt		*st;
+	size_t			 pos;
+
+	memset(q, 0, sizeof(struct sqlstmtq));
+
+	/* We have a special query just for our unique fields. */
+
+	TAILQ_FOREACH(f, &p->fq, entries) {
+		if (!(f->flags & (FIELD_ROWID|FIELD_UNIQUE)))
+			continue;
+		st = stmt_add(q, p, &f->pos, 1,
+			"STMT_%s_BY_UNIQUE_%s", p->name, f->name);
+		stmt_appendv(st, "SELECT ");
+		stmt_schema(st, p, 1, p, NULL);
+		stmt_appendv(st, " FROM %s", p->name);
+		stmt_joins(st, p, p, NULL, 0);
+		stmt_appendv(st, " WHERE %s.%s = ?", p->name, f->name);
+	}
+
+	/*
+	 * Custom search queries.
+	 * Paginated queries also have statements for the first and
+	 * following pages.
+	 */
+
+	pos = 0;
+	TAILQ_FOREACH(s, &p->sq, entries) {
+		stmt_search(q, p, s, pos, 0, selfjoin);
+		if (s->flags & SEARCH_PAGINATE) {
+			stmt_search(q, p, s, pos, 1, selfjoin);
+			stmt_search(q, p, s, pos, 2, selfjoin);
+		}
+		pos++;
+	}
+
+	/* Insertion of a new record, possibly returning it. */
+
+	if (p->ins != NULL) {
+		st = stmt_add(q, p, &p->ins->pos, 0,
+			"STMT_%s_INSERT", p->name);
+		stmt_insert(st, p, 0);
+	}
+	if (p->ins != NULL && (p->ins->flags & INSERT_RETURNING)) {
+		st = stmt_add(q, p, &p->ins->pos, 0,
+			"STMT_%s_INSERT_RETURNING", p->name);
+		stmt_insert(st, p, 0);
+		stmt_appendv(st, " RETURNING ");
+		stmt_schema(st, p, 1, p, NULL);
+	}
+
+	/* Insertion or update of a conflicting record. */
+
+	if (p->ups != NULL) {
+		st = stmt_add(q, p, &p->ups->pos, 0,
+			"STMT_%s_UPSERT", p->name);
+		stmt_upsert(st, p);
+	}
+
+	/* Custom update queries, possibly returning their rows. */
+
+	pos = 0;
+	TAILQ_FOREACH(up, &p->uq, entries) {
+		stmt_update(q, p, up, pos, 0);
+		if (up->flags & UPDATE_RETURNING)
+			stmt_update(q, p, up, pos, 1);
+		pos++;
+	}
+
+	/* Custom delete queries. */
+
+	pos = 0;
+	TAILQ_FOREACH(up, &p->dq, entries) {
+		st = stmt_add(q, p, &up->pos, !TAILQ_EMPTY(&up->crq),
+			"STMT_%s_DELETE_%zu", p->name, pos++);
+		stmt_appendv(st, "DELETE FROM %s", p->name);
+		stmt_where(st, up);
+	}
+}
+
+void
+stmt_free(struct sqlstmtq *q)
+{
+	size_t	 i, j;
+
+	for (i = 0; i < q->stmtsz; i++) {
+		for (j = 0; j < q->stmt[i].partsz; j++)
+			free(q->stmt[i].parts[j].text.data);
+		free(q->stmt[i].parts);
+		free(q->stmt[i].name);
+	}
+	free(q->stmt);
+	memset(q, 0, sizeof(struct sqlstmtq));
+}
+
+/*
+ * Append the SQL of statement "st", expanding its columns as the
+ * DB_SCHEMA_xxx macros of ort-c-source(1) do.
+ */
+void
+stmt_sql(struct sqlbuf *b, const struct sqlstmt *st)
+{
+	const struct sqlpart	*pt;
+	const struct field	*f;
+	size_t			 i;
+	int			 first;
+
+	for (i = 0; i < st->partsz; i++) {
+		pt = &st->parts[i];
+		if (pt->strct == NULL) {
+			buf_appendv(b, "%s", pt->text.data);
+			continue;
+		}
+		first = 1;
+		TAILQ_FOREACH(f, &pt->strct->fq, entries) {
+			if (f->type == FTYPE_STRUCT)
+				continue;
+			buf_appendv(b, "%s%s.%s",
+				first ? "" : ",", pt->tab, f->name);
+			first = 0;
+		}
+	}
+}
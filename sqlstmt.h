@@ -0,0 +1,82 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 Kristaps Dzonsons <kristaps@bsd.lv>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef SQLSTMT_H
+#define SQLSTMT_H
+
+/*
+ * SQL text being built.
+ */
+struct	sqlbuf {
+	char			 *data; /* NUL-terminated or NULL */
+	size_t			  sz; /* length w/o NUL */
+	size_t			  max; /* allocated */
+};
+
+/*
+ * A part of a statement: either SQL text or, if "strct" is set, the
+ * columns of that structure qualified by the table name or alias "tab",
+ * as in the DB_SCHEMA_xxx macros of ort-c-source(1).
+ */
+struct	sqlpart {
+	struct sqlbuf		  text;
+	const struct strct	 *strct;
+	const char		 *tab;
+};
+
+/*
+ * A statement run by the functions of ort-c-source(1).
+ */
+struct	sqlstmt {
+	char			 *name; /* in enum stmt, e.g., STMT_foo_INSERT */
+	const struct strct	 *parent; /* structure operated upon */
+	const struct pos	 *pos; /* declaration */
+	int			  constrained; /* not on all rows */
+	struct sqlpart		 *parts;
+	size_t			  partsz;
+};
+
+/*
+ * All statements of a structure in the order of enum stmt.
+ */
+struct	sqlstmtq {
+	struct sqlstmt		 *stmt;
+	size_t			  stmtsz;
+};
+
+extern	const char *const ftypes[FTYPE__MAX];
+extern	const char *const optypes[OPTYPE__MAX];
+extern	const char *const upacts[UPACT__MAX];
+
+void	 buf_appendv(struct sqlbuf *, const char *, ...)
+		__attribute__((format(printf, 2, 3)));
+void	 buf_free(struct sqlbuf *);
+void	 buf_reset(struct sqlbuf *);
+
+void	 ddl_column(struct sqlbuf *, const struct field *);
+void	 ddl_fkey(struct sqlbuf *, const struct field *);
+void	 ddl_index(struct sqlbuf *, const struct sqlidx *);
+void	 ddl_index_name(struct sqlbuf *, const struct sqlidx *);
+void	 ddl_table(struct sqlbuf *, const struct strct *);
+void	 ddl_unique(struct sqlbuf *, const struct unique *);
+
+int	 insert_field(const struct field *, int);
+
+void	 stmt_free(struct sqlstmtq *);
+void	 stmt_gen(const struct strct *, int, struct sqlstmtq *);
+void	 stmt_sql(struct sqlbuf *, const struct sqlstmt *);
+
+#endif /* !SQLSTMT_H */
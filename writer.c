@@ -94,6 +94,7 @@ static	const char *const optypes[OPTYPE__MAX] = {
 	"or", /* OPTYPE_OR */
 	"streq", /* OPTYPE_STREQ */
 	"strneq", /* OPTYPE_STRNEQ */
+	"in", /* OPTYPE_IN */
 	/* Unary types... */
 	"isnull", /* OPTYPE_ISNULL */
 	"notnull", /* OPTYPE_NOTNULL */
@@ -108,9 +109,34 @@ static	const char *const rolemapts[ROLEMAP__MAX] = {
 	"list", /* ROLEMAP_LIST */
 	"search", /* ROLEMAP_SEARCH */
 	"update", /* ROLEMAP_UPDATE */
+	"upsert", /* ROLEMAP_UPSERT */
 	"noexport", /* ROLEMAP_NOEXPORT */
 };
 
+static	const char *const journals[JOURNAL__MAX] = {
+	NULL, /* JOURNAL_UNSET */
+	"delete", /* JOURNAL_DELETE */
+	"memory", /* JOURNAL_MEMORY */
+	"off", /* JOURNAL_OFF */
+	"persist", /* JOURNAL_PERSIST */
+	"truncate", /* JOURNAL_TRUNCATE */
+	"wal", /* JOURNAL_WAL */
+};
+
+static	const char *const syncmodes[SYNCMODE__MAX] = {
+	NULL, /* SYNCMODE_UNSET */
+	"extra", /* SYNCMODE_EXTRA */
+	"full", /* SYNCMODE_FULL */
+	"normal", /* SYNCMODE_NORMAL */
+	"off", /* SYNCMODE_OFF */
+};
+
+static	const char *const tempstores[TEMPSTORE__MAX] = {
+	NULL, /* TEMPSTORE_UNSET */
+	"file", /* TEMPSTORE_FILE */
+	"memory", /* TEMPSTORE_MEMORY */
+};
+
 struct	writer {
 	FILE	*f;
 };
@@ -367,8 +393,8 @@ parse_write_modify(struct writer *w, const struct update *p)
 		}
 	}
 
-	if (TAILQ_EMPTY(&p->crq) &&
-	    p->name == NULL && p->doc == NULL)
+	if (TAILQ_EMPTY(&p->crq) && p->name == NULL && 
+	    p->doc == NULL && !(p->flags & UPDATE_RETURNING))
 		return wputs(w, ";\n");
 
 	if (p->type == UP_MODIFY && !wputc(w, ':'))
@@ -388,12 +414,16 @@ parse_write_modify(struct writer *w, const struct update *p)
 
 	/* Trailing data (optional). */
 
-	if (p->name != NULL || p->doc != NULL) {
+	if (p->name != NULL || p->doc != NULL ||
+	    (p->flags & UPDATE_RETURNING)) {
 		if (!wputc(w, ':'))
 			return 0;
 		if (p->name != NULL && 
 		    !wprint(w, " name %s", p->name))
 			return 0;
+		if ((p->flags & UPDATE_RETURNING) &&
+		    !wputs(w, " returning"))
+			return 0;
 		if (!parse_write_comment(w, p->doc, 2))
 			return 0;
 	}
@@ -431,6 +461,7 @@ parse_write_query(struct writer *w, const struct search *p)
 {
 	const struct sent	*s;
 	const struct ord	*o;
+	const struct proj	*pr;
 	size_t			 nf;
 	int			 colon = 0;
 
@@ -476,20 +507,33 @@ parse_write_query(struct writer *w, const struct search *p)
 			return 0;
 	}
 
-	/* Limit and offset. */
+	/* Limit and offset (which is only a suffix to the limit). */
 
-	if (p->limit) {
+	if (p->limit || (p->flags & SEARCH_LIMIT_BOUND)) {
 		if (!colon && !wputc(w, ':'))
 			return 0;
-		if (!wprint(w, " limit %" PRId64, p->limit))
+		if (p->flags & SEARCH_LIMIT_BOUND) {
+			if (!wputs(w, " limit ?"))
+				return 0;
+		} else if (!wprint(w, " limit %" PRId64, p->limit))
 			return 0;
 		colon = 1;
 	}
 
-	if (p->offset) {
+	if (p->flags & SEARCH_OFFSET_BOUND) {
+		if (!wputs(w, ", ?"))
+			return 0;
+	} else if (p->offset) {
+		if (!wprint(w, ", %" PRId64, p->offset))
+			return 0;
+	}
+
+	/* Keyset pagination. */
+
+	if (p->flags & SEARCH_PAGINATE) {
 		if (!colon && !wputc(w, ':'))
 			return 0;
-		if (!wprint(w, " offset %" PRId64, p->offset))
+		if (!wputs(w, " paginate"))
 			return 0;
 		colon = 1;
 	}
@@ -506,6 +550,18 @@ parse_write_query(struct writer *w, const struct search *p)
 		colon = 1;
 	}
 
+	/* Projected fields. */
+
+	nf = 0;
+	TAILQ_FOREACH(pr, &p->projq, entries) {
+		if (!colon && !wputc(w, ':'))
+			return 0;
+		if (!wprint(w, "%s %s", nf++ ? "," : " fields",
+		    pr->field->name))
+			return 0;
+		colon = 1;
+	}
+
 	/* Distinct selection. */
 
 	if (p->dst != NULL) {
@@ -577,6 +633,48 @@ parse_write_rolemap(struct writer *w, const struct rolemap *p)
 	return wputs(w, "; };\n");
 }
 
+/*
+ * Write a structure index statement.
+ * Returns zero on failure (memory), non-zero otherwise.
+ */
+static int
+parse_write_index(struct writer *w, const struct index *p)
+{
+	const struct iref	*i;
+	size_t			 nf = 0;
+
+	if (!wputs(w, "\tindex"))
+		return 0;
+
+	TAILQ_FOREACH(i, &p->iq, entries)
+		if (!wprint(w, "%s %s",
+		    nf++ ? "," : "", i->field->name))
+			return 0;
+
+	return wputs(w, ";\n");
+}
+
+/*
+ * Write a structure upsert statement.
+ * Returns zero on failure (memory), non-zero otherwise.
+ */
+static int
+parse_write_upsert(struct writer *w, const struct upsert *p)
+{
+	const struct cref	*c;
+	size_t			 nf = 0;
+
+	if (!wputs(w, "\tupsert"))
+		return 0;
+
+	TAILQ_FOREACH(c, &p->cq, entries)
+		if (!wprint(w, "%s %s",
+		    nf++ ? "," : "", c->field->name))
+			return 0;
+
+	return wputs(w, ";\n");
+}
+
 /*
  * Write a top-level structure.
  * Returns zero on failure (memory), non-zero otherwise.
@@ -588,6 +686,7 @@ parse_write_strct(struct writer *w, const struct strct *p)
 	const struct search  *s;
 	const struct update  *u;
 	const struct unique  *n;
+	const struct index   *i;
 	const struct rolemap *r;
 
 	if ( ! wprint(w, "struct %s {\n", p->name))
@@ -606,11 +705,18 @@ parse_write_strct(struct writer *w, const struct strct *p)
 		if ( ! parse_write_modify(w, u))
 			return 0;
 	if (NULL != p->ins) 
-		if ( ! wputs(w, "\tinsert;\n"))
+		if ( ! wputs(w, (INSERT_RETURNING & p->ins->flags) ?
+		    "\tinsert returning;\n" : "\tinsert;\n"))
+			return 0;
+	if (NULL != p->ups) 
+		if ( ! parse_write_upsert(w, p->ups))
 			return 0;
 	TAILQ_FOREACH(n, &p->nq, entries)
 		if ( ! parse_write_unique(w, n))
 			return 0;
+	TAILQ_FOREACH(i, &p->iq, entries)
+		if ( ! parse_write_index(w, i))
+			return 0;
 	TAILQ_FOREACH(r, &p->rq, entries) 
 		if ( ! parse_write_rolemap(w, r))
 			return 0;
@@ -824,6 +930,62 @@ parse_write_roles(struct writer *w, const struct config *cfg)
 	return wputs(w, "};\n\n");
 }
 
+/*
+ * Write a byte size "v" using the largest multiplier evenly dividing
+ * it, if any.
+ * Returns zero on failure (memory), non-zero otherwise.
+ */
+static int
+parse_write_size(struct writer *w, int64_t v)
+{
+	const char	*mult = "";
+
+	if (v > 0 && v % (INT64_C(1) << 30) == 0) {
+		v >>= 30;
+		mult = "G";
+	} else if (v > 0 && v % (INT64_C(1) << 20) == 0) {
+		v >>= 20;
+		mult = "M";
+	} else if (v > 0 && v % (INT64_C(1) << 10) == 0) {
+		v >>= 10;
+		mult = "K";
+	}
+	return wprint(w, "%" PRId64 "%s", v, mult);
+}
+
+/*
+ * Write the top-level database block.
+ * The cache size is written as-is, as it's in pages or KiB.
+ * Returns zero on failure (memory), non-zero otherwise.
+ */
+static int
+parse_write_database(struct writer *w, const struct database *p)
+{
+
+	if (!wputs(w, "database {\n"))
+		return 0;
+	if (p->journal != JOURNAL_UNSET &&
+	    !wprint(w, "\tjournal %s;\n", journals[p->journal]))
+		return 0;
+	if (p->sync != SYNCMODE_UNSET &&
+	    !wprint(w, "\tsynchronous %s;\n", syncmodes[p->sync]))
+		return 0;
+	if (p->temp != TEMPSTORE_UNSET &&
+	    !wprint(w, "\ttemp %s;\n", tempstores[p->temp]))
+		return 0;
+	if (p->flags & DATABASE_MMAP) {
+		if (!wputs(w, "\tmmap ") ||
+		    !parse_write_size(w, p->mmap) ||
+		    !wputs(w, ";\n"))
+			return 0;
+	}
+	if (p->flags & DATABASE_CACHE) {
+		if (!wprint(w, "\tcache %" PRId64 ";\n", p->cache))
+			return 0;
+	}
+	return wputs(w, "};\n\n");
+}
+
 int
 ort_write_file(FILE *f, const struct config *cfg)
 {
@@ -836,6 +998,9 @@ ort_write_file(FILE *f, const struct config *cfg)
 	memset(&w, 0, sizeof(struct writer));
 	w.f = f;
 
+	if (cfg->db != NULL)
+		if ( ! parse_write_database(&w, cfg->db))
+			goto out;
 	if (!TAILQ_EMPTY(&cfg->rq))
 		if ( ! parse_write_roles(&w, cfg))
 			goto out;